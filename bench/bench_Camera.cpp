@@ -0,0 +1,30 @@
+#include "NEGUI2/Core/Core.hpp"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+    void BM_Camera_Upload(benchmark::State &state)
+    {
+        auto &camera = NEGUI2::Core::get_instance().three_d.camera();
+        double angle = 0.0;
+        for (auto _ : state)
+        {
+            camera.set_position(Eigen::Vector3d(100.0 * std::cos(angle), 100.0 * std::sin(angle), 50.0));
+            camera.lookat(Eigen::Vector3d::Zero());
+            camera.upload();
+            angle += 0.01;
+        }
+    }
+    BENCHMARK(BM_Camera_Upload);
+
+    void BM_Camera_UvToDirection(benchmark::State &state)
+    {
+        auto &camera = NEGUI2::Core::get_instance().three_d.camera();
+        Eigen::Vector2d uv(0.25, -0.5);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(camera.uv_to_direction(uv));
+        }
+    }
+    BENCHMARK(BM_Camera_UvToDirection);
+}
\ No newline at end of file
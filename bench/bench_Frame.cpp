@@ -0,0 +1,39 @@
+#include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/ThreeD/Mesh.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    /* 描画から提示までの1フレーム (ソフトウェアVulkanドライバでの実行を想定) */
+    void BM_Frame(benchmark::State &state)
+    {
+        auto &core = NEGUI2::Core::get_instance();
+        std::vector<std::shared_ptr<NEGUI2::Mesh>> meshes;
+        for (int64_t i = 0; i < state.range(0); i++)
+        {
+            auto mesh = std::make_shared<NEGUI2::Mesh>();
+            mesh->load("./runtime/RubberDuck.stl");
+            mesh->set_position(Eigen::Vector3d(100.0 * static_cast<double>(i % 8), 100.0 * static_cast<double>(i / 8), 0.0));
+            core.three_d.add(mesh);
+            meshes.push_back(mesh);
+        }
+
+        /* 毎フレームシーンを描き直す場合を計測 */
+        core.idle_wait = false;
+        for (auto _ : state)
+        {
+            core.invalidate();
+            core.update();
+        }
+        state.SetComplexityN(state.range(0));
+
+        core.wait_idle();
+        for (auto &mesh : meshes)
+        {
+            core.three_d.erase(mesh);
+        }
+    }
+    BENCHMARK(BM_Frame)->Arg(0)->Arg(1)->Arg(16)->Arg(64)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "NEGUI2/Core/Core.hpp"
+#include <benchmark/benchmark.h>
+#include <vector>
+
+namespace
+{
+    void BM_MemoryManager_Churn(benchmark::State &state)
+    {
+        auto &mm = NEGUI2::Core::get_instance().mm;
+        std::vector<uint8_t> data(static_cast<size_t>(state.range(0)), 0xA5);
+        for (auto _ : state)
+        {
+            mm.add_memory("BenchChurn", data.size(), NEGUI2::Memory::TYPE::VERTEX);
+            mm.upload_memory("BenchChurn", data.data(), data.size());
+            mm.remove_memory("BenchChurn");
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_MemoryManager_Churn)->RangeMultiplier(16)->Range(1 << 10, 1 << 22)->Unit(benchmark::kMicrosecond);
+
+    void BM_MemoryManager_Upload(benchmark::State &state)
+    {
+        auto &mm = NEGUI2::Core::get_instance().mm;
+        std::vector<uint8_t> data(static_cast<size_t>(state.range(0)), 0x5A);
+        mm.add_memory("BenchUpload", data.size(), NEGUI2::Memory::TYPE::VERTEX, true);
+        for (auto _ : state)
+        {
+            mm.upload_memory("BenchUpload", data.data(), data.size());
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+        mm.remove_memory("BenchUpload");
+    }
+    BENCHMARK(BM_MemoryManager_Upload)->RangeMultiplier(16)->Range(1 << 10, 1 << 22)->Unit(benchmark::kMicrosecond);
+}
\ No newline at end of file
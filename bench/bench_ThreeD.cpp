@@ -0,0 +1,128 @@
+#include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/ThreeD/Mesh.hpp"
+#include "NEGUI2/ThreeD/Point.hpp"
+#include "NEGUI2/ThreeD/TransformBatch.hpp"
+#include "NEGUI2/ThreeD/TransformHierarchy.hpp"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    const std::filesystem::path MESH_PATH("./runtime/20mm_cube.stl");
+
+    void BM_Mesh_Load(benchmark::State &state)
+    {
+        auto mesh = std::make_shared<NEGUI2::Mesh>();
+        for (auto _ : state)
+        {
+            mesh->load(MESH_PATH);
+        }
+        NEGUI2::Core::get_instance().wait_idle();
+    }
+    BENCHMARK(BM_Mesh_Load)->Unit(benchmark::kMillisecond);
+
+    void BM_ThreeD_Pick(benchmark::State &state)
+    {
+        auto &core = NEGUI2::Core::get_instance();
+        std::vector<std::shared_ptr<NEGUI2::Mesh>> meshes;
+        for (int64_t i = 0; i < state.range(0); i++)
+        {
+            auto mesh = std::make_shared<NEGUI2::Mesh>();
+            mesh->load(MESH_PATH);
+            mesh->set_position(Eigen::Vector3d(30.0 * static_cast<double>(i % 16), 30.0 * static_cast<double>(i / 16), 0.0));
+            core.three_d.add(mesh);
+            meshes.push_back(mesh);
+        }
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(core.three_d.pick(Eigen::Vector2d(0.0, 0.0)));
+        }
+        state.SetComplexityN(state.range(0));
+
+        core.wait_idle();
+        for (auto &mesh : meshes)
+        {
+            core.three_d.erase(mesh);
+        }
+    }
+    BENCHMARK(BM_ThreeD_Pick)->RangeMultiplier(4)->Range(1, 256)->Complexity()->Unit(benchmark::kMicrosecond);
+
+    void BM_Point_Add(benchmark::State &state)
+    {
+        /* 頂点バッファは生成時に最大点数分確保されるため, インスタンスは使い回す */
+        static auto point = []()
+        {
+            auto point = std::make_shared<NEGUI2::Point>();
+            point->init();
+            return point;
+        }();
+
+        for (auto _ : state)
+        {
+            for (int64_t i = 0; i < state.range(0); i++)
+            {
+                point->add(Eigen::Vector3f(static_cast<float>(i), 0.f, 0.f));
+            }
+
+            state.PauseTiming();
+            while (point->popback())
+            {
+            }
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        NEGUI2::Core::get_instance().wait_idle();
+    }
+    BENCHMARK(BM_Point_Add)->RangeMultiplier(8)->Range(8, 512)->Unit(benchmark::kMillisecond);
+
+    void BM_TransformBatch_Compute(benchmark::State &state)
+    {
+        /* プラント規模の座標 (数百m) に置いたオブジェクト */
+        NEGUI2::TransformBatch batch;
+        for (int64_t i = 0; i < state.range(0); i++)
+        {
+            Eigen::Affine3d transform(Eigen::AngleAxisd(0.001 * static_cast<double>(i), Eigen::Vector3d::UnitZ()));
+            transform.translation() = Eigen::Vector3d(500.0 + 0.01 * static_cast<double>(i % 1000), 300.0 + 0.01 * static_cast<double>(i / 1000), 20.0);
+            batch.add(transform);
+        }
+
+        Eigen::Vector3d origin(505.0, 305.0, 21.7);
+        for (auto _ : state)
+        {
+            batch.compute(origin);
+            benchmark::DoNotOptimize(batch.get(0));
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_TransformBatch_Compute)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMicrosecond);
+
+    void BM_TransformHierarchy_MoveFixture(benchmark::State &state)
+    {
+        /* 治具1つに部品を並べ, 治具だけを動かす */
+        std::vector<std::unique_ptr<NEGUI2::BaseTransform>> parts;
+        auto fixture = std::make_unique<NEGUI2::BaseTransform>();
+        NEGUI2::TransformHierarchy hierarchy; // 部品より先に破棄され, まとめて切り離す
+        hierarchy.add(fixture.get());
+        for (int64_t i = 0; i < state.range(0); i++)
+        {
+            auto part = std::make_unique<NEGUI2::BaseTransform>();
+            part->set_position(Eigen::Vector3d(0.01 * static_cast<double>(i), 0.0, 0.0));
+            hierarchy.add(part.get());
+            hierarchy.set_parent(part.get(), fixture.get());
+            parts.push_back(std::move(part));
+        }
+        hierarchy.update();
+
+        double x = 0.0;
+        for (auto _ : state)
+        {
+            fixture->set_position(Eigen::Vector3d(x, 0.0, 0.0));
+            benchmark::DoNotOptimize(hierarchy.update());
+            x += 0.001;
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_TransformHierarchy_MoveFixture)->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMicrosecond);
+}
\ No newline at end of file
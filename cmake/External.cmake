@@ -12,6 +12,18 @@ FetchContent_Declare(
 )
 FetchContent_MakeAvailable(googletest)
 
+# #################################################
+# google benchmark
+# #################################################
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+FetchContent_Declare(
+  benchmark
+  GIT_REPOSITORY https://github.com/google/benchmark.git
+  GIT_TAG v1.8.3
+)
+FetchContent_MakeAvailable(benchmark)
+
 # #################################################
 # spdlog
 # #################################################
@@ -209,6 +221,22 @@ if(NOT stb_POPULATED)
   )
 endif()
 
+# #################################################
+# ktx (KTX2 + Basis Universal)
+# #################################################
+set(KTX_FEATURE_TESTS OFF CACHE BOOL "" FORCE)
+set(KTX_FEATURE_TOOLS OFF CACHE BOOL "" FORCE)
+set(KTX_FEATURE_DOC OFF CACHE BOOL "" FORCE)
+set(KTX_FEATURE_GL_UPLOAD OFF CACHE BOOL "" FORCE)
+set(KTX_FEATURE_VK_UPLOAD OFF CACHE BOOL "" FORCE)
+set(KTX_FEATURE_STATIC_LIBRARY ON CACHE BOOL "" FORCE)
+FetchContent_Declare(
+  ktx
+  GIT_REPOSITORY https://github.com/KhronosGroup/KTX-Software.git
+  GIT_TAG v4.3.2
+)
+FetchContent_MakeAvailable(ktx)
+
 # #################################################
 # assimp
 # #################################################
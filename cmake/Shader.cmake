@@ -28,34 +28,43 @@ function(target_glsl_shaders TARGET_NAME)
 
   foreach(GLSL_FILE IN LISTS target_glsl_shaders_INTERFACE)
     get_filename_component(FILE_NAME ${GLSL_FILE} NAME)
+    get_filename_component(GLSL_DIR ${GLSL_FILE} DIRECTORY)
+    file(GLOB GLSL_INCLUDES ${GLSL_DIR}/*.glsl)
     set(SPIRV_FILE "${SHADER_OUT_DIR}/${FILE_NAME}.spv")
     add_custom_command(
         OUTPUT ${SPIRV_FILE}
         COMMAND ${GLSLANG_VALIDATOR} ${target_glsl_shaders_COMPILE_OPTIONS} -V
         "${GLSL_FILE}" -o "${SPIRV_FILE}"
-        MAIN_DEPENDENCY ${GLSL_FILE} )
+        MAIN_DEPENDENCY ${GLSL_FILE}
+        DEPENDS ${GLSL_INCLUDES} )
     list(APPEND SPIRV_BINARY_FILES ${SPIRV_FILE})
   endforeach()
 
   foreach(GLSL_FILE IN LISTS target_glsl_shaders_PUBLIC)
     get_filename_component(FILE_NAME ${GLSL_FILE} NAME)
+    get_filename_component(GLSL_DIR ${GLSL_FILE} DIRECTORY)
+    file(GLOB GLSL_INCLUDES ${GLSL_DIR}/*.glsl)
     set(SPIRV_FILE "${SHADER_OUT_DIR}/${FILE_NAME}.spv")
     add_custom_command(
         OUTPUT ${SPIRV_FILE}
         COMMAND ${GLSLANG_VALIDATOR} ${target_glsl_shaders_COMPILE_OPTIONS} -V
         "${GLSL_FILE}" -o "${SPIRV_FILE}"
-        MAIN_DEPENDENCY ${GLSL_FILE} )
+        MAIN_DEPENDENCY ${GLSL_FILE}
+        DEPENDS ${GLSL_INCLUDES} )
     list(APPEND SPIRV_BINARY_FILES ${SPIRV_FILE})
   endforeach()
 
   foreach(GLSL_FILE IN LISTS target_glsl_shaders_PRIVATE)
     get_filename_component(FILE_NAME ${GLSL_FILE} NAME)
+    get_filename_component(GLSL_DIR ${GLSL_FILE} DIRECTORY)
+    file(GLOB GLSL_INCLUDES ${GLSL_DIR}/*.glsl)
     set(SPIRV_FILE "${SHADER_OUT_DIR}/${FILE_NAME}.spv")
     add_custom_command(
         OUTPUT ${SPIRV_FILE}
         COMMAND ${GLSLANG_VALIDATOR} ${target_glsl_shaders_COMPILE_OPTIONS} -V
         "${GLSL_FILE}" -o "${SPIRV_FILE}"
-        MAIN_DEPENDENCY ${GLSL_FILE} )
+        MAIN_DEPENDENCY ${GLSL_FILE}
+        DEPENDS ${GLSL_INCLUDES} )
     list(APPEND SPIRV_BINARY_FILES ${SPIRV_FILE})
   endforeach()
 
@@ -1,9 +1,16 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+#include "DescriptorSet.glsl"
 
 layout(location = 0) out vec4 outColor;
 layout(location = 1) out ivec4 outID;
 
+layout(std140, set = SET_DRAW, binding = 0) uniform Draw
+{
+    vec4 color;
+} draw;
+
 void main() {
-    outColor = vec4(1.0, 0.0, 0.0, 1.0);
+    outColor = draw.color;
     outID = ivec4(0, 0, 0, 1);
 }
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location  = 0) in vec4 in_color;
 layout(location = 1) in flat int class_id;
@@ -16,28 +17,13 @@ layout(std140, binding = 0) uniform Mouse
     float y;
 } mouse;
 
-layout(std140, binding = 2) buffer PickData
-{
-    int type;
-    int instance;
-    int vertex;
-    float depth;
-} pick_data;
+#include "Pick.glsl"
 
 void main() {
     outColor = in_color;
-    outID = ivec4(55, 100, 126, 1);
+    /* 範囲選択はオブジェクト単位 */
+    outID = ivec4(class_id, instance_id, 0, 1);
 
     /* ピックデータ更新 */
-    vec2 pos = vec2(mouse.x, mouse.y);
-    float dist = length(gl_FragCoord.xy - pos);
-    float depth = 1.0 - gl_FragCoord.z;
-    if(dist < 20.0 && pick_data.depth <= depth)
-    {
-        pick_data.instance = instance_id;
-        pick_data.type = class_id;
-        pick_data.vertex = vertex_id;
-        
-        pick_data.depth = depth;
-    }
+    write_pick(vec2(mouse.x, mouse.y), class_id, instance_id, vertex_id);
 }
@@ -0,0 +1,10 @@
+/* バインドレステクスチャ (TextureManager::bindless_set) */
+#extension GL_EXT_nonuniform_qualifier : require
+#include "DescriptorSet.glsl"
+
+layout(set = SET_BINDLESS, binding = 0) uniform sampler2D textures[];
+
+vec4 sample_texture(uint index, vec2 uv)
+{
+    return texture(textures[nonuniformEXT(index)], uv);
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#ifndef DESCRIPTOR_SET_GLSL
+#define DESCRIPTOR_SET_GLSL
+/* デスクリプタセットの番号 (NEGUI2::DescriptorSetIndex と同じ値にすること) */
+#define SET_COMMON 0
+#define SET_BINDLESS 1
+#define SET_DRAW 2
+#endif
\ No newline at end of file
@@ -42,7 +42,7 @@ vec3 UnprojectPoint(float x, float y, float z, mat4 transform) {
 // normal vertice projection
 void main() {
     vec3 p = gridPlane[gl_VertexIndex].xyz;
-    pv = camera.projection * inverse(camera.view);
+    pv = camera.transform * push_constant.model_mat; // camera-relative like Mesh (model_mat carries the origin shift)
     nearPoint = UnprojectPoint(p.x, p.y, 0.0, pv).xyz; // unprojecting on the near plane
     farPoint = UnprojectPoint(p.x, p.y, 1.0, pv).xyz; // unprojecting on the far plane
     gl_Position = vec4(p, 1.0); // using directly the clipped coordinates
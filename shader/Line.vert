@@ -28,6 +28,9 @@ layout(location = 2) in vec4 color;
 layout(location = 3) in float diameter;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out int class_id;
+layout(location = 2) out int instance_id;
+layout(location = 3) out int primitive_id;
 
 void main() {
     vec3 inPosition = start;
@@ -36,6 +39,10 @@ void main() {
         inPosition = end;
     }
 
-    gl_Position = camera.transform * vec4(inPosition, 1.0);
+    gl_Position = camera.transform * push_constant.model_mat * vec4(inPosition, 1.0);
     outColor = color;
+
+    class_id = int(push_constant.class_id);
+    instance_id = int(push_constant.instance_id);
+    primitive_id = int(gl_InstanceIndex);
 }
\ No newline at end of file
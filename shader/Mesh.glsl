@@ -0,0 +1,62 @@
+/* Mesh.frag と MeshNoPrimitive.frag の共通部分 */
+#ifdef MESH_MATCAP
+/* 法線で引くマットキャップ (descriptorIndexing対応時のみ) */
+#include "Bindless.glsl"
+
+layout(push_constant) uniform MatcapBlock
+{
+    layout(offset = 80) uint texture_index; // sizeof(PushConstant) の後ろ. 0xFFFFFFFFなら陰影のみ
+} matcap;
+#endif
+
+layout(location  = 0) in vec3 inNormal;
+layout(location = 1) in flat int class_id;
+layout(location = 2) in flat int instance_id;
+layout(location = 3) in flat int vertex_id;
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out ivec4 outID;
+
+layout(std140, binding = 0) uniform Mouse
+{
+    float width;
+    float height;
+    float x;
+    float y;
+} mouse;
+
+layout(std140, binding = 1) uniform Camera
+{
+   mat4 transform;
+   mat4 projection;
+   mat4 view;
+   vec2 resolution;
+} camera;
+
+#include "Pick.glsl"
+
+void main() {
+    
+    const vec4 GRAY = vec4(0.6, 0.6, 0.6, 1.0);
+    const vec4 WHITE = vec4(1.0, 1.0, 1.0, 1.0);
+    
+    float  diffuse = dot(inNormal, vec3(0, 0, -1));
+
+    outColor = diffuse * WHITE + (1.0 - diffuse) * GRAY;
+#ifdef MESH_MATCAP
+    if (matcap.texture_index != 0xFFFFFFFFu)
+    {
+        outColor = sample_texture(matcap.texture_index, inNormal.xy * vec2(0.5, -0.5) + 0.5);
+    }
+#endif
+
+    /* 範囲選択用 (type, instance, primitive) */
+#ifdef MESH_NO_PRIMITIVE_ID
+    outID = ivec4(class_id, instance_id, 0, 1); // 三角形は区別できないのでメッシュ単位
+#else
+    outID = ivec4(class_id, instance_id, gl_PrimitiveID, 1);
+#endif
+
+    /* ピックデータ更新 */
+    write_pick(vec2(mouse.x, mouse.y), class_id, instance_id, vertex_id);
+}
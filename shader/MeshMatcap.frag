@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* バインドレス配列からマットキャップを引く */
+#define MESH_MATCAP
+#include "Mesh.glsl"
\ No newline at end of file
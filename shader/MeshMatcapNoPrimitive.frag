@@ -0,0 +1,7 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* マットキャップ + gl_PrimitiveIDを使わない */
+#define MESH_MATCAP
+#define MESH_NO_PRIMITIVE_ID
+#include "Mesh.glsl"
\ No newline at end of file
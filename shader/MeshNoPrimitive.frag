@@ -0,0 +1,6 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+/* geometryShader非対応のデバイス向け (gl_PrimitiveIDを使わない) */
+#define MESH_NO_PRIMITIVE_ID
+#include "Mesh.glsl"
\ No newline at end of file
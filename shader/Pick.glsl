@@ -0,0 +1,43 @@
+/* ピック候補の書き込み (Base/Mesh/Point/Lineで共通) */
+#define PICK_RADIUS 20.0
+#define PICK_CANDIDATE_MAX 4096
+
+struct PickCandidate
+{
+    int type;
+    int instance;
+    int vertex;
+    uint depth;
+};
+
+layout(std430, binding = 2) buffer PickData
+{
+    uint depth; // 最前面の深度 (floatBitsToUint)
+    uint count; // 書き込もうとした候補数 (上限超えを含む)
+    uint reserved0;
+    uint reserved1;
+    PickCandidate candidates[PICK_CANDIDATE_MAX];
+} pick_data;
+
+/*
+ * 深度のatomicMaxで最前面を決め, その時点で最前面だった断片だけを候補に追加する.
+ * 同じ深度の候補からの選択はCPU側で(type, instance, vertex)順に行うので結果は決定的.
+ * 原子操作はカーソル近傍の断片に限られる.
+ */
+void write_pick(vec2 mouse_pos, int type, int instance, int vertex)
+{
+    if (length(gl_FragCoord.xy - mouse_pos) >= PICK_RADIUS)
+        return;
+
+    /* 非負のfloatはビット列の大小関係がそのまま使える */
+    uint depth = floatBitsToUint(1.0 - gl_FragCoord.z);
+    uint front = atomicMax(pick_data.depth, depth);
+    if (depth < front)
+        return;
+
+    uint index = atomicAdd(pick_data.count, 1u);
+    if (index >= PICK_CANDIDATE_MAX)
+        return;
+
+    pick_data.candidates[index] = PickCandidate(type, instance, vertex, depth);
+}
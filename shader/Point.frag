@@ -1,11 +1,28 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location  = 0) in vec4 inColor;
+layout(location = 1) in flat int class_id;
+layout(location = 2) in flat int instance_id;
+layout(location = 3) in flat int primitive_id;
 
 layout(location = 0) out vec4 outColor;
 layout(location = 1) out ivec4 outID;
 
+layout(std140, binding = 0) uniform Mouse
+{
+    float width;
+    float height;
+    float x;
+    float y;
+} mouse;
+
+#include "Pick.glsl"
+
 void main() {
     outColor = inColor;
-    outID = ivec4(0, 0, 0, 1);
+    outID = ivec4(class_id, instance_id, primitive_id, 1);
+
+    /* ピックデータ更新 */
+    write_pick(vec2(mouse.x, mouse.y), class_id, instance_id, primitive_id);
 }
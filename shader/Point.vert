@@ -27,9 +27,16 @@ layout(location = 1) in vec4 color;
 layout(location = 2) in float diameter;
 
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out int class_id;
+layout(location = 2) out int instance_id;
+layout(location = 3) out int primitive_id;
 
 void main() {
-    gl_Position = camera.transform * vec4(inPosition, 1.0);
+    gl_Position = camera.transform * push_constant.model_mat * vec4(inPosition, 1.0);
     outColor = color;
+
+    class_id = int(push_constant.class_id);
+    instance_id = int(push_constant.instance_id);
+    primitive_id = int(gl_VertexIndex);
     gl_PointSize = 10.0;
 }
\ No newline at end of file
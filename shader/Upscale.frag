@@ -0,0 +1,46 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+
+layout(push_constant) uniform PushBlock
+{
+    vec2 uv_scale;  // 描画した領域 (描画解像度 / 出力解像度)
+    vec2 texel;     // 元画像の1画素 [uv]
+    float sharpness; // 0で拡大のみ
+} push_constant;
+
+layout(location = 0) in vec2 uv;
+layout(location = 0) out vec4 outColor;
+
+vec4 fetch(vec2 p)
+{
+    /* 描画していない領域を拾わないよう端で止める */
+    vec2 lower = 0.5 * push_constant.texel;
+    vec2 upper = push_constant.uv_scale - 0.5 * push_constant.texel;
+    return texture(source, clamp(p, lower, upper));
+}
+
+void main() {
+    vec2 p = uv * push_constant.uv_scale;
+    vec4 center = fetch(p);
+    if (push_constant.sharpness <= 0.0)
+    {
+        outColor = center;
+        return;
+    }
+
+    /* CAS: 十字近傍の明暗幅から局所的な重みを決め, 輪郭の強い所ほど弱く掛ける */
+    vec3 b = fetch(p + vec2(0.0, -push_constant.texel.y)).rgb;
+    vec3 d = fetch(p + vec2(-push_constant.texel.x, 0.0)).rgb;
+    vec3 f = fetch(p + vec2(push_constant.texel.x, 0.0)).rgb;
+    vec3 h = fetch(p + vec2(0.0, push_constant.texel.y)).rgb;
+    vec3 e = center.rgb;
+
+    vec3 lowest = min(min(min(b, d), min(f, h)), e);
+    vec3 highest = max(max(max(b, d), max(f, h)), e);
+    vec3 amplitude = sqrt(clamp(min(lowest, 1.0 - highest) / max(highest, vec3(1.0 / 65536.0)), 0.0, 1.0));
+    vec3 weight = amplitude * (-1.0 / mix(8.0, 5.0, clamp(push_constant.sharpness, 0.0, 1.0)));
+
+    vec3 color = (e + (b + d + f + h) * weight) / (1.0 + 4.0 * weight);
+    outColor = vec4(clamp(color, 0.0, 1.0), center.a);
+}
\ No newline at end of file
@@ -12,11 +12,12 @@
 #include "NEGUI2/ThreeD/Mesh.hpp"
 #include "Widget.hpp"
 #include <cmath>
+#include <spdlog/spdlog.h>
 
 namespace App
 {
     Scene::Scene(std::shared_ptr<entt::registry> registry)
-        : IModule(registry)
+        : IModule(registry), selecting_(false), selection_start_(Eigen::Vector2d::Zero())
     {
         Context context;
         context.direction = Eigen::Vector3d::Zero();
@@ -92,7 +93,7 @@ namespace App
         {
             uint32_t pixel_x;
             uint32_t pixel_y;
-            auto extent = core.off_screen.extent;
+            auto extent = core.off_screen.get_render_extent();
             pixel_x = std::round((uv.x() + 1.0) / 2.0 * static_cast<double>(extent.width));
             pixel_y = std::round((uv.y() + 1.0) / 2.0 * static_cast<double>(extent.height));
             pixel_x = std::clamp(pixel_x, 0u, static_cast<uint32_t>(extent.width));
@@ -100,24 +101,44 @@ namespace App
             core.three_d.camera().set_mouse(pixel_x, pixel_y);
         }
 
+        /* Ctrl+ドラッグで矩形選択 */
+        if (ImGui::GetIO().KeyCtrl && ImGui::IsMouseClicked(ImGuiMouseButton_Left, false))
+        {
+            selecting_ = true;
+            selection_start_ = uv;
+            return;
+        }
+        if (selecting_)
+        {
+            if (!ImGui::IsMouseReleased(ImGuiMouseButton_Left))
+                return;
+
+            selecting_ = false;
+            core.three_d.selection().select_rect(selection_start_, uv, [](const std::vector<NEGUI2::Selection::Id> &ids)
+                                                 { spdlog::info("Selected {} primitives", ids.size()); });
+            return;
+        }
+
         if (!ImGui::IsMouseClicked(ImGuiMouseButton_Left, false))
             return;
 
-        auto picked = core.three_d.pick(uv);
-        if(picked)
-        {
+        /* 結果はGPUの読み出し完了後 (数フレーム後) に届く */
+        core.three_d.pick_async(uv, [this](std::shared_ptr<NEGUI2::BaseDisplayObject> picked)
+                                {
+            if (!picked)
+                return;
+
             auto before = std::dynamic_pointer_cast<NEGUI2::BasePickable>(target_);
-            if(before)
+            if (before)
             {
                 before->set_display_aabb(false);
             }
             target_ = picked;
             auto after = std::dynamic_pointer_cast<NEGUI2::BasePickable>(target_);
-            if(after)
+            if (after)
             {
                 after->set_display_aabb();
-            }
-        }
+            } });
     }
 
     void Scene::handle_camera_()
@@ -152,8 +173,11 @@ namespace App
             position -= right;
 
         auto diff = ImGui::GetMouseDragDelta(ImGuiMouseButton_Left, 1.0);
-        position += diff.x * 0.1 * right;
-        position += diff.y * 0.1 * up;
+        if (!selecting_)
+        {
+            position += diff.x * 0.1 * right;
+            position += diff.y * 0.1 * up;
+        }
         ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
 
         position += ImGui::GetIO().MouseWheel * front;
@@ -164,7 +188,7 @@ namespace App
         auto transform = std::dynamic_pointer_cast<NEGUI2::BaseTransform>(target_);
         if (transform)
         {   
-            auto pos = transform->get_position();
+            Eigen::Vector3d pos = transform->get_world_transform().translation();
             core.three_d.camera().lookat(pos);
         }
     }
@@ -19,6 +19,8 @@ namespace App
         Context context_;
         std::shared_ptr<NEGUI2::BaseDisplayObject> target_;
         std::shared_ptr<NEGUI2::Point> point_;
+        bool selecting_;
+        Eigen::Vector2d selection_start_;
     public:
         void handle_camera_();
         public:
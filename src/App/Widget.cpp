@@ -2,6 +2,7 @@
 #include "Scene.hpp"
 #include <fstream>
 #include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/Core/Trace.hpp"
 #include "NEGUI2/ThreeD/Coordinate.hpp"
 #include "NEGUI2/ThreeD/Mesh.hpp"
 #include <imgui_impl_glfw.h>
@@ -82,7 +83,7 @@ namespace
 namespace App
 {
     Widget::Widget(std::shared_ptr<entt::registry> registry)
-        : IModule(registry), texture_id_(nullptr), show_coord_input_(false)
+        : IModule(registry), texture_id_(nullptr), show_coord_input_(false), profiler_panel_(), memory_panel_(), meshes_(), matcap_()
     {
     }
 
@@ -96,7 +97,7 @@ namespace App
         registry_->ctx().emplace<Context>(context);
         auto &core = NEGUI2::Core::get_instance();
 
-        texture_id_ = ImGui_ImplVulkan_AddTexture(*core.off_screen.sampler, *core.off_screen.frame.color_buffer_view, VK_IMAGE_LAYOUT_GENERAL);
+        texture_id_ = ImGui_ImplVulkan_AddTexture(*core.off_screen.sampler, *core.off_screen.present_buffer_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         ::setup_dock();
     }
 
@@ -119,6 +120,29 @@ namespace App
                 if (ImGui::MenuItem("Save as.."))
                 {
                 }
+                ImGui::Separator();
+                if (ImGui::MenuItem("Export Trace..", nullptr, false, NEGUI2::Trace::is_enabled()))
+                {
+                    auto path = pfd::save_file("Export Trace", "trace.json", {"Chrome Trace", "*.json"}).result();
+                    if (!path.empty())
+                    {
+                        NEGUI2::Trace::get_instance().write_chrome_trace(path);
+                    }
+                }
+                ImGui::EndMenu();
+            }
+            if (ImGui::BeginMenu("View"))
+            {
+                bool show_profiler = profiler_panel_.is_active();
+                if (ImGui::MenuItem("GPU Profiler", nullptr, &show_profiler))
+                {
+                    profiler_panel_.set_active(show_profiler);
+                }
+                bool show_memory = memory_panel_.is_active();
+                if (ImGui::MenuItem("GPU Memory", nullptr, &show_memory))
+                {
+                    memory_panel_.set_active(show_memory);
+                }
                 ImGui::EndMenu();
             }
             ImGui::EndMainMenuBar();
@@ -145,8 +169,43 @@ namespace App
             {
                 auto mesh = std::make_shared<NEGUI2::Mesh>();
                 mesh->load(path);
+                mesh->set_matcap(matcap_);
                 auto &core = NEGUI2::Core::get_instance();
                 core.three_d.add(mesh);
+                meshes_.push_back(mesh);
+            }
+        }
+        ImGui::SameLine();
+        if(ImGui::Button("Load\nMatcap", {size.y * 0.09f, size.y * 0.09f}))
+        {
+            auto f = pfd::open_file("Choose matcap image", "",
+                                    {"Image Files (.png .jpg)", "*.png *.jpg"});
+            if(!f.result().empty())
+            {
+                /* 読み込み完了までは陰影のみで描かれる */
+                matcap_ = f.result().front();
+                auto &texture_manager = NEGUI2::Core::get_instance().tm;
+                texture_manager.load_async(matcap_);
+                texture_manager.atlas.add_from_file(matcap_); // サムネイル用. max_entry_sizeを超えるものは入らない
+                for(auto& mesh : meshes_)
+                {
+                    mesh->set_matcap(matcap_);
+                }
+            }
+        }
+        if(!matcap_.empty())
+        {
+            /* サムネイルはアトラスのページから切り出す. 入らなかった大きな画像はテクスチャそのものを表示 */
+            auto &texture_manager = NEGUI2::Core::get_instance().tm;
+            auto region = texture_manager.atlas.get(matcap_);
+            VkDescriptorSet thumbnail = region ? texture_manager.get_imgui_texture(texture_manager.atlas.get_page_key(region->page))
+                                               : texture_manager.get_imgui_texture(matcap_);
+            if(thumbnail != VK_NULL_HANDLE)
+            {
+                ImVec2 uv0 = region ? ImVec2{region->u0, region->v0} : ImVec2{0.f, 0.f};
+                ImVec2 uv1 = region ? ImVec2{region->u1, region->v1} : ImVec2{1.f, 1.f};
+                ImGui::SameLine();
+                ImGui::Image(thumbnail, {size.y * 0.09f, size.y * 0.09f}, uv0, uv1);
             }
         }
         ImGui::SameLine();
@@ -160,7 +219,10 @@ namespace App
         /* Scene Window */
         ImGui::Begin("Texture Demo", nullptr);
         ImVec2 viewportPanelSize = ImGui::GetContentRegionAvail();
-        ImGui::Image(texture_id_, ImVec2{viewportPanelSize.x, viewportPanelSize.y});
+        {
+            /* 動的解像度の描画領域は出力解像度へ拡大済み */
+            ImGui::Image(texture_id_, ImVec2{viewportPanelSize.x, viewportPanelSize.y});
+        }
 
         auto is_scene_focused = ImGui::IsWindowFocused();
         auto scene_size = ImGui::GetWindowSize();
@@ -181,6 +243,27 @@ namespace App
             ImGui::Text("%lf, %lf", scene_size.x, scene_size.y);
             ImGui::Text("%lf, %lf", scene_position.x, scene_position.y);
 
+            {
+                auto &off_screen = NEGUI2::Core::get_instance().off_screen;
+                auto render_extent = off_screen.get_render_extent();
+                ImGui::Checkbox("Dynamic Resolution", &off_screen.dynamic_resolution);
+                ImGui::Text("GPU %.3f ms, Scale %.2f (%u x %u)", off_screen.gpu_frame_time_ms, off_screen.render_scale,
+                            render_extent.width, render_extent.height);
+                float target_ms = static_cast<float>(off_screen.target_frame_time_ms);
+                if (ImGui::SliderFloat("Target [ms]", &target_ms, 4.f, 50.f))
+                {
+                    off_screen.target_frame_time_ms = target_ms;
+                }
+                float min_scale = static_cast<float>(off_screen.min_render_scale);
+                float max_scale = static_cast<float>(off_screen.max_render_scale);
+                if (ImGui::DragFloatRange2("Scale", &min_scale, &max_scale, 0.01f, 0.25f, 1.f))
+                {
+                    off_screen.min_render_scale = min_scale;
+                    off_screen.max_render_scale = max_scale;
+                }
+                ImGui::SliderFloat("Sharpness", &off_screen.sharpness, 0.f, 1.f);
+            }
+
             {
                 auto position = registry_->ctx().get<Scene::Context>().position;
                 auto direction = registry_->ctx().get<Scene::Context>().direction;
@@ -231,7 +314,6 @@ namespace App
             if (ImGui::Button("CANCEL"))
             {
                 auto &core = NEGUI2::Core::get_instance();
-                core.wait_idle();
                 core.three_d.erase(coord);
                 coord = nullptr;
                 show_coord_input_ = false;
@@ -239,5 +321,8 @@ namespace App
 
             ImGui::End();
         }
+
+        profiler_panel_.update();
+        memory_panel_.update();
     }
 }
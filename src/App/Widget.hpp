@@ -1,16 +1,27 @@
 #ifndef _WIDGET_HPP
 #define _WIDGET_HPP
 #include "IModule.hpp"
+#include "NEGUI2/Ui/ProfilerPanel.hpp"
+#include "NEGUI2/Ui/MemoryPanel.hpp"
 #include <vulkan/vulkan.h>
 #include <Eigen/Dense>
 #include <vector>
 #include <string>
+#include <memory>
+namespace NEGUI2
+{
+    class Mesh;
+}
 namespace App
 {
     class Widget : public IModule
     {
         VkDescriptorSet texture_id_;
         bool show_coord_input_;
+        NEGUI2::ProfilerPanel profiler_panel_;
+        NEGUI2::MemoryPanel memory_panel_;
+        std::vector<std::shared_ptr<NEGUI2::Mesh>> meshes_; // 読み込んだモデル
+        std::string matcap_;
         public:
         struct Context
         {
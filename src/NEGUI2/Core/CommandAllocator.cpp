@@ -0,0 +1,131 @@
+#include "NEGUI2/Core/CommandAllocator.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/Core/Trace.hpp"
+#include <algorithm>
+
+namespace NEGUI2
+{
+    CommandAllocator::CommandAllocator()
+        : mutex_(), current_(), pools_(), submitted_(), free_(), owners_(), statistics_()
+    {
+    }
+
+    CommandAllocator::~CommandAllocator()
+    {
+    }
+
+    CommandAllocator::Pool *CommandAllocator::take_pool_()
+    {
+        if (!free_.empty())
+        {
+            auto pool = free_.back();
+            free_.pop_back();
+            return pool;
+        }
+
+        NEGUI2_TRACE_SCOPE("CommandAllocator::create_pool");
+        auto &gpu = Core::get_instance().gpu;
+        vk::CommandPoolCreateInfo create_info;
+        create_info.setQueueFamilyIndex(gpu.graphics_queue_index).setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+        pools_.push_back(std::make_unique<Pool>(Pool{gpu.device.createCommandPool(create_info), {}, {0u, 0u}, 0u, false, 0u}));
+        statistics_.pools_created++;
+        return pools_.back().get();
+    }
+
+    vk::raii::CommandBuffer &CommandAllocator::acquire(const vk::CommandBufferLevel &level)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &pool = current_[std::this_thread::get_id()];
+        if (pool == nullptr)
+        {
+            pool = take_pool_();
+        }
+
+        /* リセット済みのバッファがあれば再利用 */
+        size_t slot = level == vk::CommandBufferLevel::ePrimary ? 0u : 1u;
+        auto &buffers = pool->buffers[slot];
+        auto &used = pool->used[slot];
+        if (used == buffers.size())
+        {
+            NEGUI2_TRACE_SCOPE("CommandAllocator::allocate");
+            vk::CommandBufferAllocateInfo alloc_info;
+            alloc_info.setCommandPool(*pool->pool).setLevel(level).setCommandBufferCount(1u);
+            auto &gpu = Core::get_instance().gpu;
+            buffers.push_back(std::move(gpu.device.allocateCommandBuffers(alloc_info).front()));
+            owners_[static_cast<VkCommandBuffer>(*buffers.back())] = pool;
+            statistics_.allocated++;
+        }
+
+        pool->outstanding++;
+        statistics_.acquired++;
+        return buffers[used++];
+    }
+
+    void CommandAllocator::retire(const vk::raii::CommandBuffer &command_buffer, const uint64_t &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = owners_.find(static_cast<VkCommandBuffer>(*command_buffer));
+        if (it == owners_.end())
+            return;
+
+        /* 提出したプールには以降積まない. 記録中の他のバッファが残っていれば提出を待つ */
+        auto pool = it->second;
+        pool->value = std::max(pool->value, value);
+        pool->outstanding--;
+        if (!pool->closed)
+        {
+            pool->closed = true;
+            for (auto &current : current_)
+            {
+                if (current.second == pool)
+                    current.second = nullptr;
+            }
+        }
+        if (pool->outstanding == 0u)
+        {
+            submitted_.push_back(pool);
+        }
+    }
+
+    void CommandAllocator::recycle(const uint64_t &completed_value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = submitted_.begin(); it != submitted_.end();)
+        {
+            auto pool = *it;
+            if (pool->value > completed_value)
+            {
+                ++it;
+                continue;
+            }
+
+            /* プール単位でまとめてリセット (バッファは割当済みのまま残る) */
+            {
+                NEGUI2_TRACE_SCOPE("CommandAllocator::reset");
+                pool->pool.reset({});
+            }
+            pool->used = {0u, 0u};
+            pool->closed = false;
+            pool->value = 0u;
+            statistics_.pool_resets++;
+            free_.push_back(pool);
+            it = submitted_.erase(it);
+        }
+    }
+
+    void CommandAllocator::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_.clear();
+        submitted_.clear();
+        free_.clear();
+        owners_.clear();
+        pools_.clear();
+    }
+
+    CommandAllocator::Statistics CommandAllocator::get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef _COMMAND_ALLOCATOR_HPP
+#define _COMMAND_ALLOCATOR_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace NEGUI2
+{
+    /* スレッド毎のコマンドプールを提出値の完了後にまとめてリセットして使い回す */
+    class CommandAllocator
+    {
+        friend class DeviceManager;
+
+    public:
+        struct Statistics
+        {
+            uint64_t acquired;       // 取得したコマンドバッファ数
+            uint64_t allocated;      // 新規に割り当てた数 (残りは再利用)
+            uint64_t pools_created;
+            uint64_t pool_resets;
+        };
+
+    private:
+        struct Pool
+        {
+            vk::raii::CommandPool pool;
+            std::array<std::deque<vk::raii::CommandBuffer>, 2> buffers; // プライマリ, セカンダリ (参照を保つためdeque)
+            std::array<size_t, 2> used;
+            uint32_t outstanding; // 取得済みで未提出の数
+            bool closed;          // 提出済み (以降は取得しない)
+            uint64_t value;       // 含まれるコマンドの最大提出値
+        };
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::thread::id, Pool *> current_; // スレッド毎の記録先
+        std::vector<std::unique_ptr<Pool>> pools_;
+        std::deque<Pool *> submitted_;
+        std::vector<Pool *> free_;
+        std::unordered_map<VkCommandBuffer, Pool *> owners_;
+        Statistics statistics_;
+
+        CommandAllocator();
+        CommandAllocator(const CommandAllocator &other) = delete;
+        CommandAllocator &operator=(const CommandAllocator &other) = delete;
+        Pool *take_pool_();
+
+    public:
+        ~CommandAllocator();
+
+        vk::raii::CommandBuffer &acquire(const vk::CommandBufferLevel &level = vk::CommandBufferLevel::ePrimary);
+        void retire(const vk::raii::CommandBuffer &command_buffer, const uint64_t &value); // 提出後に呼ぶ
+        void recycle(const uint64_t &completed_value);                                     // 完了したプールをリセット
+        void clear();
+        Statistics get_statistics() const;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,16 +1,20 @@
 #include "NEGUI2/Core/Core.hpp"
 #include "NEGUI2/ThreeD/BasePickable.hpp"
+#include "NEGUI2/Core/Trace.hpp"
 #include <spdlog/spdlog.h>
 #include <imgui.h>
+#include <algorithm>
 
 namespace NEGUI2 {
-    Core::Core() : initialized_(false), gpu(), mm(), screen(),
-    off_screen(), three_d()
+    Core::Core() : initialized_(false), render_extent_(), scene_frames_(1u), ui_frames_(UI_SETTLE_FRAMES), upload_serial_(0u),
+    scene_rendered_(false), recording_(false), profiler_slot_values_(), gpu(), mm(), screen(), off_screen(), three_d(), idle_wait(true), idle_timeout(0.5)
     {
     }
 
     Core::~Core()
     {
+        /* 遅延破棄を各マネージャが生きている間に済ませる */
+        wait_idle();
         shader.destroy();
     }
 
@@ -20,7 +24,9 @@ namespace NEGUI2 {
         window.init();
         gpu.init();
         mm.init();
+        frame_allocator.init();
         screen.init();
+        profiler.init();
         off_screen.init();
         tm.init();
         imgui.init();
@@ -45,19 +51,37 @@ namespace NEGUI2 {
     }
     void Core::update()
     {
-        glfwPollEvents();
-
-        static uint32_t command_index = 0;
-        command_index = (command_index + 1) % 4;
-        vk::raii::CommandBuffer& command_buffer = screen.command_buffers[command_index];
+        NEGUI2_TRACE_SCOPE("Core::update");
+        {
+            /* 何も変化が無ければ入力かタイムアウトまで休む */
+            if (idle_wait && is_idle_())
+            {
+                NEGUI2_TRACE_SCOPE("idleWait");
+                glfwWaitEventsTimeout(idle_timeout);
+            }
+            else
+            {
+                NEGUI2_TRACE_SCOPE("glfwPollEvents");
+                glfwPollEvents();
+            }
+        }
+        if (window.consume_input())
+        {
+            request_redraw();
+        }
 
         if(screen.swap_chain_rebuild)
         {
             screen.rebuild();
+            request_redraw();
         }
 
         auto& image_acqurired_semaphore = screen.sync_objects[screen.semaphore_index].image_acquired_semaphore;
-        auto image_err = screen.swap_chain.acquireNextImage(UINT64_MAX, *image_acqurired_semaphore, nullptr);
+        std::pair<vk::Result, uint32_t> image_err;
+        {
+            NEGUI2_TRACE_SCOPE("acquireNextImage");
+            image_err = screen.swap_chain.acquireNextImage(UINT64_MAX, *image_acqurired_semaphore, nullptr);
+        }
         auto frame_index = image_err.second;
         if(image_err.first == vk::Result::eErrorOutOfDateKHR || image_err.first == vk::Result::eSuboptimalKHR)
         {
@@ -66,62 +90,174 @@ namespace NEGUI2 {
         }
 
         {
-            auto wait_err = gpu.device.waitForFences({*screen.frames[frame_index].fence}, true, UINT64_MAX);
-            if(wait_err != vk::Result::eSuccess)
-            {
-                spdlog::error("Fence wait error");
-            }
+            /* このイメージを前回使った提出の完了のみ待つ */
+            NEGUI2_TRACE_SCOPE("waitTimeline");
+            gpu.wait(screen.frames[frame_index].submit_value);
+        }
+
+        /* クエリスロットはイメージ毎に固定. 前回の使用は上の待機で完了済み (イメージ数が多い時だけ追加で待つ) */
+        auto profiler_slot = frame_index % GpuProfiler::SLOT_COUNT;
+        gpu.wait(profiler_slot_values_[profiler_slot]);
 
-            gpu.device.resetFences({*screen.frames[frame_index].fence});
+        gpu.commands.recycle(gpu.get_completed_value());
+        gpu.descriptors.recycle(gpu.get_completed_value());
+        frame_allocator.recycle(gpu.get_completed_value());
+        mm.process_releases();
+        mm.update_budget();
+        if (is_idle_())
+        {
+            /* デフラグのコピーは操作中のフレームに割り込ませない */
+            mm.defragment_step();
         }
+        tm.update();
+        three_d.resolve_pick(frame_index);
 
+        /* 完了済みのプールから取得 (途中で戻らないよう待機の後) */
+        vk::raii::CommandBuffer& command_buffer = gpu.commands.acquire();
         {
             command_buffer.begin({{vk::CommandBufferUsageFlagBits::eOneTimeSubmit}});
+            recording_ = true;
         }
 
+        /* 動的解像度 */
         {
-            vk::RenderPassBeginInfo begin_info;
-            begin_info.setRenderPass(*off_screen.render_pass)
-            .setFramebuffer(*off_screen.frame.frame_buffer)
-            .setRenderArea({{0, 0}, {off_screen.extent}})
-            .setClearValueCount(3).setPClearValues(off_screen.clear_value.data());
-
-            command_buffer.beginRenderPass(begin_info,
-                                           vk::SubpassContents::eInline);
-            
-            three_d.update(command_buffer);
-            command_buffer.endRenderPass();
+            /* 回収したフレームがシーンを描いていなければ値は無い (古い値で制御しない) */
+            profiler.begin_frame(command_buffer, profiler_slot);
+            auto gpu_ms = profiler.get_resolved("OffScreen");
+            if (gpu_ms)
+            {
+                off_screen.update_render_scale(*gpu_ms);
+            }
+            auto render_extent = off_screen.get_render_extent();
+            if (render_extent != render_extent_)
+            {
+                render_extent_ = render_extent;
+                three_d.camera().set_extent(render_extent_);
+                three_d.camera().upload();
+            }
+        }
+
+        /* パスを宣言し, バリアとレイアウト遷移はRenderGraphに任せる */
+        graph.reset();
+        auto color = graph.import_image("OffScreenColor", off_screen.frame.color_buffer, vk::ImageAspectFlagBits::eColor);
+        auto pick = graph.import_image("OffScreenPick", off_screen.frame.pick_buffer, vk::ImageAspectFlagBits::eColor);
+        vk::ImageAspectFlags depth_aspect = vk::ImageAspectFlagBits::eDepth;
+        if (off_screen.depth_format == vk::Format::eD32SfloatS8Uint || off_screen.depth_format == vk::Format::eD24UnormS8Uint)
+            depth_aspect |= vk::ImageAspectFlagBits::eStencil;
+        /* 深度はOffScreenパスの中だけで使うので一時イメージ (寿命が重ならなければメモリを共有) */
+        auto depth = graph.create_image("OffScreenDepth", RenderGraph::ImageDesc{off_screen.depth_format, off_screen.extent,
+                                                                                vk::ImageUsageFlagBits::eDepthStencilAttachment, depth_aspect});
+        auto present = graph.import_image("OffScreenPresent", off_screen.present_buffer, vk::ImageAspectFlagBits::eColor);
+        auto back_buffer = graph.import_image("BackBuffer", screen.frames[frame_index].color_buffer, vk::ImageAspectFlagBits::eColor,
+                                              vk::ImageLayout::eUndefined, vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        graph.set_final_layout(back_buffer, vk::ImageLayout::ePresentSrcKHR);
+
+        /* 変化が無ければ前回のオフスクリーン画像をそのまま使う */
+        scene_rendered_ = scene_frames_ != 0u || mm.get_upload_serial() != upload_serial_ || three_d.needs_render();
+        if (scene_rendered_)
+        {
+            graph.add_pass("OffScreen", [&](RenderGraph::PassBuilder &pass)
+                           {
+                pass.write(color, RenderGraph::ACCESS::COLOR_ATTACHMENT).write(pick, RenderGraph::ACCESS::COLOR_ATTACHMENT)
+                    .write(depth, RenderGraph::ACCESS::DEPTH_ATTACHMENT); },
+                           [&](vk::raii::CommandBuffer &command_buffer)
+                           {
+                three_d.begin_pick(command_buffer);
+                profiler.begin_statistics(command_buffer);
+                profiler.begin_scope(command_buffer, "OffScreen");
+
+                off_screen.begin_rendering(command_buffer, render_extent_, graph.get_view(depth));
+
+                vk::Viewport viewport(0.f, 0.f, static_cast<float>(render_extent_.width), static_cast<float>(render_extent_.height), 0.f, 1.f);
+                vk::Rect2D scissor({0, 0}, render_extent_);
+                command_buffer.setViewport(0, viewport);
+                command_buffer.setScissor(0, scissor);
+
+                {
+                    NEGUI2_TRACE_SCOPE("ThreeD::update");
+                    three_d.update(command_buffer);
+                }
+                off_screen.end_rendering(command_buffer);
+
+                profiler.end_scope(command_buffer);
+                profiler.end_statistics(command_buffer); });
+
+            /* 読み出し要求が無ければ省く */
+            graph.add_pass("Pick", [&](RenderGraph::PassBuilder &pass)
+                           {
+                pass.read(pick, RenderGraph::ACCESS::STORAGE_READ);
+                if (three_d.needs_render())
+                    pass.side_effect(); },
+                           [&](vk::raii::CommandBuffer &command_buffer)
+                           { three_d.end_pick(command_buffer, frame_index); });
+
+            /* 描画した領域を出力解像度へ拡大 (縮小描画時は鮮鋭化) */
+            graph.add_pass("Upscale", [&](RenderGraph::PassBuilder &pass)
+                           { pass.read(color, RenderGraph::ACCESS::SAMPLED).write(present, RenderGraph::ACCESS::COLOR_ATTACHMENT); },
+                           [&](vk::raii::CommandBuffer &command_buffer)
+                           {
+                profiler.begin_scope(command_buffer, "Upscale");
+                off_screen.upscale(command_buffer, render_extent_);
+                profiler.end_scope(command_buffer); });
         }
 
         // TODO 型のエラーintをuint32_tに変換
+        graph.add_pass("ImGui", [&](RenderGraph::PassBuilder &pass)
+                       { pass.read(present, RenderGraph::ACCESS::SAMPLED).write(back_buffer, RenderGraph::ACCESS::COLOR_ATTACHMENT); },
+                       [&](vk::raii::CommandBuffer &command_buffer)
+                       {
+            profiler.begin_scope(command_buffer, "ImGui");
+
+            screen.begin_rendering(command_buffer, frame_index);
+            {
+                NEGUI2_TRACE_SCOPE("ImGuiManager::update");
+                imgui.update(command_buffer);
+            }
+            screen.end_rendering(command_buffer);
+
+            profiler.end_scope(command_buffer); });
+
+        graph.compile();
+        graph.execute(command_buffer);
+
+        if (scene_rendered_)
         {
-            vk::RenderPassBeginInfo begin_info;
-            begin_info.setRenderPass(*screen.render_pass)
-            .setFramebuffer(*screen.frames[frame_index].frame_buffer)
-            .setRenderArea({{0, 0}, {screen.extent}})
-            .setClearValueCount(1).setPClearValues(&screen.clear_value);
-
-            command_buffer.beginRenderPass(begin_info,
-                                           vk::SubpassContents::eInline);
-            imgui.update(command_buffer);
-            command_buffer.endRenderPass();
+            /* 描画中の書き込みは次フレームの再描画要求にしない */
+            upload_serial_ = mm.get_upload_serial();
+            scene_frames_ = scene_frames_ == 0u ? 0u : scene_frames_ - 1u;
+            tm.advance_frame_(); // 描画しないフレームではテクスチャの未使用期間を数えない
         }
 
         command_buffer.end();
 
+        /* このフレームのマップ書き込みをまとめてフラッシュ */
+        mm.flush_memory();
+        frame_allocator.flush();
+
         auto& image_rendered_semaphore = screen.sync_objects[screen.semaphore_index].image_rendered_semaphore;
         vk::SubmitInfo info;
         vk::PipelineStageFlags flags = vk::PipelineStageFlagBits::eColorAttachmentOutput;
         info.setWaitSemaphores(*image_acqurired_semaphore).setWaitDstStageMask(flags)
             .setCommandBufferCount(1).setPCommandBuffers(&*command_buffer)
             .setSignalSemaphoreCount(1).setPSignalSemaphores(&*image_rendered_semaphore);
-        gpu.graphics_queue.submit({info}, *screen.frames[frame_index].fence);
+        {
+            NEGUI2_TRACE_SCOPE("submit");
+            screen.frames[frame_index].submit_value = gpu.submit(info);
+            gpu.commands.retire(command_buffer, screen.frames[frame_index].submit_value);
+            profiler_slot_values_[profiler_slot] = screen.frames[frame_index].submit_value;
+            recording_ = false;
+        }
+        /* 記録中に要求された破棄とフレーム用セットはこのフレームの完了後 */
+        mm.seal_releases(screen.frames[frame_index].submit_value);
+        gpu.descriptors.seal(screen.frames[frame_index].submit_value);
+        frame_allocator.seal(screen.frames[frame_index].submit_value);
 
         vk::PresentInfoKHR present_info;
         present_info.setWaitSemaphoreCount(1).setPWaitSemaphores(&*image_rendered_semaphore)
                     .setSwapchainCount(1).setPSwapchains(&*screen.swap_chain).setPImageIndices(&frame_index);
         
         try {
+             NEGUI2_TRACE_SCOPE("presentKHR");
              auto present_err = gpu.present_queue.presentKHR(present_info);
         } catch(const vk::OutOfDateKHRError& error)
         {
@@ -130,10 +266,34 @@ namespace NEGUI2 {
         }
 
         screen.semaphore_index = (screen.semaphore_index + 1) % screen.image_count;
+        ui_frames_ = ui_frames_ == 0u ? 0u : ui_frames_ - 1u;
+    }
+
+    void Core::invalidate()
+    {
+        scene_frames_ = std::max(scene_frames_, 1u);
+        request_redraw();
+    }
+
+    void Core::request_redraw(const uint32_t &frames)
+    {
+        ui_frames_ = std::max(ui_frames_, frames);
     }
 
     void Core::wait_idle()
     {
-        gpu.device.waitIdle();
+        gpu.wait(gpu.get_submitted_value());
+        mm.seal_releases(gpu.get_submitted_value());
+        mm.process_releases();
+    }
+
+    bool Core::is_recording() const
+    {
+        return recording_;
+    }
+
+    bool Core::is_idle_() const
+    {
+        return scene_frames_ == 0u && ui_frames_ == 0u && mm.get_upload_serial() == upload_serial_ && !three_d.is_busy();
     }
 }
\ No newline at end of file
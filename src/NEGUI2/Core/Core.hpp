@@ -8,8 +8,12 @@
 #include "NEGUI2/Core/TextureManager.hpp"
 #include "NEGUI2/Core/ImGuiManager.hpp"
 #include "NEGUI2/Core/Shader.hpp"
+#include "NEGUI2/Core/GpuProfiler.hpp"
+#include "NEGUI2/Core/RenderGraph.hpp"
+#include "NEGUI2/Core/FrameAllocator.hpp"
 #include "NEGUI2/ThreeD/BaseDisplayObject.hpp"
 #include "NEGUI2/ThreeD/ThreeD.hpp"
+#include <array>
 #include <memory>
 
 namespace NEGUI2
@@ -17,11 +21,21 @@ namespace NEGUI2
     class Core
     {
         bool initialized_;
+        vk::Extent2D render_extent_;
+
+        /* 変化が無いフレームは描画を省く */
+        uint32_t scene_frames_;  // シーンを描き直す残りフレーム
+        uint32_t ui_frames_;     // UIのみ描き直す残りフレーム
+        uint64_t upload_serial_; // 前回シーンを描いた時点の転送回数
+        bool scene_rendered_;
+        bool recording_; // フレームのコマンド記録中
+        std::array<uint64_t, GpuProfiler::SLOT_COUNT> profiler_slot_values_; // クエリスロットを最後に使った提出値
 
         Core();
         void init();
         Core(const Core& other) = delete;
         Core& operator=(const Core& other) = delete;
+        bool is_idle_() const; // 再描画も転送も無い
     public:
         ~Core();
         static Core &get_instance();
@@ -35,7 +49,16 @@ namespace NEGUI2
         ImGuiManager imgui;
         ThreeD three_d;
         Shader shader;
+        GpuProfiler profiler;
+        RenderGraph graph;
+        FrameAllocator frame_allocator; // フレーム内だけ使う描画データ
 
+        static constexpr uint32_t UI_SETTLE_FRAMES = 3u; // 入力後にImGuiが落ち着くまで
+        bool idle_wait;      // 変化が無い間はイベント待ちで休む
+        double idle_timeout; // 休止中にUIを描く間隔 [s]
+        void invalidate();   // シーンの再描画を要求
+        void request_redraw(const uint32_t &frames = UI_SETTLE_FRAMES); // UIのみの再描画を要求
+        bool is_recording() const;
         bool should_close();
         void update();
         void wait_idle();
@@ -0,0 +1,197 @@
+#include "NEGUI2/Core/DescriptorAllocator.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/Core/Trace.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    constexpr uint32_t INITIAL_SETS_PER_POOL = 64u;
+    constexpr uint32_t MAX_SETS_PER_POOL = 4096u;
+
+    /* セット当たりの種類毎の記述子数 */
+    const std::array<std::pair<vk::DescriptorType, float>, 6> POOL_RATIOS = {{
+        {vk::DescriptorType::eUniformBuffer, 2.f},
+        {vk::DescriptorType::eUniformBufferDynamic, 1.f},
+        {vk::DescriptorType::eStorageBuffer, 4.f},
+        {vk::DescriptorType::eStorageImage, 1.f},
+        {vk::DescriptorType::eCombinedImageSampler, 1.f},
+        {vk::DescriptorType::eSampledImage, 1.f},
+    }};
+}
+
+namespace NEGUI2
+{
+    DescriptorAllocator::DescriptorAllocator()
+        : mutex_(), persistent_(), current_(), submitted_(), free_(), layouts_(),
+          sets_per_pool_(INITIAL_SETS_PER_POOL), statistics_()
+    {
+    }
+
+    DescriptorAllocator::~DescriptorAllocator()
+    {
+    }
+
+    vk::raii::DescriptorPool DescriptorAllocator::create_pool_()
+    {
+        NEGUI2_TRACE_SCOPE("DescriptorAllocator::create_pool");
+        std::vector<vk::DescriptorPoolSize> pool_sizes;
+        for (const auto &ratio : POOL_RATIOS)
+        {
+            pool_sizes.emplace_back(ratio.first, static_cast<uint32_t>(ratio.second * static_cast<float>(sets_per_pool_)));
+        }
+
+        vk::DescriptorPoolCreateInfo pool_info;
+        pool_info.setMaxSets(sets_per_pool_).setPoolSizes(pool_sizes);
+        auto pool = Core::get_instance().gpu.device.createDescriptorPool(pool_info);
+
+        /* 足りなくなる度に大きくする */
+        sets_per_pool_ = std::min(sets_per_pool_ * 2u, MAX_SETS_PER_POOL);
+        statistics_.pools_created++;
+        return pool;
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate_(std::vector<Pool> &pools, const vk::DescriptorSetLayout &layout, const bool &transient)
+    {
+        auto next_pool = [&]()
+        {
+            if (transient && !free_.empty())
+            {
+                pools.push_back(std::move(free_.back()));
+                free_.pop_back();
+                return;
+            }
+            pools.push_back(Pool{create_pool_(), 0u});
+        };
+
+        if (pools.empty())
+        {
+            next_pool();
+        }
+
+        auto &device = Core::get_instance().gpu.device;
+        for (int retry = 0; retry < 2; retry++)
+        {
+            vk::DescriptorSetAllocateInfo alloc_info;
+            alloc_info.setDescriptorPool(*pools.back().pool).setSetLayouts(layout);
+            try
+            {
+                auto descriptors = device.allocateDescriptorSets(alloc_info);
+                /* 個別には解放せずプールごと破棄/リセットする */
+                return descriptors.front().release();
+            }
+            catch (const vk::OutOfPoolMemoryError &)
+            {
+                next_pool();
+            }
+            catch (const vk::FragmentedPoolError &)
+            {
+                next_pool();
+            }
+        }
+
+        spdlog::error("Failed to allocate descriptor set from a new pool");
+        return nullptr;
+    }
+
+    size_t DescriptorAllocator::hash_(const std::vector<vk::DescriptorSetLayoutBinding> &bindings)
+    {
+        size_t seed = bindings.size();
+        auto combine = [&seed](const size_t &value)
+        { seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2); };
+        for (const auto &binding : bindings)
+        {
+            combine(binding.binding);
+            combine(static_cast<size_t>(binding.descriptorType));
+            combine(binding.descriptorCount);
+            combine(static_cast<size_t>(static_cast<VkShaderStageFlags>(binding.stageFlags)));
+        }
+        return seed;
+    }
+
+    bool DescriptorAllocator::equal_(const std::vector<vk::DescriptorSetLayoutBinding> &a, const std::vector<vk::DescriptorSetLayoutBinding> &b)
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const vk::DescriptorSetLayoutBinding &x, const vk::DescriptorSetLayoutBinding &y)
+                          { return x.binding == y.binding && x.descriptorType == y.descriptorType &&
+                                   x.descriptorCount == y.descriptorCount && x.stageFlags == y.stageFlags; });
+    }
+
+    vk::DescriptorSetLayout DescriptorAllocator::get_layout(const std::vector<vk::DescriptorSetLayoutBinding> &bindings)
+    {
+        /* 宣言順に依らないようバインディング番号で並べる */
+        auto sorted = bindings;
+        std::sort(sorted.begin(), sorted.end(), [](const vk::DescriptorSetLayoutBinding &a, const vk::DescriptorSetLayoutBinding &b)
+                  { return a.binding < b.binding; });
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &entries = layouts_[hash_(sorted)];
+        for (const auto &entry : entries)
+        {
+            if (equal_(entry.bindings, sorted))
+                return *entry.layout;
+        }
+
+        vk::DescriptorSetLayoutCreateInfo create_info;
+        create_info.setBindings(sorted);
+        entries.push_back(Layout{sorted, Core::get_instance().gpu.device.createDescriptorSetLayout(create_info)});
+        statistics_.layouts++;
+        return *entries.back().layout;
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(const vk::DescriptorSetLayout &layout)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_.allocated++;
+        return allocate_(persistent_, layout, false);
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate_transient(const vk::DescriptorSetLayout &layout)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        statistics_.transient++;
+        return allocate_(current_, layout, true);
+    }
+
+    void DescriptorAllocator::seal(const uint64_t &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &pool : current_)
+        {
+            pool.value = value;
+            submitted_.push_back(std::move(pool));
+        }
+        current_.clear();
+    }
+
+    void DescriptorAllocator::recycle(const uint64_t &completed_value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        /* 提出順に並んでいるので先頭から */
+        while (!submitted_.empty() && submitted_.front().value <= completed_value)
+        {
+            auto &pool = submitted_.front();
+            pool.pool.reset();
+            pool.value = 0u;
+            statistics_.pool_resets++;
+            free_.push_back(std::move(pool));
+            submitted_.pop_front();
+        }
+    }
+
+    void DescriptorAllocator::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_.clear();
+        submitted_.clear();
+        free_.clear();
+        persistent_.clear();
+        layouts_.clear();
+    }
+
+    DescriptorAllocator::Statistics DescriptorAllocator::get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef _DESCRIPTOR_ALLOCATOR_HPP
+#define _DESCRIPTOR_ALLOCATOR_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace NEGUI2
+{
+    /* デスクリプタセットの番号の割り振り. シェーダ側は shader/DescriptorSet.glsl で同じ値を使う.
+       COMMON   : DeviceManager::descriptor_set (マウス/カメラ/ピック)
+       BINDLESS : TextureManager::bindless_set (Bindless.glsl)
+       DRAW     : FrameAllocator の描画毎の動的ユニフォームバッファ
+       途中の番号を使わないパイプラインも, 空のレイアウト (get_layout({})) で番号を詰めずに埋める */
+    struct DescriptorSetIndex
+    {
+        static constexpr uint32_t COMMON = 0u;
+        static constexpr uint32_t BINDLESS = 1u;
+        static constexpr uint32_t DRAW = 2u;
+    };
+
+    /* 足りなくなればプールを追加する. フレーム用のセットは提出値の完了後にプールごとリセット */
+    class DescriptorAllocator
+    {
+        friend class DeviceManager;
+
+    public:
+        struct Statistics
+        {
+            uint64_t allocated;      // 永続セット数
+            uint64_t transient;      // フレーム用セット数
+            uint64_t pools_created;
+            uint64_t pool_resets;
+            uint64_t layouts;
+        };
+
+    private:
+        struct Pool
+        {
+            vk::raii::DescriptorPool pool;
+            uint64_t value; // 含まれるセットを使った提出値
+        };
+
+        struct Layout
+        {
+            std::vector<vk::DescriptorSetLayoutBinding> bindings;
+            vk::raii::DescriptorSetLayout layout;
+        };
+
+        mutable std::mutex mutex_;
+        std::vector<Pool> persistent_;                           // 末尾から割当
+        std::vector<Pool> current_;                              // 記録中のフレーム用 (末尾から割当)
+        std::deque<Pool> submitted_;                             // 完了待ち
+        std::vector<Pool> free_;                                 // リセット済み
+        std::unordered_map<size_t, std::vector<Layout>> layouts_; // バインディングのハッシュ毎
+        uint32_t sets_per_pool_;
+        Statistics statistics_;
+
+        DescriptorAllocator();
+        DescriptorAllocator(const DescriptorAllocator &other) = delete;
+        DescriptorAllocator &operator=(const DescriptorAllocator &other) = delete;
+        vk::raii::DescriptorPool create_pool_();
+        vk::DescriptorSet allocate_(std::vector<Pool> &pools, const vk::DescriptorSetLayout &layout, const bool &transient);
+        static size_t hash_(const std::vector<vk::DescriptorSetLayoutBinding> &bindings);
+        static bool equal_(const std::vector<vk::DescriptorSetLayoutBinding> &a, const std::vector<vk::DescriptorSetLayoutBinding> &b);
+
+    public:
+        ~DescriptorAllocator();
+
+        /* 同じバインディングなら同じレイアウトを返す (DescriptorAllocatorが所有) */
+        vk::DescriptorSetLayout get_layout(const std::vector<vk::DescriptorSetLayoutBinding> &bindings);
+        vk::DescriptorSet allocate(const vk::DescriptorSetLayout &layout);           // 所有者と同じ寿命
+        vk::DescriptorSet allocate_transient(const vk::DescriptorSetLayout &layout); // 記録中のフレームのみ有効
+        void seal(const uint64_t &value);                                            // フレームの提出後に呼ぶ
+        void recycle(const uint64_t &completed_value);
+        void clear();
+        Statistics get_statistics() const;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <spdlog/spdlog.h>
 #include <GLFW/glfw3.h>
 #include <set>
+#include <algorithm>
 #include <exception>
 #include <iostream>
 namespace
@@ -224,6 +225,14 @@ namespace NEGUI2
 
             if (!is_renderable(instance, gpu))
                 continue;
+            /* 提出の完了追跡にタイムラインセマフォが要る. 無いGPUは選ばず他を使う */
+            if (!gpu.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>()
+                     .get<vk::PhysicalDeviceTimelineSemaphoreFeatures>()
+                     .timelineSemaphore)
+            {
+                spdlog::warn("Skipping {}: timeline semaphore not supported", gpu.getProperties().deviceName.data());
+                continue;
+            }
             auto property = gpu.getProperties();
             uint32_t score  = property.limits.maxFramebufferWidth * property.limits.maxFramebufferHeight;
             if (max_score < score)
@@ -238,7 +247,7 @@ namespace NEGUI2
         }
         else {
             spdlog::error("No good Device Found");
-            std::abort();
+            throw std::runtime_error("No good Device Found");
         }
     }
 
@@ -272,6 +281,11 @@ namespace NEGUI2
 
             /* Enumerate physical device extension */
             auto properties = physical_device.enumerateDeviceExtensionProperties();
+            if (is_extension_available(properties, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+            {
+                device_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+                memory_budget_supported = true;
+            }
 
             /* Queueのデータ設定 */
             std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
@@ -294,7 +308,82 @@ namespace NEGUI2
             features.setDepthClamp(vk::True);
             features.setIndependentBlend(vk::True);
             features.setFragmentStoresAndAtomics(vk::True);
+            features.setPipelineStatisticsQuery(physical_device.getFeatures().pipelineStatisticsQuery);
+            features.setGeometryShader(physical_device.getFeatures().geometryShader); // Mesh.fragのgl_PrimitiveID
+            primitive_id_supported = features.geometryShader == vk::True;
+            if (!primitive_id_supported)
+            {
+                spdlog::warn("geometryShader is not supported: mesh selection falls back to whole meshes");
+            }
+            features.setTextureCompressionBC(physical_device.getFeatures().textureCompressionBC);
+            features.setTextureCompressionASTC_LDR(physical_device.getFeatures().textureCompressionASTC_LDR);
+            features.setTextureCompressionETC2(physical_device.getFeatures().textureCompressionETC2);
             create_info.setPEnabledFeatures(&features);
+
+            /* バインドレステクスチャ用のディスクリプタインデックス */
+            auto supported = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorIndexingFeatures>()
+                                 .get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+            vk::PhysicalDeviceDescriptorIndexingFeatures indexing_features;
+            if (supported.runtimeDescriptorArray && supported.shaderSampledImageArrayNonUniformIndexing &&
+                supported.descriptorBindingPartiallyBound && supported.descriptorBindingSampledImageUpdateAfterBind &&
+                supported.descriptorBindingUpdateUnusedWhilePending)
+            {
+                indexing_features.setRuntimeDescriptorArray(vk::True)
+                    .setShaderSampledImageArrayNonUniformIndexing(vk::True)
+                    .setDescriptorBindingPartiallyBound(vk::True)
+                    .setDescriptorBindingSampledImageUpdateAfterBind(vk::True)
+                    .setDescriptorBindingUpdateUnusedWhilePending(vk::True);
+                create_info.setPNext(&indexing_features);
+                descriptor_indexing_supported = true;
+            }
+            else
+            {
+                spdlog::warn("Descriptor indexing not supported. Bindless textures disabled.");
+            }
+
+            /* 動的レンダリングとsynchronization2 (Vulkan 1.3相当, 拡張で有効化) */
+            auto supported2 = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceSynchronization2FeaturesKHR,
+                                                           vk::PhysicalDeviceDynamicRenderingFeaturesKHR>();
+            vk::PhysicalDeviceSynchronization2FeaturesKHR synchronization2_features;
+            vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features;
+            if (is_extension_available(properties, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) &&
+                supported2.get<vk::PhysicalDeviceSynchronization2FeaturesKHR>().synchronization2)
+            {
+                device_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+                synchronization2_features.setSynchronization2(vk::True);
+                synchronization2_features.setPNext(const_cast<void *>(create_info.pNext));
+                create_info.setPNext(&synchronization2_features);
+                synchronization2_supported = true;
+
+                if (is_extension_available(properties, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+                    supported2.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering)
+                {
+                    device_extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+                    dynamic_rendering_features.setDynamicRendering(vk::True);
+                    dynamic_rendering_features.setPNext(const_cast<void *>(create_info.pNext));
+                    create_info.setPNext(&dynamic_rendering_features);
+                    dynamic_rendering_supported = true;
+                }
+            }
+            if (!dynamic_rendering_supported)
+            {
+                spdlog::warn("Dynamic rendering not supported. Falling back to render pass objects.");
+            }
+
+            /* 提出の完了はタイムラインセマフォで追跡 (Vulkan 1.2) */
+            auto timeline_supported = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>()
+                                          .get<vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+            if (!timeline_supported.timelineSemaphore)
+            {
+                /* 選択時に除外しているので通常は来ない. 初期化失敗として呼び出し側へ返す */
+                spdlog::error("Timeline semaphore not supported");
+                throw std::runtime_error("Timeline semaphore not supported");
+            }
+            vk::PhysicalDeviceTimelineSemaphoreFeatures timeline_features;
+            timeline_features.setTimelineSemaphore(vk::True);
+            timeline_features.setPNext(const_cast<void *>(create_info.pNext));
+            create_info.setPNext(&timeline_features);
+            create_info.setPEnabledExtensionNames(device_extensions);
             device = physical_device.createDevice(create_info);
         }
     }
@@ -324,23 +413,17 @@ namespace NEGUI2
 
         vk::DescriptorPoolCreateInfo pool_info;
         pool_info.flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
-        pool_info.maxSets = 100;
+        pool_info.maxSets = 1000;
         pool_info.setPoolSizes(pool_sizes);
         descriptor_pool = device.createDescriptorPool(pool_info);
 
-        vk::DescriptorSetLayoutCreateInfo create_info;
-        std::array<vk::DescriptorSetLayoutBinding, 3> bindings;
+        /* 共有セットはDescriptorAllocatorから */
+        std::vector<vk::DescriptorSetLayoutBinding> bindings(3);
         bindings[0] = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
         bindings[1] = vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
         bindings[2] = vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
-        create_info.setBindings(bindings);
-        descriptor_set_layout = device.createDescriptorSetLayout(create_info);
-
-        vk::DescriptorSetAllocateInfo alloc_info;
-        alloc_info.setDescriptorPool(*descriptor_pool)
-                  .setSetLayouts(*descriptor_set_layout);
-        auto descriptors = device.allocateDescriptorSets(alloc_info);
-        descriptor_set = std::move(descriptors[0]);
+        descriptor_set_layout = descriptors.get_layout(bindings);
+        descriptor_set = descriptors.allocate(descriptor_set_layout);
     }
 
     void DeviceManager::init_command_pool_()
@@ -356,12 +439,22 @@ namespace NEGUI2
         pipeline_cache = device.createPipelineCache({});
     }
 
+    void DeviceManager::init_timeline_()
+    {
+        vk::SemaphoreTypeCreateInfo type_info(vk::SemaphoreType::eTimeline, 0u);
+        vk::SemaphoreCreateInfo create_info;
+        create_info.setPNext(&type_info);
+        timeline = device.createSemaphore(create_info);
+    }
+
     DeviceManager::DeviceManager()
         : context_(), instance(nullptr), physical_device(nullptr),
           device(nullptr), graphics_queue_index((uint32_t)-1), present_queue_index((uint32_t)-1),
           graphics_queue(nullptr), present_queue(nullptr), debug_func(nullptr),
-          descriptor_pool(nullptr), descriptor_set_layout(nullptr), descriptor_set(nullptr),
-          command_pool(nullptr), pipeline_cache(nullptr)
+          descriptor_pool(nullptr), command_pool(nullptr), commands(), descriptors(), descriptor_set_layout(nullptr),
+          descriptor_set(nullptr), pipeline_cache(nullptr), memory_budget_supported(false),
+          descriptor_indexing_supported(false), synchronization2_supported(false), dynamic_rendering_supported(false), primitive_id_supported(false),
+          timeline(nullptr), submitted_value_(0u)
     {
     }
 
@@ -374,34 +467,90 @@ namespace NEGUI2
         init_descriptor_pool_();
         init_command_pool_();
         init_pipeline_cache_();
+        init_timeline_();
     }
 
     DeviceManager::~DeviceManager()
     {
         device.waitIdle();
+        commands.clear(); // デバイスより先に解放
+        descriptors.clear();
     }
 
-    vk::Result DeviceManager::one_shot(std::function<vk::Result(vk::raii::CommandBuffer &command_buffer)> func)
+    uint64_t DeviceManager::submit(vk::SubmitInfo info)
+    {
+        /* 既存の通知セマフォにタイムラインを追加 (バイナリセマフォの値は無視される) */
+        uint64_t value = ++submitted_value_;
+        std::vector<vk::Semaphore> signal_semaphores(info.pSignalSemaphores, info.pSignalSemaphores + info.signalSemaphoreCount);
+        signal_semaphores.push_back(*timeline);
+        std::vector<uint64_t> signal_values(signal_semaphores.size(), 0u);
+        signal_values.back() = value;
+        std::vector<uint64_t> wait_values(info.waitSemaphoreCount, 0u);
+
+        vk::TimelineSemaphoreSubmitInfo timeline_info;
+        timeline_info.setWaitSemaphoreValues(wait_values).setSignalSemaphoreValues(signal_values);
+        timeline_info.setPNext(info.pNext);
+        info.setSignalSemaphores(signal_semaphores).setPNext(&timeline_info);
+
+        graphics_queue.submit(info);
+        return value;
+    }
+
+    uint64_t DeviceManager::get_submitted_value() const
+    {
+        return submitted_value_;
+    }
+
+    uint64_t DeviceManager::get_completed_value() const
+    {
+        return timeline.getCounterValue();
+    }
+
+    bool DeviceManager::is_complete(const uint64_t &value) const
+    {
+        return value <= get_completed_value();
+    }
+
+    void DeviceManager::wait(const uint64_t &value) const
     {
-        /* コマンドバッファ生成 */
-        vk::raii::CommandBuffer command_buffer(nullptr);
+        /* 同一キューの通知は提出順に先行する全コマンドの完了を含む */
+        if (value == 0u || is_complete(value))
+            return;
+
+        vk::SemaphoreWaitInfo wait_info;
+        wait_info.setSemaphores(*timeline).setValues(value);
+        auto result = device.waitSemaphores(wait_info, UINT64_MAX);
+        if (result != vk::Result::eSuccess)
         {
-            vk::CommandBufferAllocateInfo alloc_info{};
-            alloc_info.commandPool = *command_pool;
-            alloc_info.commandBufferCount = 1;
-            alloc_info.level = vk::CommandBufferLevel::ePrimary;
-            command_buffer = std::move(device.allocateCommandBuffers(alloc_info).front());
+            spdlog::error("Timeline semaphore wait error");
         }
+    }
+
+    vk::Result DeviceManager::one_shot(std::function<vk::Result(vk::raii::CommandBuffer &command_buffer)> func)
+    {
+        vk::Result ret = vk::Result::eSuccess;
+        auto value = one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                                    { ret = func(command_buffer); });
+
+        /* キュー全体ではなくこの提出のみ待つ */
+        wait(value);
+        return ret;
+    }
+
+    uint64_t DeviceManager::one_shot_async(std::function<void(vk::raii::CommandBuffer &command_buffer)> func)
+    {
+        /* 完了したプールはリセットして再利用 */
+        commands.recycle(get_completed_value());
+        auto &command_buffer = commands.acquire();
 
         command_buffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-        auto ret = func(command_buffer);
+        func(command_buffer);
         command_buffer.end();
 
         vk::SubmitInfo submitInfo;
         submitInfo.setCommandBuffers(*command_buffer);
-        graphics_queue.submit(submitInfo);
-        graphics_queue.waitIdle();
-
-        return ret;
+        auto value = submit(submitInfo);
+        commands.retire(command_buffer, value);
+        return value;
     }
-}
+}
\ No newline at end of file
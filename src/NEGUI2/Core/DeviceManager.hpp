@@ -2,7 +2,10 @@
 #define _DEVICE_MANAGER_HPP
 #include <stack>
 #include <vulkan/vulkan_raii.hpp>
+#include "NEGUI2/Core/CommandAllocator.hpp"
+#include "NEGUI2/Core/DescriptorAllocator.hpp"
 #include <functional>
+#include <vector>
 
 namespace NEGUI2
 {
@@ -22,6 +25,10 @@ namespace NEGUI2
         void init_descriptor_pool_();
         void init_command_pool_();
         void init_pipeline_cache_();
+        void init_timeline_();
+
+        /* タイムラインセマフォの提出値 */
+        uint64_t submitted_value_;
     public:
         ~DeviceManager();
         vk::raii::Instance instance;
@@ -32,12 +39,27 @@ namespace NEGUI2
         vk::raii::Queue graphics_queue;
         vk::raii::Queue present_queue;
         vk::raii::DebugUtilsMessengerEXT debug_func;
-        vk::raii::DescriptorPool descriptor_pool;
-        vk::raii::DescriptorSetLayout descriptor_set_layout;
-        vk::raii::DescriptorSet descriptor_set;
+        vk::raii::DescriptorPool descriptor_pool; // ImGui用 (個別に解放する)
         vk::raii::CommandPool command_pool;
+        CommandAllocator commands; // 使い回すコマンドバッファ (one_shotとフレーム)
+        DescriptorAllocator descriptors;
+        vk::DescriptorSetLayout descriptor_set_layout; // カメラ等の共有セット (descriptorsが所有)
+        vk::DescriptorSet descriptor_set;
         vk::raii::PipelineCache pipeline_cache;
+        bool memory_budget_supported;
+        bool descriptor_indexing_supported;
+        bool synchronization2_supported;
+        bool dynamic_rendering_supported; // レンダーパス/フレームバッファを使わない描画
+        bool primitive_id_supported;      // フラグメントシェーダのgl_PrimitiveID (geometryShader機能)
+        vk::raii::Semaphore timeline;      // 提出毎に単調増加する値を通知
+
+        uint64_t submit(vk::SubmitInfo info); // タイムライン値を付けて提出し, その値を返す
+        uint64_t get_submitted_value() const;
+        uint64_t get_completed_value() const;
+        bool is_complete(const uint64_t &value) const;
+        void wait(const uint64_t &value) const; // 指定値まで (それ以前の提出も含む) 完了を待つ
         vk::Result one_shot(std::function<vk::Result(vk::raii::CommandBuffer &command_buffer)> func);
+        uint64_t one_shot_async(std::function<void(vk::raii::CommandBuffer &command_buffer)> func); // 完了を待たない
     };
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "NEGUI2/Core/FrameAllocator.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/Core/Trace.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace NEGUI2
+{
+    FrameAllocator::FrameAllocator()
+        : mutex_(), current_(), submitted_(), free_(), descriptor_set_layout_(nullptr),
+          alignment_(1u), frame_used_(0u), statistics_()
+    {
+    }
+
+    FrameAllocator::~FrameAllocator()
+    {
+        /* Coreが完了を待ってから破棄する */
+        for (auto &chunk : current_)
+            destroy_chunk_(chunk);
+        for (auto &chunk : submitted_)
+            destroy_chunk_(chunk);
+        for (auto &chunk : free_)
+            destroy_chunk_(chunk);
+    }
+
+    void FrameAllocator::init()
+    {
+        auto &gpu = Core::get_instance().gpu;
+        auto limits = gpu.physical_device.getProperties().limits;
+        alignment_ = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+        std::vector<vk::DescriptorSetLayoutBinding> bindings(1);
+        bindings[0] = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment);
+        descriptor_set_layout_ = gpu.descriptors.get_layout(bindings);
+    }
+
+    FrameAllocator::Chunk FrameAllocator::create_chunk_(const vk::DeviceSize &size)
+    {
+        NEGUI2_TRACE_SCOPE("FrameAllocator::create_chunk");
+        auto &core = Core::get_instance();
+        auto &mm = core.mm;
+
+        /* 末尾の切り出しでも動的オフセットの範囲が収まるよう余白を付ける */
+        vk::BufferCreateInfo buffer_info;
+        buffer_info.setSize(size + DYNAMIC_RANGE)
+            .setUsage(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        VmaAllocationCreateInfo alloc_create_info{};
+        alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+        alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+        Chunk chunk{};
+        vk::Buffer buffer;
+        VmaAllocationInfo alloc_info;
+        if (!mm.create_buffer(buffer_info, alloc_create_info, MemoryManager::CATEGORY::UNIFORM, buffer, chunk.alloc, alloc_info))
+        {
+            spdlog::error("Failed to create frame data buffer ({} bytes)", size);
+            return chunk;
+        }
+
+        chunk.buffer = buffer;
+        chunk.data = alloc_info.pMappedData;
+        chunk.size = size;
+        chunk.used = 0u;
+        chunk.value = 0u;
+        chunk.descriptor_set = core.gpu.descriptors.allocate(descriptor_set_layout_);
+
+        vk::DescriptorBufferInfo descriptor_info(chunk.buffer, 0u, DYNAMIC_RANGE);
+        vk::WriteDescriptorSet write_descriptor_set;
+        write_descriptor_set.setDstSet(chunk.descriptor_set).setDstBinding(0).setDstArrayElement(0)
+            .setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+            .setBufferInfo(descriptor_info);
+        core.gpu.device.updateDescriptorSets(write_descriptor_set, nullptr);
+
+        statistics_.chunks_created++;
+        return chunk;
+    }
+
+    void FrameAllocator::destroy_chunk_(Chunk &chunk)
+    {
+        if (!chunk.buffer)
+            return;
+
+        Core::get_instance().mm.destroy_buffer(chunk.buffer, chunk.alloc, MemoryManager::CATEGORY::UNIFORM);
+        chunk.buffer = nullptr;
+    }
+
+    FrameAllocator::Allocation FrameAllocator::allocate(const vk::DeviceSize &size)
+    {
+        /* 記述子は動的オフセットからDYNAMIC_RANGEしか見せないので, それを超えるデータは渡せない */
+        if (size == 0u || size > DYNAMIC_RANGE)
+        {
+            spdlog::error("Frame data size {} is out of range (1 - {} bytes)", size, DYNAMIC_RANGE);
+            return Allocation{nullptr, 0u, nullptr, nullptr};
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto aligned = (size + alignment_ - 1u) / alignment_ * alignment_;
+
+        if (current_.empty() || current_.back().used + aligned > current_.back().size)
+        {
+            /* 使い終わったバッファで足りればそれを使う */
+            auto it = std::find_if(free_.begin(), free_.end(), [&aligned](const Chunk &chunk)
+                                   { return chunk.size >= aligned; });
+            if (it != free_.end())
+            {
+                current_.push_back(*it);
+                free_.erase(it);
+            }
+            else
+            {
+                auto chunk = create_chunk_(std::max(CHUNK_SIZE, aligned));
+                if (!chunk.buffer)
+                    return Allocation{nullptr, 0u, nullptr, nullptr};
+                current_.push_back(chunk);
+            }
+        }
+
+        auto &chunk = current_.back();
+        Allocation allocation{chunk.buffer, static_cast<uint32_t>(chunk.used),
+                              static_cast<uint8_t *>(chunk.data) + chunk.used, chunk.descriptor_set};
+        chunk.used += aligned;
+        frame_used_ += aligned;
+        return allocation;
+    }
+
+    void FrameAllocator::flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &mm = Core::get_instance().mm;
+        for (const auto &chunk : current_)
+        {
+            if (chunk.used != 0u)
+                mm.flush_allocation(chunk.alloc, 0u, chunk.used);
+        }
+    }
+
+    void FrameAllocator::seal(const uint64_t &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &chunk : current_)
+        {
+            chunk.value = value;
+            submitted_.push_back(chunk);
+        }
+        current_.clear();
+
+        statistics_.used = frame_used_;
+        statistics_.peak = std::max(statistics_.peak, frame_used_);
+        frame_used_ = 0u;
+    }
+
+    void FrameAllocator::recycle(const uint64_t &completed_value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!submitted_.empty() && submitted_.front().value <= completed_value)
+        {
+            auto chunk = submitted_.front();
+            submitted_.pop_front();
+            chunk.used = 0u;
+            chunk.value = 0u;
+            free_.push_back(chunk);
+        }
+    }
+
+    vk::DescriptorSetLayout FrameAllocator::get_descriptor_set_layout() const
+    {
+        return descriptor_set_layout_;
+    }
+
+    FrameAllocator::Statistics FrameAllocator::get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return statistics_;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef _FRAME_ALLOCATOR_HPP
+#define _FRAME_ALLOCATOR_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.h>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace NEGUI2
+{
+    /* フレーム内だけ使う描画データを永続マップしたバッファから先頭詰めで切り出す.
+       バッファはフレームの提出値が完了すると丸ごと再利用する */
+    class FrameAllocator
+    {
+        friend class Core;
+
+    public:
+        static constexpr vk::DeviceSize CHUNK_SIZE = 256u * 1024u;
+        static constexpr vk::DeviceSize DYNAMIC_RANGE = 256u; // 動的オフセットで見える範囲 (描画毎のデータの上限)
+
+        struct Allocation
+        {
+            vk::Buffer buffer;
+            uint32_t offset; // 動的オフセットにそのまま渡せる
+            void *data;
+            vk::DescriptorSet descriptor_set; // set = DescriptorSetIndex::DRAW, binding 0 = 動的ユニフォームバッファ
+        };
+
+        struct Statistics
+        {
+            vk::DeviceSize used;      // 直前のフレームで使ったバイト数
+            vk::DeviceSize peak;
+            uint64_t chunks_created;
+        };
+
+    private:
+        struct Chunk
+        {
+            vk::Buffer buffer;
+            VmaAllocation alloc;
+            void *data;
+            vk::DeviceSize size;
+            vk::DeviceSize used;
+            vk::DescriptorSet descriptor_set;
+            uint64_t value;
+        };
+
+        mutable std::mutex mutex_;
+        std::vector<Chunk> current_; // 記録中のフレーム (末尾から切り出す)
+        std::deque<Chunk> submitted_;
+        std::vector<Chunk> free_;
+        vk::DescriptorSetLayout descriptor_set_layout_;
+        vk::DeviceSize alignment_;
+        vk::DeviceSize frame_used_;
+        Statistics statistics_;
+
+        FrameAllocator();
+        void init();
+        FrameAllocator(const FrameAllocator &other) = delete;
+        FrameAllocator &operator=(const FrameAllocator &other) = delete;
+        Chunk create_chunk_(const vk::DeviceSize &size);
+        void destroy_chunk_(Chunk &chunk);
+        void flush();                             // 提出前にCoreが呼ぶ
+        void seal(const uint64_t &value);         // 提出後にCoreが呼ぶ
+        void recycle(const uint64_t &completed_value);
+
+    public:
+        ~FrameAllocator();
+
+        Allocation allocate(const vk::DeviceSize &size); // size は DYNAMIC_RANGE 以下. 超えたら空を返す
+        template <typename T>
+        Allocation push(const T &value)
+        {
+            static_assert(sizeof(T) <= DYNAMIC_RANGE, "frame data must fit in DYNAMIC_RANGE");
+            auto allocation = allocate(sizeof(T));
+            if (allocation.data != nullptr)
+            {
+                std::memcpy(allocation.data, &value, sizeof(T));
+            }
+            return allocation;
+        }
+
+        vk::DescriptorSetLayout get_descriptor_set_layout() const;
+        Statistics get_statistics() const;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,306 @@
+#include "NEGUI2/Core/GpuProfiler.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#ifdef __GNUC__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+namespace
+{
+    constexpr vk::QueryPipelineStatisticFlags STATISTICS_FLAGS =
+        vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+        vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+        vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+        vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+    constexpr uint32_t STATISTICS_COUNT = 5u;
+}
+
+namespace NEGUI2
+{
+    GpuProfiler::GpuProfiler()
+        : timestamp_pool_(nullptr), statistics_pool_(nullptr), timestamp_period_ns_(0.0), timestamp_mask_(0u),
+          slots_(), current_slot_(0u), recording_(false), overflow_warned_(false), open_scopes_(), histories_(), resolved_(), scope_order_(), statistics_(),
+          dropped_frames_(0u), enable(true), enable_pipeline_statistics(false)
+    {
+    }
+
+    GpuProfiler::~GpuProfiler()
+    {
+    }
+
+    void GpuProfiler::init()
+    {
+        auto &gpu = Core::get_instance().gpu;
+        auto limits = gpu.physical_device.getProperties().limits;
+        auto queue_properties = gpu.physical_device.getQueueFamilyProperties();
+        uint32_t valid_bits = queue_properties[gpu.graphics_queue_index].timestampValidBits;
+
+        /* タイムスタンプクエリ */
+        if (limits.timestampComputeAndGraphics && valid_bits != 0u)
+        {
+            timestamp_period_ns_ = static_cast<double>(limits.timestampPeriod);
+            timestamp_mask_ = valid_bits >= 64u ? ~0ull : ((1ull << valid_bits) - 1ull);
+
+            vk::QueryPoolCreateInfo create_info;
+            create_info.setQueryType(vk::QueryType::eTimestamp)
+                .setQueryCount(MAX_QUERY * SLOT_COUNT);
+            timestamp_pool_ = gpu.device.createQueryPool(create_info);
+        }
+        else
+        {
+            spdlog::warn("Timestamp query not supported. GPU profiler disabled.");
+        }
+
+        /* パイプライン統計クエリ */
+        if (gpu.physical_device.getFeatures().pipelineStatisticsQuery)
+        {
+            vk::QueryPoolCreateInfo create_info;
+            create_info.setQueryType(vk::QueryType::ePipelineStatistics)
+                .setQueryCount(SLOT_COUNT)
+                .setPipelineStatistics(STATISTICS_FLAGS);
+            statistics_pool_ = gpu.device.createQueryPool(create_info);
+        }
+    }
+
+    bool GpuProfiler::is_supported() const
+    {
+        return static_cast<bool>(*timestamp_pool_);
+    }
+
+    bool GpuProfiler::begin_frame(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot)
+    {
+        if (!is_supported())
+            return false;
+
+        current_slot_ = slot % SLOT_COUNT;
+        open_scopes_.clear();
+        recording_ = false;
+        resolved_.clear();
+
+        /* 前回このスロットで記録したフレームの結果を待たずに回収.
+           まだ完了していなければ結果を残して次の周回で回収し直し, このフレームは計測しない */
+        auto &current = slots_[current_slot_];
+        auto result = resolve_(current);
+        if (result == vk::Result::eNotReady)
+        {
+            dropped_frames_++;
+            return false;
+        }
+        bool resolved = result == vk::Result::eSuccess && current.written && current.query_count != 0u;
+
+        current.records.clear();
+        current.query_count = 0u;
+        current.has_statistics = false;
+        current.written = false;
+        current.overflowed = false;
+        if (!enable)
+            return resolved;
+
+        command_buffer.resetQueryPool(*timestamp_pool_, current_slot_ * MAX_QUERY, MAX_QUERY);
+        if (*statistics_pool_)
+        {
+            command_buffer.resetQueryPool(*statistics_pool_, current_slot_, 1u);
+        }
+        current.written = true;
+        recording_ = true;
+
+        return resolved;
+    }
+
+    void GpuProfiler::begin_scope(vk::raii::CommandBuffer &command_buffer, const std::string &name)
+    {
+        auto &current = slots_[current_slot_];
+        if (!enable || !recording_)
+        {
+            open_scopes_.push_back(SIZE_MAX);
+            return;
+        }
+        if (current.query_count + 2u > MAX_QUERY)
+        {
+            if (!current.overflowed)
+            {
+                current.overflowed = true;
+                dropped_frames_++;
+            }
+            if (!overflow_warned_)
+            {
+                overflow_warned_ = true;
+                spdlog::warn("GPU profiler: more than {} scopes in a frame, the rest are not measured", MAX_QUERY / 2u);
+            }
+            open_scopes_.push_back(SIZE_MAX);
+            return;
+        }
+
+        uint32_t query = current_slot_ * MAX_QUERY + current.query_count;
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *timestamp_pool_, query);
+        current.records.push_back({name, current.query_count, current.query_count + 1u});
+        current.query_count += 2u;
+        open_scopes_.push_back(current.records.size() - 1u);
+    }
+
+    void GpuProfiler::end_scope(vk::raii::CommandBuffer &command_buffer)
+    {
+        if (open_scopes_.empty())
+            return;
+
+        size_t index = open_scopes_.back();
+        open_scopes_.pop_back();
+        if (index == SIZE_MAX)
+            return;
+
+        auto &record = slots_[current_slot_].records[index];
+        uint32_t query = current_slot_ * MAX_QUERY + record.end_query;
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *timestamp_pool_, query);
+    }
+
+    void GpuProfiler::begin_statistics(vk::raii::CommandBuffer &command_buffer)
+    {
+        auto &current = slots_[current_slot_];
+        if (!enable || !enable_pipeline_statistics || !*statistics_pool_ || !recording_)
+            return;
+
+        command_buffer.beginQuery(*statistics_pool_, current_slot_, {});
+        current.has_statistics = true;
+    }
+
+    void GpuProfiler::end_statistics(vk::raii::CommandBuffer &command_buffer)
+    {
+        if (!slots_[current_slot_].has_statistics)
+            return;
+
+        command_buffer.endQuery(*statistics_pool_, current_slot_);
+    }
+
+    vk::Result GpuProfiler::resolve_(Slot &slot)
+    {
+        if (!slot.written || slot.query_count == 0u)
+            return vk::Result::eSuccess;
+
+        uint32_t slot_index = static_cast<uint32_t>(&slot - slots_.data());
+        auto [result, timestamps] = timestamp_pool_.getResults<uint64_t>(slot_index * MAX_QUERY, slot.query_count,
+                                                                         slot.query_count * sizeof(uint64_t), sizeof(uint64_t),
+                                                                         vk::QueryResultFlagBits::e64);
+        if (result == vk::Result::eNotReady)
+            return result;
+        if (result != vk::Result::eSuccess)
+        {
+            dropped_frames_++;
+            return result;
+        }
+
+        /* 同名スコープは合算 */
+        std::unordered_map<std::string, double> frame_times;
+        for (const auto &record : slot.records)
+        {
+            uint64_t ticks = (timestamps[record.end_query] - timestamps[record.begin_query]) & timestamp_mask_;
+            frame_times[record.name] += static_cast<double>(ticks) * timestamp_period_ns_ * 1E-6;
+        }
+
+        for (const auto &frame_time : frame_times)
+        {
+            auto it = histories_.find(frame_time.first);
+            if (it == histories_.end())
+            {
+                it = histories_.emplace(frame_time.first, ScopeHistory{std::vector<float>(HISTORY_SIZE, 0.f), 0u, 0u}).first;
+                scope_order_.push_back(frame_time.first);
+            }
+            auto &history = it->second;
+            history.values[history.head] = static_cast<float>(frame_time.second);
+            history.head = (history.head + 1u) % HISTORY_SIZE;
+            history.count = std::min(history.count + 1u, HISTORY_SIZE);
+        }
+        resolved_ = std::move(frame_times);
+
+        if (slot.has_statistics)
+        {
+            auto [stat_result, stats] = statistics_pool_.getResults<uint64_t>(slot_index, 1u, STATISTICS_COUNT * sizeof(uint64_t),
+                                                                              STATISTICS_COUNT * sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+            if (stat_result == vk::Result::eSuccess)
+            {
+                statistics_ = {stats[0], stats[1], stats[2], stats[3], stats[4]};
+            }
+        }
+
+        return vk::Result::eSuccess;
+    }
+
+    const std::vector<std::string> &GpuProfiler::get_scope_names() const
+    {
+        return scope_order_;
+    }
+
+    const GpuProfiler::ScopeHistory *GpuProfiler::get_history(const std::string &name) const
+    {
+        auto it = histories_.find(name);
+        if (it == histories_.end())
+            return nullptr;
+        return &it->second;
+    }
+
+    std::optional<double> GpuProfiler::get_latest(const std::string &name) const
+    {
+        auto history = get_history(name);
+        if (history == nullptr || history->count == 0u)
+            return std::nullopt;
+
+        size_t latest = (history->head + HISTORY_SIZE - 1u) % HISTORY_SIZE;
+        return static_cast<double>(history->values[latest]);
+    }
+
+    std::optional<double> GpuProfiler::get_resolved(const std::string &name) const
+    {
+        auto it = resolved_.find(name);
+        if (it == resolved_.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    double GpuProfiler::get_percentile(const std::string &name, const double &percentile) const
+    {
+        auto history = get_history(name);
+        if (history == nullptr || history->count == 0u)
+            return 0.0;
+
+        std::vector<float> values(history->values.begin(), history->values.begin() + history->count);
+        double rank = std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(values.size() - 1u);
+        auto nth = values.begin() + static_cast<size_t>(std::lround(rank));
+        std::nth_element(values.begin(), nth, values.end());
+        return static_cast<double>(*nth);
+    }
+
+    GpuProfiler::PipelineStatistics GpuProfiler::get_pipeline_statistics() const
+    {
+        return statistics_;
+    }
+
+    uint64_t GpuProfiler::get_dropped_frames() const
+    {
+        return dropped_frames_;
+    }
+
+    std::string GpuProfiler::type_name(const std::type_info &info)
+    {
+        std::string name = info.name();
+#ifdef __GNUC__
+        int status = 0;
+        char *demangled = abi::__cxa_demangle(info.name(), nullptr, nullptr, &status);
+        if (status == 0 && demangled != nullptr)
+        {
+            name = demangled;
+        }
+        std::free(demangled);
+#endif
+        /* 名前空間を除去 */
+        auto pos = name.rfind("::");
+        if (pos != std::string::npos)
+        {
+            name = name.substr(pos + 2u);
+        }
+        return name;
+    }
+}
\ No newline at end of file
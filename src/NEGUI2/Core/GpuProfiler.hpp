@@ -0,0 +1,99 @@
+#ifndef _GPU_PROFILER_HPP
+#define _GPU_PROFILER_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <typeinfo>
+
+namespace NEGUI2
+{
+    class GpuProfiler
+    {
+    public:
+        struct PipelineStatistics
+        {
+            uint64_t input_vertices;
+            uint64_t input_primitives;
+            uint64_t vertex_invocations;
+            uint64_t clipping_primitives;
+            uint64_t fragment_invocations;
+        };
+
+        struct ScopeHistory
+        {
+            std::vector<float> values; // [ms]
+            size_t head;
+            size_t count;
+        };
+
+        static constexpr uint32_t SLOT_COUNT = 8u;   // begin_frameに渡すスロットはこの数で回す
+        static constexpr uint32_t MAX_QUERY = 1024u; // 1スロットのタイムスタンプ数 (スコープ1つで2つ使う)
+        static constexpr size_t HISTORY_SIZE = 240u;
+
+    private:
+        friend class Core;
+        struct ScopeRecord
+        {
+            std::string name;
+            uint32_t begin_query;
+            uint32_t end_query;
+        };
+
+        struct Slot
+        {
+            std::vector<ScopeRecord> records;
+            uint32_t query_count;
+            bool has_statistics;
+            bool written;
+            bool overflowed; // MAX_QUERYを超えて記録できなかったスコープがある
+        };
+
+        vk::raii::QueryPool timestamp_pool_;
+        vk::raii::QueryPool statistics_pool_;
+        double timestamp_period_ns_;
+        uint64_t timestamp_mask_;
+        std::array<Slot, SLOT_COUNT> slots_;
+        uint32_t current_slot_;
+        bool recording_; // このフレームを計測中
+        bool overflow_warned_;
+        std::vector<size_t> open_scopes_;
+        std::unordered_map<std::string, ScopeHistory> histories_;
+        std::unordered_map<std::string, double> resolved_; // 直前のbegin_frameで回収したフレームの値 [ms]
+        std::vector<std::string> scope_order_;
+        PipelineStatistics statistics_;
+        uint64_t dropped_frames_; // 未完了やスコープの溢れで欠けたフレーム
+
+        GpuProfiler();
+        void init();
+        GpuProfiler(const GpuProfiler &other) = delete;
+        GpuProfiler &operator=(const GpuProfiler &other) = delete;
+        vk::Result resolve_(Slot &slot); // 未完了ならeNotReady (スロットはそのまま残す)
+
+    public:
+        ~GpuProfiler();
+        bool enable;
+        bool enable_pipeline_statistics;
+
+        bool is_supported() const;
+        bool begin_frame(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot);
+        void begin_scope(vk::raii::CommandBuffer &command_buffer, const std::string &name);
+        void end_scope(vk::raii::CommandBuffer &command_buffer);
+        void begin_statistics(vk::raii::CommandBuffer &command_buffer);
+        void end_statistics(vk::raii::CommandBuffer &command_buffer);
+
+        const std::vector<std::string> &get_scope_names() const;
+        const ScopeHistory *get_history(const std::string &name) const;
+        std::optional<double> get_latest(const std::string &name) const;
+        std::optional<double> get_resolved(const std::string &name) const; // 回収したフレームにスコープが無ければnullopt
+        double get_percentile(const std::string &name, const double &percentile) const;
+        PipelineStatistics get_pipeline_statistics() const;
+        uint64_t get_dropped_frames() const;
+
+        static std::string type_name(const std::type_info &info);
+    };
+}
+
+#endif
\ No newline at end of file
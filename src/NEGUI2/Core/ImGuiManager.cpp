@@ -184,7 +184,16 @@ namespace NEGUI2
         init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
         init_info.Allocator = NULL;
         init_info.CheckVkResultFn = check_vk_result;
-        ImGui_ImplVulkan_Init(&init_info, *sm.render_pass);
+        if (dm.dynamic_rendering_supported)
+        {
+            init_info.UseDynamicRendering = true;
+            init_info.ColorAttachmentFormat = static_cast<VkFormat>(sm.surface_format.format);
+            ImGui_ImplVulkan_Init(&init_info, VK_NULL_HANDLE);
+        }
+        else
+        {
+            ImGui_ImplVulkan_Init(&init_info, *sm.render_pass);
+        }
         ImGui_ImplGlfw_InitForVulkan(window.get_raw(), true);
 
         // Load Fonts
@@ -1,7 +1,12 @@
 #include "NEGUI2/Core/MemoryManager.hpp"
 #include "NEGUI2/Core/Core.hpp"
+#include "NEGUI2/Core/Trace.hpp"
 #include <spdlog/spdlog.h>
 #include <exception>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <algorithm>
 
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
@@ -33,10 +38,31 @@ namespace
         spdlog::error("Nodepth Format Found");
         throw std::runtime_error("failed to find supported format!");
     }
+
+    NEGUI2::MemoryManager::CATEGORY to_category(const NEGUI2::Memory::TYPE &type)
+    {
+        switch (type)
+        {
+        case NEGUI2::Memory::TYPE::VERTEX:
+            return NEGUI2::MemoryManager::CATEGORY::VERTEX;
+        case NEGUI2::Memory::TYPE::INDEX:
+            return NEGUI2::MemoryManager::CATEGORY::INDEX;
+        case NEGUI2::Memory::TYPE::UNIFORM:
+            return NEGUI2::MemoryManager::CATEGORY::UNIFORM;
+        default: // READBACKはSSBOの写しなので同じ分類
+            return NEGUI2::MemoryManager::CATEGORY::SSBO;
+        }
+    }
 }
 namespace NEGUI2
 {
     MemoryManager::MemoryManager()
+        : allocator_(nullptr), memories_(), images_(), category_bytes_(), pressure_handlers_(), frame_index_(0u),
+          allocation_keys_(), defragmentation_context_(nullptr), defragmentation_checked_(std::chrono::steady_clock::now()),
+          defragmentation_pass_(), defragmentation_moved_(), defragmentation_pending_(false), defragmentation_generation_(0u), dirty_ranges_(), upload_serial_(0u),
+          releases_(), high_watermark(0.9), low_watermark(0.8),
+          defragmentation(false), defragmentation_threshold(0.25), max_defragmentation_moves(16u),
+          last_defragmentation_stats()
     {
     }
 
@@ -76,11 +102,28 @@ namespace NEGUI2
         allocatorCreateInfo.physicalDevice = *device_manager.physical_device;
         allocatorCreateInfo.device = *device_manager.device;
         allocatorCreateInfo.pVulkanFunctions = &fn;
+        if (device_manager.memory_budget_supported)
+        {
+            allocatorCreateInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
         vmaCreateAllocator(&allocatorCreateInfo, &allocator_);
     }
 
     MemoryManager::~MemoryManager()
     {
+        /* 終了時はwait_idle済み. 破棄処理が更に破棄を積むことがある */
+        while (!releases_.empty())
+        {
+            auto release = std::move(releases_.front().release);
+            releases_.pop_front();
+            release();
+        }
+
+        if (defragmentation_context_ != nullptr)
+        {
+            vmaEndDefragmentation(allocator_, defragmentation_context_, nullptr);
+        }
+
         for (auto &memory : memories_)
         {
             vmaDestroyBuffer(allocator_, memory.second.buffer, memory.second.alloc);
@@ -100,10 +143,8 @@ namespace NEGUI2
     }
 
     Memory &MemoryManager::get_memory(const std::string &key)
-    {   
-        auto& mem = memories_.at(key);
-        vmaFlushAllocation(allocator_, mem.alloc, 0, VK_WHOLE_SIZE);
-        return mem;
+    {
+        return memories_.at(key);
     }
 
     bool MemoryManager::add_memory(const std::string &key, const size_t &size, const Memory::TYPE &type, bool rebuild)
@@ -125,17 +166,19 @@ namespace NEGUI2
         case Memory::TYPE::VERTEX:
         {
             buffer_info.setSize(size)
-                .setUsage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer)
+                .setUsage(vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer)
                 .setSharingMode(vk::SharingMode::eExclusive);
             alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+            alloc_create_info.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
         }
         break;
         case Memory::TYPE::INDEX:
         {
             buffer_info.setSize(size)
-                .setUsage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer)
+                .setUsage(vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer)
                 .setSharingMode(vk::SharingMode::eExclusive);
             alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+            alloc_create_info.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
         }
         break;
         case Memory::TYPE::UNIFORM:
@@ -152,7 +195,7 @@ namespace NEGUI2
         case Memory::TYPE::SSBO:
         {
             buffer_info.setSize(size)
-                .setUsage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer)
+                .setUsage(vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer)
                 .setSharingMode(vk::SharingMode::eExclusive);
 
             alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
@@ -160,6 +203,17 @@ namespace NEGUI2
                               VMA_ALLOCATION_CREATE_MAPPED_BIT;
         }
         break;
+        case Memory::TYPE::READBACK:
+        {
+            buffer_info.setSize(size)
+                .setUsage(vk::BufferUsageFlagBits::eTransferDst)
+                .setSharingMode(vk::SharingMode::eExclusive);
+
+            alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+            alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                              VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        }
+        break;
 
 
         default:
@@ -170,21 +224,190 @@ namespace NEGUI2
         VmaAllocation alloc;
         VmaAllocationInfo alloc_info;
 
-        auto result = vmaCreateBuffer(allocator_, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_create_info, &buffer, &alloc, &alloc_info);
-        auto &device = Core::get_instance().gpu;
+        auto create_buffer = [&]()
+        {
+            return vmaCreateBuffer(allocator_, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_create_info, &buffer, &alloc, &alloc_info);
+        };
+        auto result = create_buffer();
+
+        /* 予算超過時はキャッシュ等を解放して再試行し, それでも足りなければ予算外で確保 */
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && (alloc_create_info.flags & VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT))
+        {
+            relieve_pressure_(size);
+            result = create_buffer();
+            if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY)
+            {
+                spdlog::warn("Memory budget exceeded: {} ({} bytes)", key, size);
+                alloc_create_info.flags &= ~VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+                result = create_buffer();
+            }
+        }
+
+        if (result != VK_SUCCESS)
+        {
+            spdlog::error("Failed to allocate buffer {} ({} bytes): {}", key, size, vk::to_string(vk::Result(result)));
+            return false;
+        }
 
-        memories_.insert({key, Memory{vk::Buffer(buffer), alloc, alloc_info}});
+        memories_.insert({key, Memory{vk::Buffer(buffer), alloc, alloc_info, type, buffer_info.size, buffer_info.usage}});
+        allocation_keys_.insert({alloc, key});
+        category_bytes_[static_cast<size_t>(to_category(type))] += alloc_info.size;
 
         return true;
     }
 
+    void MemoryManager::invalidate_memory(const std::string &key)
+    {
+        auto &mem = memories_.at(key);
+        vmaInvalidateAllocation(allocator_, mem.alloc, 0, VK_WHOLE_SIZE);
+    }
+
+    bool MemoryManager::write_memory(const std::string &key, const void *data, const size_t size, const size_t offset)
+    {
+        auto it = memories_.find(key);
+        if (it == memories_.end() || size == 0)
+            return false;
+
+        auto &memory = it->second;
+        if (memory.alloc_info.pMappedData == nullptr || offset + size > memory.size)
+        {
+            spdlog::error("Cannot write memory {} ({} bytes at {})", key, size, offset);
+            return false;
+        }
+
+        std::memcpy(static_cast<uint8_t *>(memory.alloc_info.pMappedData) + offset, data, size);
+        mark_dirty(key, size, offset);
+        return true;
+    }
+
+    void MemoryManager::mark_dirty(const std::string &key, const size_t size, const size_t offset)
+    {
+        auto it = memories_.find(key);
+        if (it == memories_.end())
+            return;
+
+        upload_serial_++;
+        vk::DeviceSize end = size == VK_WHOLE_SIZE ? it->second.size : std::min<vk::DeviceSize>(offset + size, it->second.size);
+        auto dirty = dirty_ranges_.find(key);
+        if (dirty == dirty_ranges_.end())
+        {
+            dirty_ranges_.emplace(key, DirtyRange{offset, end});
+            return;
+        }
+
+        /* 同じメモリへの書き込みは1範囲にまとめる */
+        dirty->second.begin = std::min<vk::DeviceSize>(dirty->second.begin, offset);
+        dirty->second.end = std::max(dirty->second.end, end);
+    }
+
+    uint64_t MemoryManager::get_upload_serial() const
+    {
+        return upload_serial_;
+    }
+
+    void MemoryManager::defer_release(std::function<void()> release)
+    {
+        /* 記録中のコマンドが参照するかもしれないので, そのフレームの提出値が決まるまで待つ */
+        auto &core = Core::get_instance();
+        uint64_t value = core.is_recording() ? 0u : core.gpu.get_submitted_value();
+        releases_.push_back(Release{value, std::move(release)});
+        process_releases();
+    }
+
+    void MemoryManager::seal_releases(const uint64_t &value)
+    {
+        for (auto it = releases_.rbegin(); it != releases_.rend() && it->value == 0u; ++it)
+        {
+            it->value = value;
+        }
+    }
+
+    void MemoryManager::process_releases()
+    {
+        /* 提出値は単調増加なので先頭から完了分を破棄 */
+        auto &core = Core::get_instance();
+        if (core.is_recording())
+            return;
+
+        auto completed = core.gpu.get_completed_value();
+        while (!releases_.empty() && releases_.front().value <= completed)
+        {
+            auto release = std::move(releases_.front().release);
+            releases_.pop_front();
+            release();
+        }
+    }
+
+    size_t MemoryManager::get_pending_release_count() const
+    {
+        return releases_.size();
+    }
+
+    void MemoryManager::flush_memory()
+    {
+        NEGUI2_TRACE_SCOPE("MemoryManager::flush_memory");
+        if (dirty_ranges_.empty())
+            return;
+
+        std::vector<VmaAllocation> allocations;
+        std::vector<VkDeviceSize> offsets;
+        std::vector<VkDeviceSize> sizes;
+        allocations.reserve(dirty_ranges_.size());
+        offsets.reserve(dirty_ranges_.size());
+        sizes.reserve(dirty_ranges_.size());
+        for (const auto &dirty : dirty_ranges_)
+        {
+            const auto &memory = memories_.at(dirty.first);
+            allocations.push_back(memory.alloc);
+            offsets.push_back(dirty.second.begin);
+            sizes.push_back(dirty.second.end - dirty.second.begin);
+        }
+        dirty_ranges_.clear();
+
+        /* HOST_COHERENTなメモリはVMA側で何もしない */
+        auto result = vmaFlushAllocations(allocator_, static_cast<uint32_t>(allocations.size()), allocations.data(), offsets.data(), sizes.data());
+        if (result != VK_SUCCESS)
+        {
+            spdlog::error("Failed to flush {} allocations", allocations.size());
+        }
+    }
+
     bool MemoryManager::remove_memory(const std::string &key)
     {
         bool ret = false;
         if (memories_.count(key) != 0)
         {
             auto &memory = memories_.at(key);
-            vmaDestroyBuffer(allocator_, memory.buffer, memory.alloc);
+            category_bytes_[static_cast<size_t>(to_category(memory.type))] -= memory.alloc_info.size;
+            allocation_keys_.erase(memory.alloc);
+            dirty_ranges_.erase(key);
+
+            /* 移動中ならメモリの解放はパスの終わりにVMAへ任せ, 使い終わるまでパスを閉じない */
+            bool moving = false;
+            if (defragmentation_pending_)
+            {
+                for (uint32_t i = 0; i < defragmentation_pass_.moveCount; i++)
+                {
+                    auto &move = defragmentation_pass_.pMoves[i];
+                    if (move.srcAllocation == memory.alloc && move.operation == VMA_DEFRAGMENTATION_MOVE_OPERATION_COPY)
+                    {
+                        move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+                        moving = true;
+                    }
+                }
+            }
+            if (moving)
+            {
+                vk::Device device = *Core::get_instance().gpu.device;
+                defer_release([device, buffer = memory.buffer]()
+                              { device.destroyBuffer(buffer); });
+                schedule_end_defragmentation_pass_();
+            }
+            else
+            {
+                defer_release([allocator = allocator_, buffer = memory.buffer, alloc = memory.alloc]()
+                              { vmaDestroyBuffer(allocator, buffer, alloc); });
+            }
             memories_.erase(key);
             ret = true;
         }
@@ -193,10 +416,12 @@ namespace NEGUI2
     // TODO オフセット付きアップロード
     bool MemoryManager::upload_memory(const std::string &key, const void *data, const size_t size, const size_t offset)
     {
+        NEGUI2_TRACE_SCOPE("MemoryManager::upload_memory");
         if (memories_.count(key) == 0 || size == 0)
         {
             return false;
         }
+        upload_serial_++;
 
         /* ステージングバッファ生成 */
         VkBuffer stage_buffer;
@@ -214,29 +439,43 @@ namespace NEGUI2
                               VMA_ALLOCATION_CREATE_MAPPED_BIT;
             VkBuffer buffer;
             VmaAllocation allocation;
-            vmaCreateBuffer(allocator_, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_create_info, &stage_buffer, &stage_allocation, &alloc_info);
+            if (vmaCreateBuffer(allocator_, reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info), &alloc_create_info, &stage_buffer, &stage_allocation, &alloc_info) != VK_SUCCESS)
+                return false;
         }
 
-        /* データコピー */
+        /* データコピー (完了は待たない) */
         {
             std::memcpy(alloc_info.pMappedData, data, size);
             vmaFlushAllocation(allocator_, stage_allocation, 0, VK_WHOLE_SIZE);
-            Core::get_instance().gpu.one_shot([&](vk::raii::CommandBuffer &command_buffer)
-                                              {
+            Core::get_instance().gpu.one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                                                    {
                     auto &target = memories_.at(key);
+
+                    /* 提出済みフレームの読み取りが終わってから書く (キュー順の実行依存) */
+                    vk::MemoryBarrier before(vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eTransferWrite);
+                    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer,
+                                                   {}, before, {}, {});
+
                     vk::BufferCopy copyRegion{0, offset, size};
                     command_buffer.copyBuffer(stage_buffer, target.buffer, copyRegion);
-                    return vk::Result::eSuccess; });
+
+                    /* 後続の提出から見えるように */
+                    vk::MemoryBarrier after(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead);
+                    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+                                                   {}, after, {}, {}); });
         }
 
-        /* ステージバッファ削除 */
-        vmaDestroyBuffer(allocator_, stage_buffer, stage_allocation);
+        /* 転送の完了後にステージバッファ削除 */
+        auto allocator = allocator_;
+        defer_release([allocator, stage_buffer, stage_allocation]()
+                      { vmaDestroyBuffer(allocator, stage_buffer, stage_allocation); });
 
         return true;
     }
 
     bool MemoryManager::download_memory(const std::string &key, void *data, const size_t size, const size_t offset)
     {
+        NEGUI2_TRACE_SCOPE("MemoryManager::download_memory");
         if (memories_.count(key) == 0 || size == 0)
         {
             return false;
@@ -269,7 +508,6 @@ namespace NEGUI2
                     vk::BufferCopy copyRegion{offset, 0, size};
                     command_buffer.copyBuffer(target.buffer, stage_buffer, copyRegion);
                     return vk::Result::eSuccess; });
-            Core::get_instance().gpu.graphics_queue.waitIdle();
             vmaFlushAllocation(allocator_, stage_allocation, 0, VK_WHOLE_SIZE);
             std::memcpy(alloc_info.pMappedData, data, size);
         }
@@ -295,6 +533,10 @@ namespace NEGUI2
             remove_image(key);
         }
 
+        /* 8bit RGBA (sRGB) + 全ミップ */
+        if (type == Image::TYPE::TEXTURE)
+            return add_texture_image(key, width, height, vk::Format::eR8G8B8A8Srgb, mip_level_count(width, height));
+
         vk::ImageCreateInfo image_create_info;
         VmaAllocationCreateInfo alloc_create_info{};
 
@@ -329,29 +571,12 @@ namespace NEGUI2
             alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
         }
         break;
-        case Image::TYPE::TEXTURE:
-        {
-            image_create_info.imageType = vk::ImageType::e2D;
-            image_create_info.format = vk::Format::eR32G32B32A32Sint;
-            image_create_info.extent.width = static_cast<uint32_t>(width);
-            image_create_info.extent.height = static_cast<uint32_t>(height);
-            image_create_info.extent.depth = 1;
-            image_create_info.mipLevels = 1;
-            image_create_info.arrayLayers = 1;
-            image_create_info.initialLayout = vk::ImageLayout::eUndefined;
-            image_create_info.samples = vk::SampleCountFlagBits::e1;
-            image_create_info.tiling = vk::ImageTiling::eOptimal;
-            image_create_info.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
-            image_create_info.sharingMode = vk::SharingMode::eExclusive;
-            alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
-        }
-        break;
         case Image::TYPE::PICK:
         {
             image_create_info.setImageType(vk::ImageType::e2D).setFormat(vk::Format::eR32G32B32A32Sint)
                         .setExtent({static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1}).setMipLevels(1).setArrayLayers(1)
                         .setSamples(vk::SampleCountFlagBits::e1).setTiling(vk::ImageTiling::eOptimal)
-                        .setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc);
+                        .setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eStorage);
             alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
         }
         break;
@@ -359,12 +584,64 @@ namespace NEGUI2
             spdlog::error("Invalid image type");
             break;
         }
+        return allocate_image_(key, image_create_info, alloc_create_info, type);
+    }
+
+    bool MemoryManager::add_texture_image(const std::string &key, const uint32_t &width, const uint32_t &height, const vk::Format &format, const uint32_t &mip_levels)
+    {
+        remove_image(key);
+
+        vk::ImageCreateInfo image_create_info;
+        image_create_info.setImageType(vk::ImageType::e2D)
+            .setFormat(format)
+            .setExtent({width, height, 1u})
+            .setMipLevels(mip_levels)
+            .setArrayLayers(1)
+            .setInitialLayout(vk::ImageLayout::eUndefined)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setUsage(vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled)
+            .setSharingMode(vk::SharingMode::eExclusive);
+
+        VmaAllocationCreateInfo alloc_create_info{};
+        alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+        alloc_create_info.flags = VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+        return allocate_image_(key, image_create_info, alloc_create_info, Image::TYPE::TEXTURE);
+    }
+
+    bool MemoryManager::allocate_image_(const std::string &key, const vk::ImageCreateInfo &image_create_info, VmaAllocationCreateInfo &alloc_create_info, const Image::TYPE &type)
+    {
+        const uint32_t width = image_create_info.extent.width;
+        const uint32_t height = image_create_info.extent.height;
         VkImage image;
         VmaAllocation alloc;
         VmaAllocationInfo alloc_info; // TODO 改名
-        vmaCreateImage(allocator_, reinterpret_cast<const VkImageCreateInfo *>(&image_create_info), &alloc_create_info, &image, &alloc, &alloc_info);
-        auto device = *Core::get_instance().gpu.device;
-        images_.insert({key, Image{vk::Image(image), image_create_info.format, alloc, alloc_info, type}});
+        auto create_image = [&]()
+        {
+            return vmaCreateImage(allocator_, reinterpret_cast<const VkImageCreateInfo *>(&image_create_info), &alloc_create_info, &image, &alloc, &alloc_info);
+        };
+        auto result = create_image();
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && (alloc_create_info.flags & VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT))
+        {
+            relieve_pressure_(static_cast<size_t>(width) * static_cast<size_t>(height) * 16u);
+            result = create_image();
+            if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY)
+            {
+                spdlog::warn("Memory budget exceeded: {} ({} x {})", key, width, height);
+                alloc_create_info.flags &= ~VMA_ALLOCATION_CREATE_WITHIN_BUDGET_BIT;
+                result = create_image();
+            }
+        }
+
+        if (result != VK_SUCCESS)
+        {
+            spdlog::error("Failed to allocate image {} ({} x {}): {}", key, width, height, vk::to_string(vk::Result(result)));
+            return false;
+        }
+
+        images_.insert({key, Image{vk::Image(image), image_create_info.format, alloc, alloc_info, type,
+                                   static_cast<uint32_t>(width), static_cast<uint32_t>(height), image_create_info.mipLevels}});
+        category_bytes_[static_cast<size_t>(CATEGORY::IMAGE)] += alloc_info.size;
 
         return true;
     }
@@ -375,19 +652,35 @@ namespace NEGUI2
         if (images_.count(key) != 0)
         {
             auto &image = images_.at(key);
-            vmaDestroyImage(allocator_, image.image, image.alloc);
+            category_bytes_[static_cast<size_t>(CATEGORY::IMAGE)] -= image.alloc_info.size;
+            defer_release([allocator = allocator_, image = image.image, alloc = image.alloc]()
+                          { vmaDestroyImage(allocator, image, alloc); });
             images_.erase(key);
             ret = true;
         }
         return ret;
     }
 
+    bool MemoryManager::rename_image(const std::string &from, const std::string &to)
+    {
+        auto node = images_.extract(from);
+        if (node.empty())
+            return false;
+
+        remove_image(to);
+        node.key() = to;
+        images_.insert(std::move(node));
+        return true;
+    }
+
     bool MemoryManager::upload_image(const std::string &key, const void *data, const uint32_t &width, const uint32_t &height, const size_t offset)
     {
+        NEGUI2_TRACE_SCOPE("MemoryManager::upload_image");
         if (images_.count(key) == 0 || width * height == 0)
         {
             return false;
         }
+        upload_serial_++;
 
         /* イメージサイズを計算 */
         constexpr uint32_t CHANNELS = 4u;
@@ -410,37 +703,32 @@ namespace NEGUI2
                               VMA_ALLOCATION_CREATE_MAPPED_BIT;
             VkBuffer buffer;
             VmaAllocation allocation;
-            vmaCreateBuffer(allocator_, &bufferInfo, &alloc_create_info, &stage_buffer, &stage_allocation, &alloc_info);
+            if (vmaCreateBuffer(allocator_, &bufferInfo, &alloc_create_info, &stage_buffer, &stage_allocation, &alloc_info) != VK_SUCCESS)
+                return false;
         }
 
         /* ステージにデータコピー */
         {
             std::memcpy(alloc_info.pMappedData, data, image_size);
             vmaFlushAllocation(allocator_, stage_allocation, 0, VK_WHOLE_SIZE);
-            Core::get_instance().gpu.one_shot([&](vk::raii::CommandBuffer &command_buffer)
-                                              {
+            Core::get_instance().gpu.one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                                                    {
                     auto &target = images_.at(key);
-                    
-                    /* データ変換 */
-                    {
-                        vk::ImageSubresourceRange subresource;
-                        subresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
-                                   .setBaseMipLevel(0)
-                                   .setLevelCount(1)
-                                   .setBaseArrayLayer(0)
-                                   .setLayerCount(1);
+                    vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, target.mip_levels, 0, 1};
 
+                    /* 全ミップを転送先レイアウトへ (内容は捨てる. 提出済みフレームのサンプルとはキュー順の実行依存で同期) */
+                    {
                         vk::ImageMemoryBarrier transfer_barrier;
                         transfer_barrier.setOldLayout(vk::ImageLayout::eUndefined)
                                         .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
                                         .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
                                         .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
                                         .setImage(target.image)
-                                        .setSubresourceRange(subresource)
+                                        .setSubresourceRange(range)
                                         .setSrcAccessMask(vk::AccessFlagBits::eNone)
                                         .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
-                        
-                        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+
+                        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader,
                                                        vk::PipelineStageFlagBits::eTransfer,
                                                        {},
                                                        {},
@@ -458,39 +746,624 @@ namespace NEGUI2
                     std::array<vk::BufferImageCopy, 1> copyRegions{copy_region};
                     command_buffer.copyBufferToImage(stage_buffer, target.image, vk::ImageLayout::eTransferDstOptimal, copyRegions);
 
-                    /* データ変換 */
+                    /* ブリットで下位ミップを生成. 生成し終えたミップから読み取り専用へ */
+                    int32_t mip_width = static_cast<int32_t>(width);
+                    int32_t mip_height = static_cast<int32_t>(height);
+                    for (uint32_t level = 0u; level < target.mip_levels; level++)
                     {
-                        vk::ImageSubresourceRange subresource;
-                        subresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
-                                   .setBaseMipLevel(0)
-                                   .setLevelCount(1)
-                                   .setBaseArrayLayer(0)
-                                   .setLayerCount(1);
+                        vk::ImageMemoryBarrier barrier;
+                        barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                               .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                               .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                               .setImage(target.image)
+                               .setSubresourceRange({vk::ImageAspectFlagBits::eColor, level, 1, 0, 1})
+                               .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
 
-                        vk::ImageMemoryBarrier transfer_barrier;
-                        transfer_barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
-                                        .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-                                        .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
-                                        .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
-                                        .setImage(target.image)
-                                        .setSubresourceRange(subresource)
-                                        .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
-                                        .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
-                        
-                        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                                       vk::PipelineStageFlagBits::eFragmentShader,
-                                                       {},
-                                                       {},
-                                                       {},
-                                                       {transfer_barrier});
+                        if (level + 1u == target.mip_levels)
+                        {
+                            barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                                   .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+                            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                                           {}, {}, {}, {barrier});
+                            break;
+                        }
+
+                        barrier.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+                               .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+                        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                                                       {}, {}, {}, {barrier});
+
+                        int32_t next_width = std::max(mip_width / 2, 1);
+                        int32_t next_height = std::max(mip_height / 2, 1);
+                        vk::ImageBlit blit;
+                        blit.setSrcSubresource({vk::ImageAspectFlagBits::eColor, level, 0, 1})
+                            .setSrcOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{mip_width, mip_height, 1}})
+                            .setDstSubresource({vk::ImageAspectFlagBits::eColor, level + 1u, 0, 1})
+                            .setDstOffsets({vk::Offset3D{0, 0, 0}, vk::Offset3D{next_width, next_height, 1}});
+                        command_buffer.blitImage(target.image, vk::ImageLayout::eTransferSrcOptimal,
+                                                 target.image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+                        barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+                               .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                               .setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+                               .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+                        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                                       {}, {}, {}, {barrier});
+
+                        mip_width = next_width;
+                        mip_height = next_height;
+                    } });
+        }
+
+        /* 転送の完了後にステージバッファ削除 */
+        auto allocator = allocator_;
+        defer_release([allocator, stage_buffer, stage_allocation]()
+                      { vmaDestroyBuffer(allocator, stage_buffer, stage_allocation); });
+
+        return true;
+    }
+
+    bool MemoryManager::upload_image_levels(const std::string &key, const void *data, const size_t &size, const std::vector<vk::BufferImageCopy> &regions)
+    {
+        NEGUI2_TRACE_SCOPE("MemoryManager::upload_image_levels");
+        if (images_.count(key) == 0 || size == 0 || regions.empty())
+        {
+            return false;
+        }
+        upload_serial_++;
+
+        /* ステージングバッファ生成 */
+        VkBuffer stage_buffer;
+        VmaAllocation stage_allocation;
+        VmaAllocationInfo alloc_info;
+        {
+            VkBufferCreateInfo buffer_info{};
+            buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            buffer_info.size = size;
+            buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VmaAllocationCreateInfo alloc_create_info{};
+            alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+            alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                      VMA_ALLOCATION_CREATE_MAPPED_BIT;
+            if (vmaCreateBuffer(allocator_, &buffer_info, &alloc_create_info, &stage_buffer, &stage_allocation, &alloc_info) != VK_SUCCESS)
+                return false;
+        }
+
+        /* 各ミップをそのままコピー (ミップ生成は行わない) */
+        std::memcpy(alloc_info.pMappedData, data, size);
+        vmaFlushAllocation(allocator_, stage_allocation, 0, VK_WHOLE_SIZE);
+        Core::get_instance().gpu.one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                                                {
+                auto &target = images_.at(key);
+                vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, target.mip_levels, 0, 1};
+
+                vk::ImageMemoryBarrier barrier;
+                barrier.setOldLayout(vk::ImageLayout::eUndefined)
+                       .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+                       .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                       .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                       .setImage(target.image)
+                       .setSubresourceRange(range)
+                       .setSrcAccessMask(vk::AccessFlagBits::eNone)
+                       .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+                command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                                               {}, {}, {}, {barrier});
+
+                command_buffer.copyBufferToImage(stage_buffer, target.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+                barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                       .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                       .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                       .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+                command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                               {}, {}, {}, {barrier}); });
+
+        /* 転送の完了後にステージバッファ削除 */
+        auto allocator = allocator_;
+        defer_release([allocator, stage_buffer, stage_allocation]()
+                      { vmaDestroyBuffer(allocator, stage_buffer, stage_allocation); });
+
+        return true;
+    }
+
+    bool MemoryManager::upload_image_region(const std::string &key, const void *data, const uint32_t &row_length, const vk::Offset2D &offset, const vk::Extent2D &extent)
+    {
+        NEGUI2_TRACE_SCOPE("MemoryManager::upload_image_region");
+        auto it = images_.find(key);
+        if (it == images_.end() || extent.width == 0u || extent.height == 0u || offset.x < 0 || offset.y < 0 ||
+            static_cast<uint32_t>(offset.x) + extent.width > it->second.width ||
+            static_cast<uint32_t>(offset.y) + extent.height > it->second.height)
+        {
+            return false;
+        }
+        upload_serial_++;
+
+        constexpr uint32_t CHANNELS = 4u;
+        const size_t row_size = static_cast<size_t>(CHANNELS) * extent.width;
+        const size_t region_size = row_size * extent.height;
+
+        /* ステージングバッファ生成 (矩形分のみ) */
+        VkBuffer stage_buffer;
+        VmaAllocation stage_allocation;
+        VmaAllocationInfo alloc_info;
+        {
+            VkBufferCreateInfo buffer_info{};
+            buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            buffer_info.size = region_size;
+            buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VmaAllocationCreateInfo alloc_create_info{};
+            alloc_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+            alloc_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                      VMA_ALLOCATION_CREATE_MAPPED_BIT;
+            if (vmaCreateBuffer(allocator_, &buffer_info, &alloc_create_info, &stage_buffer, &stage_allocation, &alloc_info) != VK_SUCCESS)
+                return false;
+        }
+
+        /* 矩形の行を詰めてコピー */
+        auto source = static_cast<const uint8_t *>(data);
+        auto stage = static_cast<uint8_t *>(alloc_info.pMappedData);
+        for (uint32_t row = 0u; row < extent.height; row++)
+        {
+            size_t source_offset = ((static_cast<size_t>(offset.y) + row) * row_length + static_cast<size_t>(offset.x)) * CHANNELS;
+            std::memcpy(stage + row_size * row, source + source_offset, row_size);
+        }
+        vmaFlushAllocation(allocator_, stage_allocation, 0, VK_WHOLE_SIZE);
+
+        auto &target = it->second;
+        auto &core = Core::get_instance();
+        core.gpu.one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                                {
+                vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, target.mip_levels, 0, 1};
+
+                /* 提出済みフレームのサンプルとはキュー順の実行依存で同期 (内容は保持) */
+                {
+                    vk::ImageMemoryBarrier transfer_barrier;
+                    transfer_barrier.setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                                    .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+                                    .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                                    .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                                    .setImage(target.image)
+                                    .setSubresourceRange(range)
+                                    .setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+                                    .setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+                    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                                                   {}, {}, {}, {transfer_barrier});
+                }
+
+                vk::BufferImageCopy copy_region;
+                copy_region.setBufferOffset(0)
+                           .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1})
+                           .setImageOffset({offset.x, offset.y, 0})
+                           .setImageExtent({extent.width, extent.height, 1});
+                command_buffer.copyBufferToImage(stage_buffer, target.image, vk::ImageLayout::eTransferDstOptimal, copy_region);
+
+                /* 下位ミップは矩形を含む範囲だけブリットで作り直す */
+                int32_t mip_width = static_cast<int32_t>(target.width);
+                int32_t mip_height = static_cast<int32_t>(target.height);
+                int32_t x0 = offset.x;
+                int32_t y0 = offset.y;
+                int32_t x1 = offset.x + static_cast<int32_t>(extent.width);
+                int32_t y1 = offset.y + static_cast<int32_t>(extent.height);
+                for (uint32_t level = 0u; level < target.mip_levels; level++)
+                {
+                    vk::ImageMemoryBarrier barrier;
+                    barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+                           .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored)
+                           .setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                           .setImage(target.image)
+                           .setSubresourceRange({vk::ImageAspectFlagBits::eColor, level, 1, 0, 1})
+                           .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+
+                    if (level + 1u == target.mip_levels)
+                    {
+                        barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                               .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+                        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                                       {}, {}, {}, {barrier});
+                        break;
                     }
-                    
-                    return vk::Result::eSuccess; });
+
+                    barrier.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+                           .setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+                    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+                                                   {}, {}, {}, {barrier});
+
+                    /* 2x2の親画素が揃うよう次レベルの矩形を外側へ丸める */
+                    int32_t next_width = std::max(mip_width / 2, 1);
+                    int32_t next_height = std::max(mip_height / 2, 1);
+                    int32_t next_x0 = x0 / 2;
+                    int32_t next_y0 = y0 / 2;
+                    int32_t next_x1 = std::min((x1 + 1) / 2, next_width);
+                    int32_t next_y1 = std::min((y1 + 1) / 2, next_height);
+                    vk::ImageBlit blit;
+                    blit.setSrcSubresource({vk::ImageAspectFlagBits::eColor, level, 0, 1})
+                        .setSrcOffsets({vk::Offset3D{next_x0 * 2, next_y0 * 2, 0},
+                                        vk::Offset3D{std::min(next_x1 * 2, mip_width), std::min(next_y1 * 2, mip_height), 1}})
+                        .setDstSubresource({vk::ImageAspectFlagBits::eColor, level + 1u, 0, 1})
+                        .setDstOffsets({vk::Offset3D{next_x0, next_y0, 0}, vk::Offset3D{next_x1, next_y1, 1}});
+                    command_buffer.blitImage(target.image, vk::ImageLayout::eTransferSrcOptimal,
+                                             target.image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+                    barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal)
+                           .setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                           .setSrcAccessMask(vk::AccessFlagBits::eTransferRead)
+                           .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+                    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                                   {}, {}, {}, {barrier});
+
+                    mip_width = next_width;
+                    mip_height = next_height;
+                    x0 = next_x0;
+                    y0 = next_y0;
+                    x1 = next_x1;
+                    y1 = next_y1;
+                } });
+
+        /* 転送の完了後にステージバッファ削除 */
+        auto allocator = allocator_;
+        defer_release([allocator, stage_buffer, stage_allocation]()
+                      { vmaDestroyBuffer(allocator, stage_buffer, stage_allocation); });
+
+        return true;
+    }
+
+    uint32_t MemoryManager::mip_level_count(const uint32_t &width, const uint32_t &height)
+    {
+        uint32_t levels = 1u;
+        for (uint32_t size = std::max(width, height); size > 1u; size >>= 1u)
+        {
+            levels++;
         }
+        return levels;
+    }
 
-        /* ステージバッファ削除 */
-        vmaDestroyBuffer(allocator_, stage_buffer, stage_allocation);
+    const char *MemoryManager::category_name(const CATEGORY &category)
+    {
+        switch (category)
+        {
+        case CATEGORY::VERTEX:
+            return "Vertex";
+        case CATEGORY::INDEX:
+            return "Index";
+        case CATEGORY::UNIFORM:
+            return "Uniform";
+        case CATEGORY::SSBO:
+            return "SSBO";
+        case CATEGORY::IMAGE:
+            return "Image";
+        default:
+            return "Unknown";
+        }
+    }
+
+    void MemoryManager::update_budget()
+    {
+        /* VMAはフレーム番号が変わった時に予算を再取得する */
+        vmaSetCurrentFrameIndex(allocator_, ++frame_index_);
+
+        for (const auto &budget : get_budgets())
+        {
+            if (budget.budget == 0u)
+                continue;
 
+            double usage = static_cast<double>(budget.usage) / static_cast<double>(budget.budget);
+            if (usage > high_watermark)
+            {
+                size_t target = static_cast<size_t>(low_watermark * static_cast<double>(budget.budget));
+                auto freed = relieve_pressure_(static_cast<size_t>(budget.usage) - target);
+                spdlog::debug("Memory pressure {:.1f}%: released {} bytes", usage * 100.0, freed);
+            }
+        }
+    }
+
+    std::vector<VmaBudget> MemoryManager::get_budgets() const
+    {
+        const VkPhysicalDeviceMemoryProperties *properties = nullptr;
+        vmaGetMemoryProperties(allocator_, &properties);
+
+        std::vector<VmaBudget> budgets(properties->memoryHeapCount);
+        vmaGetHeapBudgets(allocator_, budgets.data());
+        return budgets;
+    }
+
+    size_t MemoryManager::get_category_bytes(const CATEGORY &category) const
+    {
+        return category_bytes_[static_cast<size_t>(category)];
+    }
+
+    bool MemoryManager::create_buffer(const vk::BufferCreateInfo &create_info, const VmaAllocationCreateInfo &alloc_create_info, const CATEGORY &category,
+                                      vk::Buffer &buffer, VmaAllocation &alloc, VmaAllocationInfo &alloc_info)
+    {
+        VkBuffer raw_buffer;
+        if (vmaCreateBuffer(allocator_, reinterpret_cast<const VkBufferCreateInfo *>(&create_info), &alloc_create_info,
+                            &raw_buffer, &alloc, &alloc_info) != VK_SUCCESS)
+        {
+            return false;
+        }
+        buffer = raw_buffer;
+        category_bytes_[static_cast<size_t>(category)] += alloc_info.size;
         return true;
     }
+
+    void MemoryManager::destroy_buffer(const vk::Buffer &buffer, VmaAllocation alloc, const CATEGORY &category)
+    {
+        VmaAllocationInfo alloc_info;
+        vmaGetAllocationInfo(allocator_, alloc, &alloc_info);
+        category_bytes_[static_cast<size_t>(category)] -= alloc_info.size;
+        vmaDestroyBuffer(allocator_, buffer, alloc);
+    }
+
+    VmaAllocation MemoryManager::allocate_image_memory(const vk::MemoryRequirements &requirements)
+    {
+        VmaAllocationCreateInfo alloc_create_info = {};
+        alloc_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VkMemoryRequirements raw_requirements = requirements;
+        VmaAllocation alloc;
+        VmaAllocationInfo alloc_info;
+        if (vmaAllocateMemory(allocator_, &raw_requirements, &alloc_create_info, &alloc, &alloc_info) != VK_SUCCESS)
+            return nullptr;
+
+        category_bytes_[static_cast<size_t>(CATEGORY::IMAGE)] += alloc_info.size;
+        return alloc;
+    }
+
+    bool MemoryManager::bind_image_memory(VmaAllocation alloc, const vk::Image &image)
+    {
+        return vmaBindImageMemory(allocator_, alloc, image) == VK_SUCCESS;
+    }
+
+    void MemoryManager::free_image_memory(VmaAllocation alloc)
+    {
+        VmaAllocationInfo alloc_info;
+        vmaGetAllocationInfo(allocator_, alloc, &alloc_info);
+        category_bytes_[static_cast<size_t>(CATEGORY::IMAGE)] -= alloc_info.size;
+        vmaFreeMemory(allocator_, alloc);
+    }
+
+    void MemoryManager::flush_allocation(VmaAllocation alloc, const vk::DeviceSize &offset, const vk::DeviceSize &size)
+    {
+        /* コヒーレントなメモリではVMAが何もしない */
+        vmaFlushAllocation(allocator_, alloc, offset, size);
+    }
+
+    vk::Format MemoryManager::get_depth_format() const
+    {
+        return ::get_depth_format(Core::get_instance().gpu.physical_device);
+    }
+
+    void MemoryManager::add_pressure_handler(const PressureHandler &handler)
+    {
+        pressure_handlers_.push_back(handler);
+    }
+
+    size_t MemoryManager::relieve_pressure_(const size_t &requested)
+    {
+        size_t freed = 0u;
+        for (auto &handler : pressure_handlers_)
+        {
+            if (freed >= requested)
+                break;
+            freed += handler(requested - freed);
+        }
+        return freed;
+    }
+
+    std::string MemoryManager::dump_statistics() const
+    {
+        std::ostringstream stream;
+        stream << "{\"Categories\":{";
+        for (size_t i = 0; i < CATEGORY_COUNT; i++)
+        {
+            stream << (i == 0 ? "" : ",") << "\"" << category_name(static_cast<CATEGORY>(i)) << "\":" << category_bytes_[i];
+        }
+        stream << "},\"Vma\":";
+
+        char *vma_stats = nullptr;
+        vmaBuildStatsString(allocator_, &vma_stats, VK_TRUE);
+        stream << vma_stats;
+        vmaFreeStatsString(allocator_, vma_stats);
+
+        stream << "}";
+        return stream.str();
+    }
+
+    bool MemoryManager::write_statistics(const std::string &path) const
+    {
+        std::ofstream stream(path);
+        if (!stream)
+        {
+            spdlog::error("Failed to open memory statistics file: {}", path);
+            return false;
+        }
+        stream << dump_statistics();
+        return static_cast<bool>(stream);
+    }
+
+    bool MemoryManager::request_defragmentation()
+    {
+        if (defragmentation_context_ != nullptr)
+            return false;
+
+        VmaDefragmentationInfo info{};
+        info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+        info.maxAllocationsPerPass = max_defragmentation_moves;
+        auto result = vmaBeginDefragmentation(allocator_, &info, &defragmentation_context_);
+        if (result != VK_SUCCESS)
+        {
+            spdlog::error("Failed to begin defragmentation: {}", vk::to_string(vk::Result(result)));
+            defragmentation_context_ = nullptr;
+            return false;
+        }
+
+        spdlog::info("Begin GPU memory defragmentation");
+        return true;
+    }
+
+    bool MemoryManager::is_defragmenting() const
+    {
+        return defragmentation_context_ != nullptr;
+    }
+
+    void MemoryManager::defragment_step()
+    {
+        /* 前のパスの完了待ち */
+        if (defragmentation_pending_)
+            return;
+
+        /* 断片化率の確認は数秒毎 (統計計算は全アロケーションを走査するため) */
+        constexpr auto CHECK_INTERVAL = std::chrono::seconds(5);
+        if (defragmentation_context_ == nullptr)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (!defragmentation || now - defragmentation_checked_ < CHECK_INTERVAL)
+                return;
+            defragmentation_checked_ = now;
+
+            VmaTotalStatistics stats;
+            vmaCalculateStatistics(allocator_, &stats);
+            auto block_bytes = stats.total.statistics.blockBytes;
+            auto unused_bytes = block_bytes - stats.total.statistics.allocationBytes;
+            if (block_bytes == 0u || static_cast<double>(unused_bytes) / static_cast<double>(block_bytes) < defragmentation_threshold)
+                return;
+
+            if (!request_defragmentation())
+                return;
+        }
+
+        defragment_pass_();
+    }
+
+    void MemoryManager::defragment_pass_()
+    {
+        defragmentation_pass_ = {};
+        auto result = vmaBeginDefragmentationPass(allocator_, defragmentation_context_, &defragmentation_pass_);
+        if (result == VK_SUCCESS)
+        {
+            end_defragmentation_();
+            return;
+        }
+        if (result != VK_INCOMPLETE)
+        {
+            spdlog::error("Defragmentation pass failed: {}", vk::to_string(vk::Result(result)));
+            end_defragmentation_();
+            return;
+        }
+
+        auto &gpu = Core::get_instance().gpu;
+        vk::Device device = *gpu.device;
+        std::vector<std::pair<Memory *, vk::Buffer>> moved;
+        defragmentation_moved_.clear();
+        for (uint32_t i = 0; i < defragmentation_pass_.moveCount; i++)
+        {
+            auto &move = defragmentation_pass_.pMoves[i];
+
+            /* イメージは移動しない. ビューとバインドレス/ImGuiの記述子を張り替える仕組みが無いため */
+            auto it = allocation_keys_.find(move.srcAllocation);
+            if (it == allocation_keys_.end())
+            {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+
+            /* ユニフォーム/ストレージは記述子とマップ済みポインタから参照されるので移動しない */
+            auto &memory = memories_.at(it->second);
+            if (memory.type != Memory::TYPE::VERTEX && memory.type != Memory::TYPE::INDEX)
+            {
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+
+            vk::BufferCreateInfo buffer_info;
+            buffer_info.setSize(memory.size).setUsage(memory.usage).setSharingMode(vk::SharingMode::eExclusive);
+            vk::Buffer buffer = device.createBuffer(buffer_info);
+            if (vmaBindBufferMemory(allocator_, move.dstTmpAllocation, buffer) != VK_SUCCESS)
+            {
+                device.destroyBuffer(buffer);
+                move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                continue;
+            }
+            moved.push_back({&memory, buffer});
+            defragmentation_moved_.push_back(it->second);
+        }
+
+        if (moved.empty())
+        {
+            /* GPUは何も参照していないのでそのまま閉じる */
+            defragmentation_pending_ = true;
+            end_defragmentation_pass_();
+            return;
+        }
+
+        /* コピーは待たずに提出. 以降のフレームは新しいバッファを使い, キュー順とバリアで同期 */
+        gpu.one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                           {
+                vk::MemoryBarrier before(vk::AccessFlagBits::eMemoryWrite, vk::AccessFlagBits::eTransferRead);
+                command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eTransfer,
+                                               {}, before, {}, {});
+                for (auto &move : moved)
+                {
+                    vk::BufferCopy region{0, 0, move.first->size};
+                    command_buffer.copyBuffer(move.first->buffer, move.second, region);
+                }
+                vk::MemoryBarrier after(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eMemoryRead);
+                command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands,
+                                               {}, after, {}, {}); });
+
+        for (auto &move : moved)
+        {
+            defer_release([device, buffer = move.first->buffer]()
+                          { device.destroyBuffer(buffer); });
+            move.first->buffer = move.second;
+        }
+        defragmentation_pending_ = true;
+        schedule_end_defragmentation_pass_();
+    }
+
+    void MemoryManager::schedule_end_defragmentation_pass_()
+    {
+        /* 旧メモリを参照する提出がすべて終わってからVMAへ返す. 積み直したら前の完了処理は何もしない */
+        auto generation = ++defragmentation_generation_;
+        defer_release([this, generation]()
+                      {
+            if (generation == defragmentation_generation_)
+                end_defragmentation_pass_(); });
+    }
+
+    void MemoryManager::end_defragmentation_pass_()
+    {
+        if (!defragmentation_pending_)
+            return;
+        defragmentation_pending_ = false;
+
+        auto result = vmaEndDefragmentationPass(allocator_, defragmentation_context_, &defragmentation_pass_);
+        for (const auto &key : defragmentation_moved_)
+        {
+            auto it = memories_.find(key);
+            if (it != memories_.end())
+            {
+                vmaGetAllocationInfo(allocator_, it->second.alloc, &it->second.alloc_info);
+            }
+        }
+        defragmentation_moved_.clear();
+        defragmentation_pass_ = {};
+
+        /* VK_INCOMPLETEなら次の休止中に次のパス */
+        if (result == VK_SUCCESS)
+        {
+            end_defragmentation_();
+        }
+    }
+
+    void MemoryManager::end_defragmentation_()
+    {
+        vmaEndDefragmentation(allocator_, defragmentation_context_, &last_defragmentation_stats);
+        defragmentation_context_ = nullptr;
+        spdlog::info("GPU memory defragmentation finished: {} allocations moved ({} bytes), {} bytes freed ({} blocks)",
+                     last_defragmentation_stats.allocationsMoved, last_defragmentation_stats.bytesMoved,
+                     last_defragmentation_stats.bytesFreed, last_defragmentation_stats.deviceMemoryBlocksFreed);
+    }
 }
\ No newline at end of file
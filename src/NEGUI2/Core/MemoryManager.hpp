@@ -1,7 +1,12 @@
 #ifndef _MEMORY_MANAGER_HPP
 #define _MEMORY_MANAGER_HPP
 #include <unordered_map>
+#include <chrono>
 #include <string>
+#include <array>
+#include <vector>
+#include <functional>
+#include <deque>
 #include <vulkan/vulkan_raii.hpp>
 #include <vk_mem_alloc.h>
 #include <Eigen/Dense>
@@ -19,9 +24,12 @@ namespace NEGUI2
             VERTEX = 1,
             INDEX = 2,
             UNIFORM = 3,
-            SSBO = 4
+            SSBO = 4,
+            READBACK = 5
         };
         TYPE type;
+        vk::DeviceSize size;
+        vk::BufferUsageFlags usage;
     };
 
     struct Image
@@ -38,30 +46,133 @@ namespace NEGUI2
             PICK = 4,
         };
         TYPE type;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mip_levels;
     };
 
     class MemoryManager
     {
+    public:
+        /* 統計用のリソース分類 */
+        enum class CATEGORY : uint32_t
+        {
+            VERTEX = 0,
+            INDEX = 1,
+            UNIFORM = 2,
+            SSBO = 3,
+            IMAGE = 4,
+            COUNT = 5
+        };
+        static constexpr size_t CATEGORY_COUNT = static_cast<size_t>(CATEGORY::COUNT);
+        static const char *category_name(const CATEGORY &category);
+
+        /* 予算逼迫時に呼ばれる. 解放を要求するバイト数を受け取り, 解放したバイト数を返す */
+        using PressureHandler = std::function<size_t(const size_t &requested)>;
+
+    private:
         friend class Core;
         VmaAllocator allocator_;
         std::unordered_map<std::string, Memory> memories_;
         std::unordered_map<std::string, Image> images_;
+        std::array<size_t, CATEGORY_COUNT> category_bytes_;
+        std::vector<PressureHandler> pressure_handlers_;
+        uint32_t frame_index_;
+        std::unordered_map<VmaAllocation, std::string> allocation_keys_;
+        VmaDefragmentationContext defragmentation_context_;
+        std::chrono::steady_clock::time_point defragmentation_checked_;
+        /* コピーを提出して完了待ちのパス. 旧バッファを使う提出が終わるまでVMAへ返さない */
+        VmaDefragmentationPassMoveInfo defragmentation_pass_;
+        std::vector<std::string> defragmentation_moved_;
+        bool defragmentation_pending_;
+        uint64_t defragmentation_generation_; // 完了処理を積み直した時に古いものを無効にする
+
+        /* マップ書き込みの未フラッシュ範囲 [begin, end) */
+        struct DirtyRange
+        {
+            vk::DeviceSize begin;
+            vk::DeviceSize end;
+        };
+        std::unordered_map<std::string, DirtyRange> dirty_ranges_;
+        uint64_t upload_serial_; // 書き込み/転送のたびに増える
+
+        /* 遅延破棄. GPUが提出値を過ぎてから実行する (値0は記録中のフレームで未確定) */
+        struct Release
+        {
+            uint64_t value;
+            std::function<void()> release;
+        };
+        std::deque<Release> releases_;
         MemoryManager();
         void init();
         MemoryManager(const MemoryManager& other) = delete;
         MemoryManager& operator=(const MemoryManager& other) = delete;
+        size_t relieve_pressure_(const size_t &requested);
+        bool allocate_image_(const std::string &key, const vk::ImageCreateInfo &image_create_info, VmaAllocationCreateInfo &alloc_create_info, const Image::TYPE &type);
+        void defragment_pass_();
+        void schedule_end_defragmentation_pass_();
+        void end_defragmentation_pass_();
+        void end_defragmentation_();
     public:
         ~MemoryManager();
+        double high_watermark; // 予算に対する使用率の上限
+        double low_watermark;  // 解放時の目標使用率
+
+        void update_budget();
+        std::vector<VmaBudget> get_budgets() const;
+        size_t get_category_bytes(const CATEGORY &category) const;
+        void add_pressure_handler(const PressureHandler &handler);
+        std::string dump_statistics() const;
+        bool write_statistics(const std::string &path) const;
+
+        /* デフラグ (頂点/インデックスバッファのみ移動). Coreが描画の無い休止中だけ進める */
+        bool defragmentation;               // 断片化時に自動でデフラグを開始する
+        double defragmentation_threshold;   // 開始する未使用率 (未使用/ブロック)
+        uint32_t max_defragmentation_moves; // 1パスで移動するアロケーション数
+        VmaDefragmentationStats last_defragmentation_stats;
+        bool request_defragmentation();
+        bool is_defragmenting() const;
+        void defragment_step();
+
+        /* 呼び出し側が寿命を管理する資源 (RenderGraphの一時イメージ, FrameAllocatorのチャンク). 分類毎の使用量はここで数える */
+        bool create_buffer(const vk::BufferCreateInfo &create_info, const VmaAllocationCreateInfo &alloc_create_info, const CATEGORY &category,
+                           vk::Buffer &buffer, VmaAllocation &alloc, VmaAllocationInfo &alloc_info);
+        void destroy_buffer(const vk::Buffer &buffer, VmaAllocation alloc, const CATEGORY &category);
+        VmaAllocation allocate_image_memory(const vk::MemoryRequirements &requirements); // デバイスローカル. 寿命の重ならないイメージで共有してよい
+        bool bind_image_memory(VmaAllocation alloc, const vk::Image &image);
+        void free_image_memory(VmaAllocation alloc);
+        void flush_allocation(VmaAllocation alloc, const vk::DeviceSize &offset, const vk::DeviceSize &size);
+        vk::Format get_depth_format() const;
+
         Memory &get_memory(const std::string &key);
         bool add_memory(const std::string &key, const size_t &size, const Memory::TYPE &type, bool rebuild = true);
         bool remove_memory(const std::string &key);
         bool upload_memory(const std::string &key, const void *data, const size_t size, const size_t offset = 0);
         bool download_memory(const std::string& key, void* data, const size_t size, const size_t offset = 0);
+        void invalidate_memory(const std::string &key);
+
+        /* マップ済みメモリへの書き込み. フラッシュはflush_memoryでまとめて行う */
+        bool write_memory(const std::string &key, const void *data, const size_t size, const size_t offset = 0);
+        void mark_dirty(const std::string &key, const size_t size = VK_WHOLE_SIZE, const size_t offset = 0);
+        void flush_memory();
+        uint64_t get_upload_serial() const;
+
+        /* 使用中かもしれないGPU資源の破棄を完了後まで遅らせる */
+        void defer_release(std::function<void()> release);
+        void seal_releases(const uint64_t &value); // 記録中のフレームの提出値を確定 (Coreが呼ぶ)
+        void process_releases();                  // 完了した分を破棄
+        size_t get_pending_release_count() const;
 
         Image &get_image(const std::string &key);
         bool add_image(const std::string &key, const int& width, const int& height, const Image::TYPE &type, bool rebuild = true);
+        bool add_texture_image(const std::string &key, const uint32_t &width, const uint32_t &height, const vk::Format &format, const uint32_t &mip_levels);
         bool remove_image(const std::string &key);
+        bool rename_image(const std::string &from, const std::string &to);
         bool upload_image(const std::string& key, const void *data, const uint32_t& width, const uint32_t& height,  const size_t offset = 0);
+        bool upload_image_levels(const std::string &key, const void *data, const size_t &size, const std::vector<vk::BufferImageCopy> &regions);
+        /* 矩形のみ転送し, その範囲の下位ミップを作り直す. 待たずに提出しステージングはdefer_releaseで破棄 */
+        bool upload_image_region(const std::string &key, const void *data, const uint32_t &row_length, const vk::Offset2D &offset, const vk::Extent2D &extent);
+        static uint32_t mip_level_count(const uint32_t &width, const uint32_t &height);
     };
 }
 
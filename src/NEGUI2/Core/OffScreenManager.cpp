@@ -1,14 +1,35 @@
 #include "NEGUI2/Core/OffScreenManager.hpp"
 #include "NEGUI2/Core/Core.hpp"
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+namespace
+{
+    /* 解像度スケールの刻み幅(ビューポートの微小な揺れを防ぐ) */
+    constexpr double RENDER_SCALE_STEP = 1.0 / 64.0;
+    /* 目標から外れた時のみ調整する不感帯 */
+    constexpr double RENDER_SCALE_DEADBAND = 0.05;
+    /* GPU時間の指数移動平均係数 */
+    constexpr double GPU_TIME_SMOOTHING = 0.1;
+    /* 1回の更新で許すスケール変化量 */
+    constexpr double MAX_SCALE_DELTA = 0.05;
+}
 
 namespace NEGUI2
 {
-    OffScreenManager::OffScreenManager() : extent{1920u, 1080u},
+    OffScreenManager::OffScreenManager() : rendering_color_formats_(), rendering_info_(),
+                                           frame_buffer_depth_view_(nullptr), upscale_rendering_info_(), upscale_render_pass_(nullptr), upscale_frame_buffer_(nullptr),
+                                           upscale_set_layout_(nullptr), upscale_pipeline_layout_(nullptr), upscale_pipeline_(nullptr),
+                                           extent{1920u, 1080u},
                                            render_pass(nullptr),
                                            sampler(nullptr),
                                            clear_value(), swap_chain_rebuild(false),
-                                           frame()
+                                           frame(), present_buffer(nullptr), present_buffer_view(nullptr),
+                                           dynamic_resolution(false), render_scale(1.0),
+                                           min_render_scale(0.5), max_render_scale(1.0),
+                                           target_frame_time_ms(1000.0 / 60.0), gpu_frame_time_ms(0.0), sharpness(0.5f)
 
     {
     }
@@ -24,9 +45,44 @@ namespace NEGUI2
             clear_value[1].setDepthStencil({1.f, 1u});
             clear_value[2].setColor({0.f, 0.f, 0.f, 0.f});
         }
+
         rebuild();
     }
 
+    vk::Extent2D OffScreenManager::get_render_extent() const
+    {
+        double scale = dynamic_resolution ? render_scale : 1.0;
+        uint32_t width = static_cast<uint32_t>(std::lround(extent.width * scale));
+        uint32_t height = static_cast<uint32_t>(std::lround(extent.height * scale));
+        return vk::Extent2D{std::clamp(width, 1u, extent.width), std::clamp(height, 1u, extent.height)};
+    }
+
+    bool OffScreenManager::update_render_scale(const double &measured_ms)
+    {
+        gpu_frame_time_ms = gpu_frame_time_ms <= 0.0 ? measured_ms
+                                                     : (1.0 - GPU_TIME_SMOOTHING) * gpu_frame_time_ms + GPU_TIME_SMOOTHING * measured_ms;
+
+        if (!dynamic_resolution || gpu_frame_time_ms <= 0.0 || target_frame_time_ms <= 0.0)
+            return false;
+
+        double ratio = target_frame_time_ms / gpu_frame_time_ms;
+        if (std::abs(ratio - 1.0) < RENDER_SCALE_DEADBAND)
+            return false;
+
+        /* GPU時間は画素数(スケールの2乗)にほぼ比例する */
+        double desired = render_scale * std::sqrt(ratio);
+        desired = std::clamp(desired, render_scale - MAX_SCALE_DELTA, render_scale + MAX_SCALE_DELTA);
+        desired = std::clamp(desired, min_render_scale, max_render_scale);
+        desired = std::round(desired / RENDER_SCALE_STEP) * RENDER_SCALE_STEP;
+        desired = std::clamp(desired, min_render_scale, max_render_scale);
+
+        if (desired == render_scale)
+            return false;
+
+        render_scale = desired;
+        return true;
+    }
+
     void OffScreenManager::rebuild()
     {
         auto &device_manager = Core::get_instance().gpu;
@@ -34,28 +90,38 @@ namespace NEGUI2
         /* フレーム作成 ********************************************************************/
         /* イメージ取得 */
         vk::Image color_buffers;
-        vk::Image depth_buffers;
         vk::Image pick_buffers;
 
+        /* 作り直したイメージのレイアウトは引き継がない */
+        Core::get_instance().graph.forget(frame.color_buffer);
+        Core::get_instance().graph.forget(frame.pick_buffer);
+        Core::get_instance().graph.forget(present_buffer);
+
         // TODO widthとheightをextentに置き換え
         /* イメージ生成 */
         memory_manager.add_image("OffScreenColor0", extent.width, extent.height, NEGUI2::Image::TYPE::COLOR);
-        memory_manager.add_image("OffScreenDepth0", extent.width, extent.height, NEGUI2::Image::TYPE::DEPTH);
         memory_manager.add_image("OffScreenPick0", extent.width, extent.height, NEGUI2::Image::TYPE::PICK);
+        memory_manager.add_image("OffScreenPresent0", extent.width, extent.height, NEGUI2::Image::TYPE::COLOR);
 
         color_buffers = memory_manager.get_image("OffScreenColor0").image;
-        depth_buffers = memory_manager.get_image("OffScreenDepth0").image;
         pick_buffers = memory_manager.get_image("OffScreenPick0").image;
 
         frame.color_buffer = color_buffers;
-        frame.depth_buffer = depth_buffers;
         frame.pick_buffer = pick_buffers;
+        present_buffer = memory_manager.get_image("OffScreenPresent0").image;
 
         color_format = memory_manager.get_image("OffScreenColor0").format;
-        depth_format = memory_manager.get_image("OffScreenDepth0").format;
+        depth_format = memory_manager.get_depth_format(); // 深度はOffScreenパス内だけで使うのでRenderGraphの一時イメージ
         pick_format = memory_manager.get_image("OffScreenPick0").format;
 
+        /* 動的レンダリングではレンダーパスもフレームバッファも作らない */
+        rendering_color_formats_ = {color_format, pick_format};
+        rendering_info_.setColorAttachmentFormats(rendering_color_formats_).setDepthAttachmentFormat(depth_format);
+        upscale_rendering_info_.setColorAttachmentFormats(color_format);
+        bool dynamic_rendering = device_manager.dynamic_rendering_supported;
+
         /* Create RenderPass */
+        if (!dynamic_rendering)
         {
             std::array<vk::AttachmentDescription, 3> attachmentDescriptions;
             attachmentDescriptions[0] = vk::AttachmentDescription({},
@@ -65,8 +131,8 @@ namespace NEGUI2
                                                                   vk::AttachmentStoreOp::eStore,
                                                                   vk::AttachmentLoadOp::eDontCare,
                                                                   vk::AttachmentStoreOp::eDontCare,
-                                                                  vk::ImageLayout::eUndefined,
-                                                                  vk::ImageLayout::eGeneral);
+                                                                  vk::ImageLayout::eColorAttachmentOptimal,
+                                                                  vk::ImageLayout::eColorAttachmentOptimal);
             attachmentDescriptions[1] = vk::AttachmentDescription({},
                                                                   depth_format,
                                                                   vk::SampleCountFlagBits::e1,
@@ -80,22 +146,38 @@ namespace NEGUI2
                                                                   pick_format,
                                                                   vk::SampleCountFlagBits::e1,
                                                                   vk::AttachmentLoadOp::eClear,
-                                                                  vk::AttachmentStoreOp::eDontCare,
+                                                                  vk::AttachmentStoreOp::eStore,
                                                                   vk::AttachmentLoadOp::eDontCare,
                                                                   vk::AttachmentStoreOp::eDontCare,
-                                                                  vk::ImageLayout::eUndefined,
-                                                                  vk::ImageLayout::eGeneral);
+                                                                  vk::ImageLayout::eColorAttachmentOptimal,
+                                                                  vk::ImageLayout::eColorAttachmentOptimal);
 
-            vk::AttachmentReference colorReference(0, vk::ImageLayout::eGeneral);
-            vk::AttachmentReference pickReference(2, vk::ImageLayout::eGeneral);
+            /* レイアウト遷移はRenderGraphが行う */
+            vk::AttachmentReference colorReference(0, vk::ImageLayout::eColorAttachmentOptimal);
+            vk::AttachmentReference pickReference(2, vk::ImageLayout::eColorAttachmentOptimal);
             std::array<vk::AttachmentReference, 2> references;
-            references[0] = vk::AttachmentReference(0, vk::ImageLayout::eGeneral);
-            references[1] = vk::AttachmentReference(2, vk::ImageLayout::eGeneral);
+            references[0] = vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal);
+            references[1] = vk::AttachmentReference(2, vk::ImageLayout::eColorAttachmentOptimal);
             vk::AttachmentReference depthReference(1, vk::ImageLayout::eDepthStencilAttachmentOptimal);
             vk::SubpassDescription subpass({}, vk::PipelineBindPoint::eGraphics, {}, references, {}, &depthReference);
 
             vk::RenderPassCreateInfo renderPassCreateInfo({}, attachmentDescriptions, subpass);
             render_pass = device_manager.device.createRenderPass(renderPassCreateInfo);
+
+            /* 拡大先は全画素を書くので読み込まない */
+            vk::AttachmentDescription present_description({},
+                                                          color_format,
+                                                          vk::SampleCountFlagBits::e1,
+                                                          vk::AttachmentLoadOp::eDontCare,
+                                                          vk::AttachmentStoreOp::eStore,
+                                                          vk::AttachmentLoadOp::eDontCare,
+                                                          vk::AttachmentStoreOp::eDontCare,
+                                                          vk::ImageLayout::eColorAttachmentOptimal,
+                                                          vk::ImageLayout::eColorAttachmentOptimal);
+            vk::AttachmentReference present_reference(0, vk::ImageLayout::eColorAttachmentOptimal);
+            vk::SubpassDescription present_subpass({}, vk::PipelineBindPoint::eGraphics, {}, present_reference);
+            vk::RenderPassCreateInfo present_create_info({}, present_description, present_subpass);
+            upscale_render_pass_ = device_manager.device.createRenderPass(present_create_info);
         }
 
         {
@@ -127,13 +209,6 @@ namespace NEGUI2
         color_view_create_info.subresourceRange = color_image_range;
         frame.color_buffer_view = device_manager.device.createImageView(color_view_create_info);
 
-        /* 深度 */
-        vk::ImageViewCreateInfo depth_view_create_info({}, {}, vk::ImageViewType::e2D, depth_format, {}, {vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1});
-        depth_view_create_info.image = frame.depth_buffer;
-        vk::ImageSubresourceRange depth_image_range{vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1};
-        depth_view_create_info.subresourceRange = depth_image_range;
-        frame.depth_buffer_view = device_manager.device.createImageView(depth_view_create_info);
-
         /* ピック */
         vk::ImageViewCreateInfo pick_view_create_info({}, {}, vk::ImageViewType::e2D, pick_format, {}, {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
         pick_view_create_info.image = frame.pick_buffer;
@@ -141,14 +216,223 @@ namespace NEGUI2
         pick_view_create_info.subresourceRange = pick_image_range;
         frame.pick_buffer_view = device_manager.device.createImageView(pick_view_create_info);
 
-        /* フレームバッファ作成 */
-        vk::FramebufferCreateInfo info;
-        info.renderPass = *render_pass;
-        std::array<vk::ImageView, 3> target_view{*frame.color_buffer_view, *frame.depth_buffer_view, *frame.pick_buffer_view};
-        info.setAttachments(target_view);
-        info.width = extent.width;
-        info.height = extent.height;
-        info.layers = 1;
-        frame.frame_buffer = device_manager.device.createFramebuffer(info);
+        /* 表示用 */
+        vk::ImageViewCreateInfo present_view_create_info({}, present_buffer, vk::ImageViewType::e2D, color_format, {}, color_image_range);
+        present_buffer_view = device_manager.device.createImageView(present_view_create_info);
+
+        /* フレームバッファ作成 (描画先は深度ビューが決まる初回のbegin_renderingで作る) */
+        frame.frame_buffer = nullptr;
+        frame_buffer_depth_view_ = nullptr;
+        if (!dynamic_rendering)
+        {
+            vk::FramebufferCreateInfo present_info;
+            present_info.setRenderPass(*upscale_render_pass_)
+                .setAttachments(*present_buffer_view)
+                .setWidth(extent.width)
+                .setHeight(extent.height)
+                .setLayers(1);
+            upscale_frame_buffer_ = device_manager.device.createFramebuffer(present_info);
+        }
+    }
+
+    void OffScreenManager::init_upscale_()
+    {
+        auto &core = Core::get_instance();
+        auto &shader = core.shader;
+        auto &device = core.gpu.device;
+
+        std::array<vk::PipelineShaderStageCreateInfo, 2> shader_stages;
+        shader_stages[0].setStage(vk::ShaderStageFlagBits::eVertex).setPName("main").setModule(shader.get("UPSCALE.VERT"));
+        shader_stages[1].setStage(vk::ShaderStageFlagBits::eFragment).setPName("main").setModule(shader.get("UPSCALE.FRAG"));
+
+        vk::PipelineVertexInputStateCreateInfo vertex_input_state;
+        vk::PipelineInputAssemblyStateCreateInfo input_assembly;
+        input_assembly.setTopology(vk::PrimitiveTopology::eTriangleList).setPrimitiveRestartEnable(vk::False);
+
+        vk::Viewport viewport(0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f);
+        vk::Rect2D scissor({0, 0}, extent);
+        vk::PipelineViewportStateCreateInfo viewport_state;
+        viewport_state.setViewports(viewport).setScissors(scissor);
+
+        vk::PipelineRasterizationStateCreateInfo rasterizer;
+        rasterizer.setPolygonMode(vk::PolygonMode::eFill)
+            .setLineWidth(1.f)
+            .setCullMode(vk::CullModeFlagBits::eNone)
+            .setFrontFace(vk::FrontFace::eCounterClockwise);
+
+        vk::PipelineMultisampleStateCreateInfo multisampling;
+        multisampling.setRasterizationSamples(vk::SampleCountFlagBits::e1);
+
+        vk::PipelineColorBlendAttachmentState blend_attachment;
+        blend_attachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                           vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
+            .setBlendEnable(vk::False);
+        vk::PipelineColorBlendStateCreateInfo color_blending;
+        color_blending.setAttachments(blend_attachment);
+
+        std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic_state;
+        dynamic_state.setDynamicStates(dynamic_states);
+
+        upscale_set_layout_ = core.gpu.descriptors.get_layout(
+            {vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment)});
+        vk::PushConstantRange push_constant(vk::ShaderStageFlagBits::eFragment, 0, sizeof(UpscaleConstant));
+        vk::PipelineLayoutCreateInfo pipeline_layout;
+        pipeline_layout.setSetLayouts(upscale_set_layout_).setPushConstantRanges(push_constant);
+        upscale_pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
+
+        vk::GraphicsPipelineCreateInfo pipeline_info;
+        pipeline_info.setStages(shader_stages)
+            .setPVertexInputState(&vertex_input_state)
+            .setPInputAssemblyState(&input_assembly)
+            .setPViewportState(&viewport_state)
+            .setPDynamicState(&dynamic_state)
+            .setPRasterizationState(&rasterizer)
+            .setPMultisampleState(&multisampling)
+            .setPColorBlendState(&color_blending)
+            .setLayout(*upscale_pipeline_layout_)
+            .setSubpass(0);
+        if (core.gpu.dynamic_rendering_supported)
+        {
+            pipeline_info.setPNext(&upscale_rendering_info_);
+        }
+        else
+        {
+            pipeline_info.setRenderPass(*upscale_render_pass_);
+        }
+        upscale_pipeline_ = device.createGraphicsPipeline(core.gpu.pipeline_cache, pipeline_info);
+    }
+
+    void OffScreenManager::upscale(vk::raii::CommandBuffer &command_buffer, const vk::Extent2D &render_extent)
+    {
+        auto &core = Core::get_instance();
+        if (!*upscale_pipeline_)
+        {
+            init_upscale_();
+        }
+
+        /* 元画像のビューは作り直されうるのでフレーム用のセットに書く */
+        auto descriptor_set = core.gpu.descriptors.allocate_transient(upscale_set_layout_);
+        vk::DescriptorImageInfo image_info(*sampler, *frame.color_buffer_view, vk::ImageLayout::eShaderReadOnlyOptimal);
+        vk::WriteDescriptorSet write;
+        write.setDstSet(descriptor_set).setDstBinding(0u).setDescriptorCount(1)
+            .setDescriptorType(vk::DescriptorType::eCombinedImageSampler).setImageInfo(image_info);
+        core.gpu.device.updateDescriptorSets(write, nullptr);
+
+        if (core.gpu.dynamic_rendering_supported)
+        {
+            vk::RenderingAttachmentInfoKHR color_attachment;
+            color_attachment.setImageView(*present_buffer_view).setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                .setLoadOp(vk::AttachmentLoadOp::eDontCare).setStoreOp(vk::AttachmentStoreOp::eStore);
+            vk::RenderingInfoKHR rendering_info;
+            rendering_info.setRenderArea({{0, 0}, extent}).setLayerCount(1).setColorAttachments(color_attachment);
+            command_buffer.beginRenderingKHR(rendering_info);
+        }
+        else
+        {
+            vk::RenderPassBeginInfo begin_info;
+            begin_info.setRenderPass(*upscale_render_pass_)
+                .setFramebuffer(*upscale_frame_buffer_)
+                .setRenderArea({{0, 0}, extent});
+            command_buffer.beginRenderPass(begin_info, vk::SubpassContents::eInline);
+        }
+
+        vk::Viewport viewport(0.f, 0.f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.f, 1.f);
+        vk::Rect2D scissor({0, 0}, extent);
+        command_buffer.setViewport(0, viewport);
+        command_buffer.setScissor(0, scissor);
+
+        /* 等倍なら拡大のみ (実質コピー) */
+        bool scaled = render_extent != extent;
+        UpscaleConstant constant{{static_cast<float>(render_extent.width) / static_cast<float>(extent.width),
+                                  static_cast<float>(render_extent.height) / static_cast<float>(extent.height)},
+                                 {1.f / static_cast<float>(extent.width), 1.f / static_cast<float>(extent.height)},
+                                 scaled ? std::clamp(sharpness, 0.f, 1.f) : 0.f};
+        command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *upscale_pipeline_);
+        command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *upscale_pipeline_layout_, 0, {descriptor_set}, nullptr);
+        command_buffer.pushConstants<UpscaleConstant>(*upscale_pipeline_layout_, vk::ShaderStageFlagBits::eFragment, 0, constant);
+        command_buffer.draw(3, 1, 0, 0);
+
+        if (core.gpu.dynamic_rendering_supported)
+        {
+            command_buffer.endRenderingKHR();
+        }
+        else
+        {
+            command_buffer.endRenderPass();
+        }
+    }
+
+    void OffScreenManager::set_render_target(vk::GraphicsPipelineCreateInfo &pipeline_info) const
+    {
+        if (Core::get_instance().gpu.dynamic_rendering_supported)
+        {
+            pipeline_info.setRenderPass(nullptr).setPNext(&rendering_info_);
+        }
+        else
+        {
+            pipeline_info.setRenderPass(*render_pass);
+        }
+    }
+
+    void OffScreenManager::begin_rendering(vk::raii::CommandBuffer &command_buffer, const vk::Extent2D &render_extent, const vk::ImageView &depth_view)
+    {
+        if (Core::get_instance().gpu.dynamic_rendering_supported)
+        {
+            /* レイアウトはRenderGraphで遷移済み */
+            std::array<vk::RenderingAttachmentInfoKHR, 2> color_attachments;
+            color_attachments[0].setImageView(*frame.color_buffer_view).setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                .setLoadOp(vk::AttachmentLoadOp::eClear).setStoreOp(vk::AttachmentStoreOp::eStore).setClearValue(clear_value[0]);
+            color_attachments[1].setImageView(*frame.pick_buffer_view).setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                .setLoadOp(vk::AttachmentLoadOp::eClear).setStoreOp(vk::AttachmentStoreOp::eStore).setClearValue(clear_value[2]);
+            vk::RenderingAttachmentInfoKHR depth_attachment;
+            depth_attachment.setImageView(depth_view).setImageLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+                .setLoadOp(vk::AttachmentLoadOp::eClear).setStoreOp(vk::AttachmentStoreOp::eDontCare).setClearValue(clear_value[1]);
+
+            vk::RenderingInfoKHR rendering_info;
+            rendering_info.setRenderArea({{0, 0}, render_extent}).setLayerCount(1)
+                .setColorAttachments(color_attachments).setPDepthAttachment(&depth_attachment);
+            command_buffer.beginRenderingKHR(rendering_info);
+            return;
+        }
+
+        /* 一時の深度イメージが作り直されたらフレームバッファも作り直す (古いものは使用中のフレームが終わってから破棄) */
+        if (!*frame.frame_buffer || frame_buffer_depth_view_ != depth_view)
+        {
+            auto &core = Core::get_instance();
+            auto old = std::make_shared<vk::raii::Framebuffer>(std::move(frame.frame_buffer));
+            core.mm.defer_release([old]() {});
+
+            vk::FramebufferCreateInfo info;
+            info.renderPass = *render_pass;
+            std::array<vk::ImageView, 3> target_view{*frame.color_buffer_view, depth_view, *frame.pick_buffer_view};
+            info.setAttachments(target_view);
+            info.width = extent.width;
+            info.height = extent.height;
+            info.layers = 1;
+            frame.frame_buffer = core.gpu.device.createFramebuffer(info);
+            frame_buffer_depth_view_ = depth_view;
+        }
+
+        vk::RenderPassBeginInfo begin_info;
+        begin_info.setRenderPass(*render_pass)
+        .setFramebuffer(*frame.frame_buffer)
+        .setRenderArea({{0, 0}, render_extent})
+        .setClearValueCount(3).setPClearValues(clear_value.data());
+
+        command_buffer.beginRenderPass(begin_info,
+                                       vk::SubpassContents::eInline);
+    }
+
+    void OffScreenManager::end_rendering(vk::raii::CommandBuffer &command_buffer)
+    {
+        if (Core::get_instance().gpu.dynamic_rendering_supported)
+        {
+            command_buffer.endRenderingKHR();
+        }
+        else
+        {
+            command_buffer.endRenderPass();
+        }
     }
 }
\ No newline at end of file
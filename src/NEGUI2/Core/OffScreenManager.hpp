@@ -13,6 +13,26 @@ namespace NEGUI2
         void init(); // TODO すべてのモジュールにデストロイを追加
         OffScreenManager(const OffScreenManager& other) = delete;
         OffScreenManager& operator=(const OffScreenManager& other) = delete;
+
+        /* 動的レンダリング時のパイプライン生成情報 (アタッチメント形式のみで決まる) */
+        std::array<vk::Format, 2> rendering_color_formats_;
+        vk::PipelineRenderingCreateInfoKHR rendering_info_;
+        vk::ImageView frame_buffer_depth_view_; // frame.frame_buffer を作った時の深度ビュー (RenderGraphの一時イメージ)
+
+        /* 描画領域を出力解像度へ拡大し, 縮小描画時は鮮鋭化する (shader/Upscale.frag と同じ配置) */
+        struct UpscaleConstant
+        {
+            float uv_scale[2];
+            float texel[2];
+            float sharpness;
+        };
+        vk::PipelineRenderingCreateInfoKHR upscale_rendering_info_;
+        vk::raii::RenderPass upscale_render_pass_;
+        vk::raii::Framebuffer upscale_frame_buffer_;
+        vk::DescriptorSetLayout upscale_set_layout_; // DescriptorAllocatorが所有
+        vk::raii::PipelineLayout upscale_pipeline_layout_;
+        vk::raii::Pipeline upscale_pipeline_;
+        void init_upscale_(); // シェーダが揃ってから初回のupscaleで作る
     public:
         vk::Extent2D extent;
         vk::raii::RenderPass render_pass;
@@ -23,7 +43,25 @@ namespace NEGUI2
         vk::Format pick_format;
         bool swap_chain_rebuild;
         FrameData frame;
+        vk::Image present_buffer; // ImGuiで表示する出力解像度の画像
+        vk::raii::ImageView present_buffer_view;
+
+        /* 動的解像度 */
+        bool dynamic_resolution;
+        double render_scale;
+        double min_render_scale;
+        double max_render_scale;
+        double target_frame_time_ms;
+        double gpu_frame_time_ms;
+        float sharpness; // 縮小描画を拡大する時の鮮鋭化 (0 - 1)
+
         void rebuild();
+        void set_render_target(vk::GraphicsPipelineCreateInfo &pipeline_info) const; // パイプラインの描画先を設定
+        void begin_rendering(vk::raii::CommandBuffer &command_buffer, const vk::Extent2D &render_extent, const vk::ImageView &depth_view);
+        void end_rendering(vk::raii::CommandBuffer &command_buffer);
+        vk::Extent2D get_render_extent() const;
+        bool update_render_scale(const double &measured_ms);
+        void upscale(vk::raii::CommandBuffer &command_buffer, const vk::Extent2D &render_extent); // color_bufferの描画領域をpresent_bufferへ
     };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,513 @@
+#include "NEGUI2/Core/RenderGraph.hpp"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "NEGUI2/Core/Core.hpp"
+
+namespace NEGUI2
+{
+    RenderGraph::PassBuilder::PassBuilder(RenderGraph &graph, const size_t &pass)
+        : graph_(graph), pass_(pass)
+    {
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::read(const Handle &handle, const ACCESS &access, const vk::PipelineStageFlags &stages)
+    {
+        graph_.passes_.at(pass_).uses.push_back(Use{handle, access, stages, false});
+        return *this;
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::write(const Handle &handle, const ACCESS &access, const vk::PipelineStageFlags &stages)
+    {
+        graph_.passes_.at(pass_).uses.push_back(Use{handle, access, stages, true});
+        return *this;
+    }
+
+    RenderGraph::PassBuilder &RenderGraph::PassBuilder::side_effect()
+    {
+        graph_.passes_.at(pass_).side_effect = true;
+        return *this;
+    }
+
+    RenderGraph::RenderGraph()
+        : resources_(), passes_(), persistent_(), transient_images_(), alias_memories_(), transient_signature_(), compiled_(false)
+    {
+    }
+
+    RenderGraph::~RenderGraph()
+    {
+        release_transients_();
+    }
+
+    void RenderGraph::reset()
+    {
+        resources_.clear();
+        passes_.clear();
+        compiled_ = false;
+    }
+
+    RenderGraph::Handle RenderGraph::import_image(const std::string &name, const vk::Image &image, const vk::ImageAspectFlags &aspect)
+    {
+        /* 前フレームの最終状態から続ける */
+        State state{vk::ImageLayout::eUndefined, {}, {}, false};
+        auto it = persistent_.find(static_cast<VkImage>(image));
+        if (it != persistent_.end())
+            state = it->second;
+
+        resources_.push_back(Resource{name, image, nullptr, aspect, true, ImageDesc{}, std::nullopt, state, 0u, 0u, 0u});
+        return static_cast<Handle>(resources_.size() - 1u);
+    }
+
+    RenderGraph::Handle RenderGraph::import_image(const std::string &name, const vk::Image &image, const vk::ImageAspectFlags &aspect,
+                                                  const vk::ImageLayout &layout, const vk::PipelineStageFlags &stages)
+    {
+        State state{layout, stages, {}, false};
+        resources_.push_back(Resource{name, image, nullptr, aspect, true, ImageDesc{}, std::nullopt, state, 0u, 0u, 0u});
+        return static_cast<Handle>(resources_.size() - 1u);
+    }
+
+    RenderGraph::Handle RenderGraph::create_image(const std::string &name, const ImageDesc &desc)
+    {
+        State state{vk::ImageLayout::eUndefined, {}, {}, false};
+        resources_.push_back(Resource{name, nullptr, nullptr, desc.aspect, false, desc, std::nullopt, state, 0u, 0u, 0u});
+        return static_cast<Handle>(resources_.size() - 1u);
+    }
+
+    void RenderGraph::set_final_layout(const Handle &handle, const vk::ImageLayout &layout)
+    {
+        resources_.at(handle).final_layout = layout;
+    }
+
+    void RenderGraph::add_pass(const std::string &name, const std::function<void(PassBuilder &)> &setup, Execute execute)
+    {
+        passes_.push_back(Pass{name, {}, std::move(execute), false, false});
+        PassBuilder builder(*this, passes_.size() - 1u);
+        setup(builder);
+    }
+
+    void RenderGraph::compile()
+    {
+        cull_();
+        allocate_transients_();
+        compiled_ = true;
+    }
+
+    void RenderGraph::cull_()
+    {
+        /* 後ろから辿り, 副作用か取り込みイメージへの書き込み, 後段で読まれる出力を持つパスだけを残す */
+        std::vector<bool> needed(resources_.size(), false);
+        for (auto pass = passes_.rbegin(); pass != passes_.rend(); ++pass)
+        {
+            bool keep = pass->side_effect;
+            for (const auto &use : pass->uses)
+            {
+                if (use.write && (resources_.at(use.handle).imported || needed.at(use.handle)))
+                    keep = true;
+            }
+
+            pass->culled = !keep;
+            if (pass->culled)
+                continue;
+
+            for (const auto &use : pass->uses)
+            {
+                if (!use.write)
+                    needed.at(use.handle) = true;
+            }
+        }
+
+        /* 一時イメージの寿命 (残ったパスの範囲) */
+        for (auto &resource : resources_)
+        {
+            resource.first_pass = passes_.size();
+            resource.last_pass = 0u;
+        }
+        for (size_t i = 0u; i < passes_.size(); ++i)
+        {
+            if (passes_.at(i).culled)
+                continue;
+            for (const auto &use : passes_.at(i).uses)
+            {
+                auto &resource = resources_.at(use.handle);
+                resource.first_pass = std::min(resource.first_pass, i);
+                resource.last_pass = std::max(resource.last_pass, i);
+            }
+        }
+    }
+
+    void RenderGraph::allocate_transients_()
+    {
+        std::vector<Handle> transients;
+        for (Handle i = 0u; i < resources_.size(); ++i)
+        {
+            const auto &resource = resources_.at(i);
+            if (!resource.imported && resource.first_pass < passes_.size())
+                transients.push_back(i);
+        }
+        std::stable_sort(transients.begin(), transients.end(), [this](const Handle &a, const Handle &b)
+                         { return resources_.at(a).first_pass < resources_.at(b).first_pass; });
+
+        /* 宣言が前フレームと同じなら実体を使い回す */
+        std::string signature;
+        for (const auto &handle : transients)
+        {
+            const auto &resource = resources_.at(handle);
+            signature += fmt::format("{}:{}:{}x{}:{}:{}-{};", resource.name, static_cast<uint32_t>(resource.desc.format),
+                                     resource.desc.extent.width, resource.desc.extent.height,
+                                     static_cast<uint32_t>(resource.desc.usage), resource.first_pass, resource.last_pass);
+        }
+
+        /* 一時イメージを宣言しないフレーム (再描画を省いた時) は前の実体を残す */
+        if (!transients.empty() && signature != transient_signature_)
+        {
+            release_transients_();
+            transient_signature_ = signature;
+
+            auto &core = Core::get_instance();
+            vk::Device device = *core.gpu.device;
+
+            std::vector<vk::MemoryRequirements> requirements;
+            std::vector<AliasRequest> requests;
+            for (const auto &handle : transients)
+            {
+                const auto &resource = resources_.at(handle);
+                vk::ImageCreateInfo create_info;
+                create_info.imageType = vk::ImageType::e2D;
+                create_info.format = resource.desc.format;
+                create_info.extent = vk::Extent3D(resource.desc.extent, 1u);
+                create_info.mipLevels = 1u;
+                create_info.arrayLayers = 1u;
+                create_info.samples = vk::SampleCountFlagBits::e1;
+                create_info.tiling = vk::ImageTiling::eOptimal;
+                create_info.usage = resource.desc.usage;
+                create_info.sharingMode = vk::SharingMode::eExclusive;
+                create_info.initialLayout = vk::ImageLayout::eUndefined;
+                auto image = device.createImage(create_info);
+                requirements.push_back(device.getImageMemoryRequirements(image));
+                requests.push_back(AliasRequest{resource.first_pass, resource.last_pass, requirements.back().memoryTypeBits});
+                transient_images_.push_back(TransientImage{image, nullptr, 0u});
+            }
+
+            /* 同じメモリを使うイメージの要求をまとめる */
+            auto aliases = plan_aliases(requests);
+            std::vector<vk::MemoryRequirements> groups;
+            for (size_t i = 0u; i < transients.size(); ++i)
+            {
+                auto alias = aliases.at(i);
+                transient_images_.at(i).alias = alias;
+                if (alias == groups.size())
+                {
+                    groups.push_back(requirements.at(i));
+                    continue;
+                }
+                auto &group = groups.at(alias);
+                group.size = std::max(group.size, requirements.at(i).size);
+                group.alignment = std::max(group.alignment, requirements.at(i).alignment);
+                group.memoryTypeBits &= requirements.at(i).memoryTypeBits;
+            }
+
+            for (const auto &group : groups)
+            {
+                auto alloc = core.mm.allocate_image_memory(group);
+                if (alloc == nullptr)
+                    throw std::runtime_error("Failed to allocate transient image memory");
+                alias_memories_.push_back(AliasMemory{alloc, State{vk::ImageLayout::eUndefined, {}, {}, false}});
+            }
+
+            for (size_t i = 0u; i < transients.size(); ++i)
+            {
+                const auto &resource = resources_.at(transients.at(i));
+                auto &transient = transient_images_.at(i);
+                if (!core.mm.bind_image_memory(alias_memories_.at(transient.alias).alloc, transient.image))
+                    throw std::runtime_error("Failed to bind transient image memory");
+
+                vk::ImageViewCreateInfo view_info;
+                view_info.image = transient.image;
+                view_info.viewType = vk::ImageViewType::e2D;
+                view_info.format = resource.desc.format;
+                view_info.subresourceRange = vk::ImageSubresourceRange(resource.aspect, 0u, 1u, 0u, 1u);
+                transient.view = device.createImageView(view_info);
+            }
+        }
+
+        for (size_t i = 0u; i < transients.size(); ++i)
+        {
+            auto &resource = resources_.at(transients.at(i));
+            const auto &transient = transient_images_.at(i);
+            resource.image = transient.image;
+            resource.view = transient.view;
+            resource.alias = transient.alias;
+        }
+    }
+
+    void RenderGraph::release_transients_()
+    {
+        if (transient_images_.empty() && alias_memories_.empty())
+            return;
+
+        auto &core = Core::get_instance();
+        vk::Device device = *core.gpu.device;
+        auto memory_manager = &core.mm;
+        std::vector<VmaAllocation> allocations;
+        for (auto &memory : alias_memories_)
+        {
+            allocations.push_back(memory.alloc);
+        }
+
+        /* 提出済みのフレームが使い終わってから破棄 */
+        core.mm.defer_release([device, memory_manager, transient_images = transient_images_, allocations]()
+                              {
+            for (auto &transient : transient_images)
+            {
+                device.destroyImageView(transient.view);
+                device.destroyImage(transient.image);
+            }
+            for (auto &alloc : allocations)
+            {
+                memory_manager->free_image_memory(alloc);
+            } });
+        transient_images_.clear();
+        alias_memories_.clear();
+        transient_signature_.clear();
+    }
+
+    RenderGraph::State RenderGraph::target_state_(const ACCESS &access, const vk::PipelineStageFlags &stages, const bool &write)
+    {
+        State state{vk::ImageLayout::eUndefined, stages, {}, write};
+        vk::PipelineStageFlags default_stages;
+        switch (access)
+        {
+        case ACCESS::COLOR_ATTACHMENT:
+            state.layout = vk::ImageLayout::eColorAttachmentOptimal;
+            state.access = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+            default_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+            break;
+        case ACCESS::DEPTH_ATTACHMENT:
+            state.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+            state.access = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+            default_stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+            break;
+        case ACCESS::DEPTH_READ:
+            state.layout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+            state.access = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eShaderRead;
+            default_stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eFragmentShader;
+            break;
+        case ACCESS::SAMPLED:
+            state.layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            state.access = vk::AccessFlagBits::eShaderRead;
+            default_stages = vk::PipelineStageFlagBits::eFragmentShader;
+            break;
+        case ACCESS::STORAGE_READ:
+            state.layout = vk::ImageLayout::eGeneral;
+            state.access = vk::AccessFlagBits::eShaderRead;
+            default_stages = vk::PipelineStageFlagBits::eComputeShader;
+            break;
+        case ACCESS::STORAGE_WRITE:
+            state.layout = vk::ImageLayout::eGeneral;
+            state.access = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+            default_stages = vk::PipelineStageFlagBits::eComputeShader;
+            break;
+        case ACCESS::TRANSFER_SRC:
+            state.layout = vk::ImageLayout::eTransferSrcOptimal;
+            state.access = vk::AccessFlagBits::eTransferRead;
+            default_stages = vk::PipelineStageFlagBits::eTransfer;
+            break;
+        case ACCESS::TRANSFER_DST:
+            state.layout = vk::ImageLayout::eTransferDstOptimal;
+            state.access = vk::AccessFlagBits::eTransferWrite;
+            default_stages = vk::PipelineStageFlagBits::eTransfer;
+            break;
+        }
+
+        if (!state.stages)
+            state.stages = default_stages;
+        return state;
+    }
+
+    void RenderGraph::transition_(Resource &resource, const State &target, std::vector<vk::ImageMemoryBarrier2KHR> &barriers)
+    {
+        auto &current = resource.state;
+        if (current.layout == target.layout && !current.written && !target.written)
+        {
+            /* 読み取りの連続はバリア不要. 後続の書き込みが全ての読み取りを待つようにステージを束ねる */
+            current.stages |= target.stages;
+            current.access |= target.access;
+            return;
+        }
+
+        /* synchronization2のビットは旧来のビットと同じ値 */
+        vk::PipelineStageFlags src_stages = current.stages ? current.stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+        vk::AccessFlags src_access = current.written ? current.access : vk::AccessFlags();
+
+        vk::ImageMemoryBarrier2KHR barrier;
+        barrier.srcStageMask = vk::PipelineStageFlags2KHR(static_cast<VkPipelineStageFlags2KHR>(static_cast<VkPipelineStageFlags>(src_stages)));
+        barrier.srcAccessMask = vk::AccessFlags2KHR(static_cast<VkAccessFlags2KHR>(static_cast<VkAccessFlags>(src_access)));
+        barrier.dstStageMask = vk::PipelineStageFlags2KHR(static_cast<VkPipelineStageFlags2KHR>(static_cast<VkPipelineStageFlags>(target.stages)));
+        barrier.dstAccessMask = vk::AccessFlags2KHR(static_cast<VkAccessFlags2KHR>(static_cast<VkAccessFlags>(target.access)));
+        barrier.oldLayout = current.layout;
+        barrier.newLayout = target.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = resource.image;
+        barrier.subresourceRange = vk::ImageSubresourceRange(resource.aspect, 0u, VK_REMAINING_MIP_LEVELS, 0u, VK_REMAINING_ARRAY_LAYERS);
+        barriers.push_back(barrier);
+
+        current = target;
+    }
+
+    void RenderGraph::emit_(vk::raii::CommandBuffer &command_buffer, const std::vector<vk::ImageMemoryBarrier2KHR> &barriers)
+    {
+        if (barriers.empty())
+            return;
+
+        if (Core::get_instance().gpu.synchronization2_supported)
+        {
+            /* バリア毎にステージを持てるので余分な待ちが生じない */
+            vk::DependencyInfoKHR dependency_info;
+            dependency_info.setImageMemoryBarriers(barriers);
+            command_buffer.pipelineBarrier2KHR(dependency_info);
+            return;
+        }
+
+        /* 旧来のバリアは全イメージでステージを共有する */
+        std::vector<vk::ImageMemoryBarrier> legacy;
+        vk::PipelineStageFlags src_stages;
+        vk::PipelineStageFlags dst_stages;
+        for (const auto &barrier : barriers)
+        {
+            src_stages |= vk::PipelineStageFlags(static_cast<VkPipelineStageFlags>(static_cast<VkPipelineStageFlags2KHR>(barrier.srcStageMask)));
+            dst_stages |= vk::PipelineStageFlags(static_cast<VkPipelineStageFlags>(static_cast<VkPipelineStageFlags2KHR>(barrier.dstStageMask)));
+
+            vk::ImageMemoryBarrier image_barrier;
+            image_barrier.srcAccessMask = vk::AccessFlags(static_cast<VkAccessFlags>(static_cast<VkAccessFlags2KHR>(barrier.srcAccessMask)));
+            image_barrier.dstAccessMask = vk::AccessFlags(static_cast<VkAccessFlags>(static_cast<VkAccessFlags2KHR>(barrier.dstAccessMask)));
+            image_barrier.oldLayout = barrier.oldLayout;
+            image_barrier.newLayout = barrier.newLayout;
+            image_barrier.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+            image_barrier.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+            image_barrier.image = barrier.image;
+            image_barrier.subresourceRange = barrier.subresourceRange;
+            legacy.push_back(image_barrier);
+        }
+        command_buffer.pipelineBarrier(src_stages, dst_stages, {}, {}, {}, legacy);
+    }
+
+    void RenderGraph::execute(vk::raii::CommandBuffer &command_buffer)
+    {
+        if (!compiled_)
+            compile();
+
+        std::vector<bool> started(resources_.size(), false);
+        for (auto &pass : passes_)
+        {
+            if (pass.culled)
+                continue;
+
+            std::vector<vk::ImageMemoryBarrier2KHR> barriers;
+            for (const auto &use : pass.uses)
+            {
+                auto &resource = resources_.at(use.handle);
+                if (!resource.imported && !started.at(use.handle))
+                {
+                    /* 一時イメージは中身を捨てて始めるが, 同じメモリの前の利用者は待つ */
+                    resource.state = alias_memories_.at(resource.alias).state;
+                    resource.state.layout = vk::ImageLayout::eUndefined;
+                    started.at(use.handle) = true;
+                }
+
+                transition_(resource, target_state_(use.access, use.stages, use.write), barriers);
+
+                if (!resource.imported)
+                    alias_memories_.at(resource.alias).state = resource.state;
+            }
+            emit_(command_buffer, barriers);
+
+            pass.execute(command_buffer);
+        }
+
+        /* 取り出すイメージの最終レイアウト (スワップチェーンの提示など) */
+        std::vector<vk::ImageMemoryBarrier2KHR> barriers;
+        for (auto &resource : resources_)
+        {
+            if (!resource.final_layout || resource.state.layout == resource.final_layout.value())
+                continue;
+            State target{resource.final_layout.value(), vk::PipelineStageFlagBits::eBottomOfPipe, {}, false};
+            transition_(resource, target, barriers);
+        }
+        emit_(command_buffer, barriers);
+
+        for (const auto &resource : resources_)
+        {
+            if (resource.imported)
+                persistent_[static_cast<VkImage>(resource.image)] = resource.state;
+        }
+    }
+
+    vk::Image RenderGraph::get_image(const Handle &handle) const
+    {
+        return resources_.at(handle).image;
+    }
+
+    vk::ImageView RenderGraph::get_view(const Handle &handle) const
+    {
+        return resources_.at(handle).view;
+    }
+
+    bool RenderGraph::is_culled(const std::string &name) const
+    {
+        for (const auto &pass : passes_)
+        {
+            if (pass.name == name)
+                return pass.culled;
+        }
+        return true;
+    }
+
+    size_t RenderGraph::get_alias_memory_count() const
+    {
+        return alias_memories_.size();
+    }
+
+    std::vector<size_t> RenderGraph::plan_aliases(const std::vector<AliasRequest> &requests)
+    {
+        struct Group
+        {
+            size_t last_pass;
+            uint32_t memory_type_bits;
+        };
+        std::vector<Group> groups;
+        std::vector<size_t> aliases;
+        aliases.reserve(requests.size());
+        for (const auto &request : requests)
+        {
+            size_t alias = groups.size();
+            for (size_t i = 0u; i < groups.size(); ++i)
+            {
+                if (groups.at(i).last_pass < request.first_pass && (groups.at(i).memory_type_bits & request.memory_type_bits) != 0u)
+                {
+                    alias = i;
+                    break;
+                }
+            }
+
+            if (alias == groups.size())
+            {
+                groups.push_back(Group{request.last_pass, request.memory_type_bits});
+            }
+            else
+            {
+                groups.at(alias).last_pass = request.last_pass;
+                groups.at(alias).memory_type_bits &= request.memory_type_bits;
+            }
+            aliases.push_back(alias);
+        }
+        return aliases;
+    }
+
+    void RenderGraph::forget(const vk::Image &image)
+    {
+        persistent_.erase(static_cast<VkImage>(image));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#ifndef _RENDER_GRAPH_HPP
+#define _RENDER_GRAPH_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <vk_mem_alloc.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace NEGUI2
+{
+    /* フレーム毎にパスとリソースを宣言し, バリアとレイアウト遷移を自動で挿入する */
+    class RenderGraph
+    {
+        friend class Core;
+
+    public:
+        using Handle = uint32_t;
+        using Execute = std::function<void(vk::raii::CommandBuffer &command_buffer)>;
+
+        /* パスからのアクセス (レイアウト, ステージ, アクセスマスクが決まる) */
+        enum class ACCESS : uint32_t
+        {
+            COLOR_ATTACHMENT = 0,
+            DEPTH_ATTACHMENT = 1,
+            DEPTH_READ = 2,
+            SAMPLED = 3,
+            STORAGE_READ = 4,
+            STORAGE_WRITE = 5,
+            TRANSFER_SRC = 6,
+            TRANSFER_DST = 7,
+        };
+
+        /* 一時イメージ (フレーム内でのみ有効, 寿命が重ならなければメモリを共有) */
+        struct ImageDesc
+        {
+            vk::Format format;
+            vk::Extent2D extent;
+            vk::ImageUsageFlags usage;
+            vk::ImageAspectFlags aspect;
+        };
+
+        /* 一時イメージのメモリ共有の計画. 寿命 [first_pass, last_pass] */
+        struct AliasRequest
+        {
+            size_t first_pass;
+            size_t last_pass;
+            uint32_t memory_type_bits;
+        };
+
+        class PassBuilder
+        {
+            friend class RenderGraph;
+            RenderGraph &graph_;
+            size_t pass_;
+            PassBuilder(RenderGraph &graph, const size_t &pass);
+
+        public:
+            /* stagesを省略するとアクセスの既定ステージ */
+            PassBuilder &read(const Handle &handle, const ACCESS &access, const vk::PipelineStageFlags &stages = {});
+            PassBuilder &write(const Handle &handle, const ACCESS &access, const vk::PipelineStageFlags &stages = {});
+            PassBuilder &side_effect(); // 出力が読まれなくても実行する (読み出し等)
+        };
+
+    private:
+        struct State
+        {
+            vk::ImageLayout layout;
+            vk::PipelineStageFlags stages;
+            vk::AccessFlags access;
+            bool written;
+        };
+
+        struct Resource
+        {
+            std::string name;
+            vk::Image image;
+            vk::ImageView view;
+            vk::ImageAspectFlags aspect;
+            bool imported;
+            ImageDesc desc;
+            std::optional<vk::ImageLayout> final_layout;
+            State state;
+            size_t first_pass;
+            size_t last_pass;
+            size_t alias; // 一時イメージのメモリ番号
+        };
+
+        struct Use
+        {
+            Handle handle;
+            ACCESS access;
+            vk::PipelineStageFlags stages;
+            bool write;
+        };
+
+        struct Pass
+        {
+            std::string name;
+            std::vector<Use> uses;
+            Execute execute;
+            bool side_effect;
+            bool culled;
+        };
+
+        /* 一時イメージの実体. 同じ宣言が続く限りフレームを跨いで使い回す */
+        struct TransientImage
+        {
+            vk::Image image;
+            vk::ImageView view;
+            size_t alias;
+        };
+        struct AliasMemory
+        {
+            VmaAllocation alloc;
+            State state; // 最後にこのメモリを使ったイメージの状態
+        };
+
+        std::vector<Resource> resources_;
+        std::vector<Pass> passes_;
+        std::unordered_map<VkImage, State> persistent_; // 取り込みイメージのフレームを跨いだ状態
+        std::vector<TransientImage> transient_images_;
+        std::vector<AliasMemory> alias_memories_;
+        std::string transient_signature_;
+        bool compiled_;
+
+        RenderGraph();
+        RenderGraph(const RenderGraph &other) = delete;
+        RenderGraph &operator=(const RenderGraph &other) = delete;
+
+        static State target_state_(const ACCESS &access, const vk::PipelineStageFlags &stages, const bool &write);
+        void cull_();
+        void allocate_transients_();
+        void release_transients_();
+        void transition_(Resource &resource, const State &target, std::vector<vk::ImageMemoryBarrier2KHR> &barriers);
+        static void emit_(vk::raii::CommandBuffer &command_buffer, const std::vector<vk::ImageMemoryBarrier2KHR> &barriers);
+
+    public:
+        ~RenderGraph();
+
+        void reset(); // フレーム開始時に呼ぶ
+        Handle import_image(const std::string &name, const vk::Image &image, const vk::ImageAspectFlags &aspect);
+        Handle import_image(const std::string &name, const vk::Image &image, const vk::ImageAspectFlags &aspect,
+                            const vk::ImageLayout &layout, const vk::PipelineStageFlags &stages);
+        Handle create_image(const std::string &name, const ImageDesc &desc);
+        void set_final_layout(const Handle &handle, const vk::ImageLayout &layout);
+        void add_pass(const std::string &name, const std::function<void(PassBuilder &)> &setup, Execute execute);
+
+        void compile();
+        void execute(vk::raii::CommandBuffer &command_buffer);
+
+        vk::Image get_image(const Handle &handle) const;
+        vk::ImageView get_view(const Handle &handle) const;
+        bool is_culled(const std::string &name) const;
+        size_t get_alias_memory_count() const; // 一時イメージに割り当てたメモリの数
+        /* first_passの昇順に並んだ要求へメモリ番号を振る. 寿命が重ならず型が合えば先に空いたものを使う */
+        static std::vector<size_t> plan_aliases(const std::vector<AliasRequest> &requests);
+        void forget(const vk::Image &image); // 破棄したイメージの状態を忘れる
+    };
+}
+
+#endif
\ No newline at end of file
@@ -6,7 +6,7 @@ namespace NEGUI2
 {
     struct FrameData
     {
-        vk::raii::Fence fence = nullptr;
+        uint64_t submit_value = 0u; // 最後に提出したタイムライン値
         vk::Image color_buffer = nullptr;
         vk::Image depth_buffer = nullptr;
         vk::Image pick_buffer = nullptr;
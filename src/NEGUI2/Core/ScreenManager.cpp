@@ -112,13 +112,6 @@ namespace NEGUI2
             clear_value = {{166.0f / 256.0f, 205.0f / 256.0f, 182.0f / 256.0f, 0.0f}};
         }
 
-        /* 各フレームにコマンドバッファ割当 */
-        {
-            vk::CommandBufferAllocateInfo info;
-            info.setCommandBufferCount(4).setCommandPool(*device_manager.command_pool).setLevel(vk::CommandBufferLevel::ePrimary);
-            command_buffers = device_manager.device.allocateCommandBuffers(info);
-        }
-
         rebuild();
 #if 0
         vk::raii::SwapchainKHR swap_chain;
@@ -191,7 +184,8 @@ namespace NEGUI2
             }
         }
 
-        /* Create RenderPass */
+        /* Create RenderPass (動的レンダリングでは不要) */
+        if (!device_manager.dynamic_rendering_supported)
         {
             vk::Format colorFormat = surface_format.format;
             vk::Format depthFormat = vk::Format::eD16Unorm;
@@ -204,8 +198,8 @@ namespace NEGUI2
                                                                   vk::AttachmentStoreOp::eStore,
                                                                   vk::AttachmentLoadOp::eDontCare,
                                                                   vk::AttachmentStoreOp::eDontCare,
-                                                                  vk::ImageLayout::eUndefined,
-                                                                  vk::ImageLayout::ePresentSrcKHR);
+                                                                  vk::ImageLayout::eColorAttachmentOptimal,
+                                                                  vk::ImageLayout::eColorAttachmentOptimal); // 提示用の遷移はRenderGraph
 #if 0
             attachmentDescriptions[1] = vk::AttachmentDescription({},
                                                                   depthFormat,
@@ -228,12 +222,14 @@ namespace NEGUI2
         frames.resize(image_count);
         for (int i = 0; i < image_count; i++)
         {
-            frames[i].fence = device_manager.device.createFence({vk::FenceCreateFlagBits::eSignaled});
             vk::ImageViewCreateInfo imageViewCreateInfo({}, {}, vk::ImageViewType::e2D, surface_format.format, {}, {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1});
             imageViewCreateInfo.image = frames[i].color_buffer;
             vk::ImageSubresourceRange image_range{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
             imageViewCreateInfo.subresourceRange = image_range;
             frames[i].color_buffer_view = device_manager.device.createImageView(imageViewCreateInfo);
+            if (device_manager.dynamic_rendering_supported)
+                continue;
+
             // TODO ルールを知る
             vk::FramebufferCreateInfo info;
             info.renderPass = *render_pass;
@@ -252,4 +248,41 @@ namespace NEGUI2
             sync_objects[i].image_rendered_semaphore = device_manager.device.createSemaphore({});
         }
     }
+
+    void ScreenManager::begin_rendering(vk::raii::CommandBuffer &command_buffer, const uint32_t &index)
+    {
+        if (Core::get_instance().gpu.dynamic_rendering_supported)
+        {
+            /* レイアウトはRenderGraphで遷移済み */
+            vk::RenderingAttachmentInfoKHR color_attachment;
+            color_attachment.setImageView(*frames[index].color_buffer_view).setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+                .setLoadOp(vk::AttachmentLoadOp::eClear).setStoreOp(vk::AttachmentStoreOp::eStore).setClearValue(clear_value);
+
+            vk::RenderingInfoKHR rendering_info;
+            rendering_info.setRenderArea({{0, 0}, extent}).setLayerCount(1).setColorAttachments(color_attachment);
+            command_buffer.beginRenderingKHR(rendering_info);
+            return;
+        }
+
+        vk::RenderPassBeginInfo begin_info;
+        begin_info.setRenderPass(*render_pass)
+        .setFramebuffer(*frames[index].frame_buffer)
+        .setRenderArea({{0, 0}, {extent}})
+        .setClearValueCount(1).setPClearValues(&clear_value);
+
+        command_buffer.beginRenderPass(begin_info,
+                                       vk::SubpassContents::eInline);
+    }
+
+    void ScreenManager::end_rendering(vk::raii::CommandBuffer &command_buffer)
+    {
+        if (Core::get_instance().gpu.dynamic_rendering_supported)
+        {
+            command_buffer.endRenderingKHR();
+        }
+        else
+        {
+            command_buffer.endRenderPass();
+        }
+    }
 }
\ No newline at end of file
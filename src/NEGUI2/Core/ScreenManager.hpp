@@ -26,9 +26,10 @@ namespace NEGUI2
         uint32_t semaphore_index; // Current set of swapchain wait semaphores we're using (needs to be distinct from per frame data)
         std::vector<FrameData> frames;
         std::vector<SyncObject> sync_objects;
-        std::vector<vk::raii::CommandBuffer> command_buffers;
 
         void rebuild();
+        void begin_rendering(vk::raii::CommandBuffer &command_buffer, const uint32_t &index);
+        void end_rendering(vk::raii::CommandBuffer &command_buffer);
     };
 }
 
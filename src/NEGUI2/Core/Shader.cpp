@@ -141,6 +141,13 @@ namespace NEGUI2
     add_spv_from_file("POINT.FRAG", "./shader/Point.frag.spv");
     add_spv_from_file("MESH.VERT", "./shader/Mesh.vert.spv");
     add_spv_from_file("MESH.FRAG", "./shader/Mesh.frag.spv");
+    add_spv_from_file("MESH_NO_PRIMITIVE.FRAG", "./shader/MeshNoPrimitive.frag.spv");
+    add_spv_from_file("MESH_MATCAP.FRAG", "./shader/MeshMatcap.frag.spv");
+    add_spv_from_file("MESH_MATCAP_NO_PRIMITIVE.FRAG", "./shader/MeshMatcapNoPrimitive.frag.spv");
+    add_spv_from_file("UPSCALE.VERT", "./shader/Upscale.vert.spv");
+    add_spv_from_file("UPSCALE.FRAG", "./shader/Upscale.frag.spv");
+    add_spv_from_file("SELECTION.COMP", "./shader/Selection.comp.spv");
+    add_spv_from_file("NEAREST.COMP", "./shader/Nearest.comp.spv");
   }
 
   void Shader::add_glsl(const std::string &key, const VkShaderStageFlagBits &shader_stage, const std::string &shader_text)
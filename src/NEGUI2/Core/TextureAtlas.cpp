@@ -0,0 +1,181 @@
+#include "NEGUI2/Core/TextureAtlas.hpp"
+
+#include <stb/stb_image.h>
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+
+#include "NEGUI2/Core/Core.hpp"
+
+namespace
+{
+    constexpr uint32_t CHANNELS = 4u;
+}
+
+namespace NEGUI2
+{
+    TextureAtlas::TextureAtlas()
+        : pages_(), regions_(), max_entry_size(256u)
+    {
+    }
+
+    TextureAtlas::~TextureAtlas()
+    {
+    }
+
+    std::optional<AtlasRegion> TextureAtlas::add(const std::string &key, const void *pixels, const uint32_t &width, const uint32_t &height)
+    {
+        auto it = regions_.find(key);
+        if (it != regions_.end())
+            return it->second;
+
+        if (width == 0u || height == 0u || width > max_entry_size || height > max_entry_size)
+            return std::nullopt;
+
+        uint32_t page, x, y;
+        if (!allocate_(width + PADDING * 2u, height + PADDING * 2u, page, x, y))
+            return std::nullopt;
+
+        /* 縁を1画素複製して書き込み */
+        auto &target = pages_[page];
+        auto source = static_cast<const uint8_t *>(pixels);
+        uint32_t padded_width = width + PADDING * 2u;
+        uint32_t padded_height = height + PADDING * 2u;
+        for (uint32_t row = 0u; row < padded_height; row++)
+        {
+            uint32_t source_row = std::min(row - std::min(row, PADDING), height - 1u);
+            for (uint32_t column = 0u; column < padded_width; column++)
+            {
+                uint32_t source_column = std::min(column - std::min(column, PADDING), width - 1u);
+                std::memcpy(&target.pixels[((static_cast<size_t>(y) + row) * PAGE_SIZE + x + column) * CHANNELS],
+                            &source[(static_cast<size_t>(source_row) * width + source_column) * CHANNELS], CHANNELS);
+            }
+        }
+        if (target.dirty_right <= target.dirty_left)
+        {
+            target.dirty_left = x;
+            target.dirty_top = y;
+            target.dirty_right = x + padded_width;
+            target.dirty_bottom = y + padded_height;
+        }
+        else
+        {
+            target.dirty_left = std::min(target.dirty_left, x);
+            target.dirty_top = std::min(target.dirty_top, y);
+            target.dirty_right = std::max(target.dirty_right, x + padded_width);
+            target.dirty_bottom = std::max(target.dirty_bottom, y + padded_height);
+        }
+
+        constexpr float SCALE = 1.f / static_cast<float>(PAGE_SIZE);
+        AtlasRegion region{page,
+                           static_cast<float>(x + PADDING) * SCALE, static_cast<float>(y + PADDING) * SCALE,
+                           static_cast<float>(x + PADDING + width) * SCALE, static_cast<float>(y + PADDING + height) * SCALE,
+                           width, height};
+        regions_.insert({key, region});
+        return region;
+    }
+
+    std::optional<AtlasRegion> TextureAtlas::add_from_file(const std::filesystem::path &path)
+    {
+        auto key = path.string();
+        auto it = regions_.find(key);
+        if (it != regions_.end())
+            return it->second;
+
+        auto abs_path = std::filesystem::absolute(path);
+        int width, height, channels;
+        stbi_uc *img = stbi_load(abs_path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (img == nullptr)
+        {
+            spdlog::error("Failed to load {}", abs_path.string());
+            return std::nullopt;
+        }
+
+        auto region = add(key, img, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+        stbi_image_free(img);
+        return region;
+    }
+
+    std::optional<AtlasRegion> TextureAtlas::get(const std::string &key) const
+    {
+        auto it = regions_.find(key);
+        if (it == regions_.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    std::string TextureAtlas::get_page_key(const uint32_t &page) const
+    {
+        return pages_.at(page).key;
+    }
+
+    size_t TextureAtlas::get_page_count() const
+    {
+        return pages_.size();
+    }
+
+    bool TextureAtlas::allocate_(const uint32_t &width, const uint32_t &height, uint32_t &page, uint32_t &x, uint32_t &y)
+    {
+        if (width > PAGE_SIZE || height > PAGE_SIZE)
+            return false;
+
+        /* 高さの無駄が最も少ない棚を探す */
+        for (uint32_t i = 0u; i < pages_.size(); i++)
+        {
+            Shelf *best = nullptr;
+            for (auto &shelf : pages_[i].shelves)
+            {
+                if (shelf.height < height || shelf.x + width > PAGE_SIZE)
+                    continue;
+                if (best == nullptr || shelf.height < best->height)
+                {
+                    best = &shelf;
+                }
+            }
+
+            /* 新しい棚を追加 */
+            if (best == nullptr && pages_[i].next_y + height <= PAGE_SIZE)
+            {
+                pages_[i].shelves.push_back({pages_[i].next_y, height, 0u});
+                pages_[i].next_y += height;
+                best = &pages_[i].shelves.back();
+            }
+
+            if (best != nullptr)
+            {
+                page = i;
+                x = best->x;
+                y = best->y;
+                best->x += width;
+                return true;
+            }
+        }
+
+        /* 新しいページ */
+        Page new_page{fmt::format("TextureAtlas{}", pages_.size()),
+                      std::vector<uint8_t>(static_cast<size_t>(PAGE_SIZE) * PAGE_SIZE * CHANNELS, 0u), {}, 0u,
+                      0u, 0u, PAGE_SIZE, PAGE_SIZE};
+        pages_.push_back(std::move(new_page));
+        return allocate_(width, height, page, x, y);
+    }
+
+    void TextureAtlas::update()
+    {
+        auto &texture_manager = Core::get_instance().tm;
+        for (auto &page : pages_)
+        {
+            if (page.dirty_right <= page.dirty_left)
+                continue;
+
+            /* 初回や縮小後はページ全体を作り直し, それ以外は矩形のみ転送 */
+            vk::Offset2D offset{static_cast<int32_t>(page.dirty_left), static_cast<int32_t>(page.dirty_top)};
+            vk::Extent2D extent{page.dirty_right - page.dirty_left, page.dirty_bottom - page.dirty_top};
+            if (!texture_manager.load_region(page.key, page.pixels.data(), PAGE_SIZE, offset, extent))
+            {
+                texture_manager.load_from_memory(page.key, page.pixels.data(), PAGE_SIZE, PAGE_SIZE);
+            }
+            page.dirty_left = page.dirty_top = page.dirty_right = page.dirty_bottom = 0u;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef _TEXTURE_ATLAS_HPP
+#define _TEXTURE_ATLAS_HPP
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace NEGUI2
+{
+    /* アトラス内の1画像 */
+    struct AtlasRegion
+    {
+        uint32_t page; // ページ番号
+        float u0;
+        float v0;
+        float u1;
+        float v1;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    /* 小さな画像 (アイコン, サムネイル) をまとめるシェルフ方式のアトラス */
+    class TextureAtlas
+    {
+        friend class TextureManager;
+
+        struct Shelf
+        {
+            uint32_t y;
+            uint32_t height;
+            uint32_t x;
+        };
+
+        struct Page
+        {
+            std::string key;
+            std::vector<uint8_t> pixels; // RGBA8
+            std::vector<Shelf> shelves;
+            uint32_t next_y;
+            uint32_t dirty_left; // 未転送の矩形. right <= left なら転送不要
+            uint32_t dirty_top;
+            uint32_t dirty_right;
+            uint32_t dirty_bottom;
+        };
+
+        std::vector<Page> pages_;
+        std::unordered_map<std::string, AtlasRegion> regions_;
+
+        TextureAtlas(const TextureAtlas &other) = delete;
+        TextureAtlas &operator=(const TextureAtlas &other) = delete;
+        void update(); // 変更のあった矩形だけ転送
+        bool allocate_(const uint32_t &width, const uint32_t &height, uint32_t &page, uint32_t &x, uint32_t &y);
+
+    public:
+        static constexpr uint32_t PAGE_SIZE = 2048u;
+        static constexpr uint32_t PADDING = 1u; // 縁のにじみ防止
+
+        TextureAtlas(); // 転送はTextureManagerが持つものだけが行う
+        ~TextureAtlas();
+        uint32_t max_entry_size; // これより大きい画像は個別テクスチャにする [pixel]
+
+        std::optional<AtlasRegion> add(const std::string &key, const void *pixels, const uint32_t &width, const uint32_t &height);
+        std::optional<AtlasRegion> add_from_file(const std::filesystem::path &path);
+        std::optional<AtlasRegion> get(const std::string &key) const;
+        std::string get_page_key(const uint32_t &page) const;
+        size_t get_page_count() const;
+    };
+}
+
+#endif
\ No newline at end of file
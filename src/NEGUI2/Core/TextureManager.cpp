@@ -3,30 +3,241 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include <imgui_impl_vulkan.h>
+#include <ktx.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
 
 #include "NEGUI2/Core/Core.hpp"
 
+namespace
+{
+    constexpr uint32_t CHANNELS = 4u;
+    constexpr uint32_t BINDLESS_MAX = 4096u;
+
+    /* 全テクスチャ共通のサンプラ設定 */
+    vk::SamplerCreateInfo texture_sampler_info()
+    {
+        vk::SamplerCreateInfo create_info;
+        create_info.setMagFilter(vk::Filter::eLinear)
+            .setMinFilter(vk::Filter::eLinear)
+            .setAddressModeU(vk::SamplerAddressMode::eRepeat)
+            .setAddressModeV(vk::SamplerAddressMode::eRepeat)
+            .setAddressModeW(vk::SamplerAddressMode::eRepeat)
+            .setAnisotropyEnable(vk::False) // TODO 有効化
+            .setBorderColor(vk::BorderColor::eIntOpaqueBlack)
+            .setUnnormalizedCoordinates(vk::False)
+            .setCompareEnable(vk::False)
+            .setCompareOp(vk::CompareOp::eAlways)
+            .setMipmapMode(vk::SamplerMipmapMode::eLinear)
+            .setMipLodBias(0.f)
+            .setMinLod(0.f)
+            .setMaxLod(vk::LodClampNone);
+        return create_info;
+    }
+
+    /* 2x2の平均で1段縮小 */
+    void downsample(std::vector<uint8_t> &pixels, uint32_t &width, uint32_t &height)
+    {
+        uint32_t next_width = std::max(width / 2u, 1u);
+        uint32_t next_height = std::max(height / 2u, 1u);
+        std::vector<uint8_t> next(static_cast<size_t>(next_width) * next_height * CHANNELS);
+        for (uint32_t y = 0u; y < next_height; y++)
+        {
+            for (uint32_t x = 0u; x < next_width; x++)
+            {
+                uint32_t x0 = std::min(x * 2u, width - 1u);
+                uint32_t x1 = std::min(x * 2u + 1u, width - 1u);
+                uint32_t y0 = std::min(y * 2u, height - 1u);
+                uint32_t y1 = std::min(y * 2u + 1u, height - 1u);
+                for (uint32_t c = 0u; c < CHANNELS; c++)
+                {
+                    uint32_t sum = pixels[(static_cast<size_t>(y0) * width + x0) * CHANNELS + c] +
+                                   pixels[(static_cast<size_t>(y0) * width + x1) * CHANNELS + c] +
+                                   pixels[(static_cast<size_t>(y1) * width + x0) * CHANNELS + c] +
+                                   pixels[(static_cast<size_t>(y1) * width + x1) * CHANNELS + c];
+                    next[(static_cast<size_t>(y) * next_width + x) * CHANNELS + c] = static_cast<uint8_t>((sum + 2u) / 4u);
+                }
+            }
+        }
+        pixels.swap(next);
+        width = next_width;
+        height = next_height;
+    }
+}
+
 namespace NEGUI2
 {
     TextureManager::TextureManager()
+        : textures_(), residency_(), workers_(), jobs_(), decoded_(), mutex_(), condition_(), stop_(false), frame_(0u),
+          transcode_format_(KTX_TTF_RGBA32),
+          samplers_(), bindless_pool_(nullptr), free_indices_(), bindless_count_(0u), bindless_capacity_(0u), imgui_textures_(),
+          texture_budget(512u * 1024u * 1024u), min_resident_size(64u), atlas(), bindless_layout(nullptr), bindless_set(nullptr)
     {
     }
 
     TextureManager::~TextureManager()
     {
-        auto &core = Core::get_instance();
-        vk::Device device = *core.gpu.device;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        condition_.notify_all();
+        for (auto &worker : workers_)
+        {
+            worker.join();
+        }
 
-        for(auto& texture : textures_)
+        /* ImGuiは先に終了しているのでディスクリプタはプールごと破棄される */
+        imgui_textures_.clear();
+        for (auto &texture : textures_)
         {
-            remove(texture.first);
+            destroy_(texture.first);
         }
+        textures_.clear();
     }
 
     void TextureManager::init()
     {
         textures_.clear();
+        init_bindless_();
+        select_transcode_format_();
+
+        uint32_t worker_count = std::clamp(std::thread::hardware_concurrency() / 2u, 1u, 4u);
+        for (uint32_t i = 0u; i < worker_count; i++)
+        {
+            workers_.emplace_back([this]()
+                                  { worker_(); });
+        }
+
+        /* 予算逼迫時は使われていないテクスチャから縮小 */
+        Core::get_instance().mm.add_pressure_handler([this](const size_t &requested)
+                                                     { return evict_(requested); });
+    }
+
+    void TextureManager::init_bindless_()
+    {
+        auto &gpu = Core::get_instance().gpu;
+        if (!gpu.descriptor_indexing_supported)
+            return;
+
+        auto properties = gpu.physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>()
+                              .get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+        bindless_capacity_ = std::min({BINDLESS_MAX,
+                                       properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                       properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                       properties.maxDescriptorSetUpdateAfterBindSampledImages});
+
+        /* 使われていない要素は未設定のままでよく, 描画中でも更新できる */
+        vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eCombinedImageSampler, bindless_capacity_,
+                                               vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute);
+        vk::DescriptorBindingFlags binding_flags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                                   vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                                   vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flags_info;
+        flags_info.setBindingFlags(binding_flags);
+
+        vk::DescriptorSetLayoutCreateInfo layout_info;
+        layout_info.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+            .setBindings(binding)
+            .setPNext(&flags_info);
+        bindless_layout = gpu.device.createDescriptorSetLayout(layout_info);
+
+        vk::DescriptorPoolSize pool_size(vk::DescriptorType::eCombinedImageSampler, bindless_capacity_);
+        vk::DescriptorPoolCreateInfo pool_info;
+        pool_info.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+            .setMaxSets(1)
+            .setPoolSizes(pool_size);
+        bindless_pool_ = gpu.device.createDescriptorPool(pool_info);
+
+        vk::DescriptorSetAllocateInfo alloc_info;
+        alloc_info.setDescriptorPool(*bindless_pool_)
+            .setSetLayouts(*bindless_layout);
+        bindless_set = std::move(gpu.device.allocateDescriptorSets(alloc_info).front());
+        spdlog::info("Bindless textures: {} slots", bindless_capacity_);
+    }
+
+    void TextureManager::select_transcode_format_()
+    {
+        auto &physical_device = Core::get_instance().gpu.physical_device;
+        auto features = physical_device.getFeatures();
+        auto sampled = [&](const vk::Format &format)
+        {
+            return static_cast<bool>(physical_device.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+        };
+
+        /* デバイスが扱えるブロック圧縮形式. 無ければRGBA8 */
+        if (features.textureCompressionBC && sampled(vk::Format::eBc7SrgbBlock))
+        {
+            transcode_format_ = KTX_TTF_BC7_RGBA;
+        }
+        else if (features.textureCompressionASTC_LDR && sampled(vk::Format::eAstc4x4SrgbBlock))
+        {
+            transcode_format_ = KTX_TTF_ASTC_4x4_RGBA;
+        }
+        else if (features.textureCompressionETC2 && sampled(vk::Format::eEtc2R8G8B8A8SrgbBlock))
+        {
+            transcode_format_ = KTX_TTF_ETC2_RGBA;
+        }
+        else
+        {
+            transcode_format_ = KTX_TTF_RGBA32;
+        }
+        spdlog::info("KTX2 transcode target: {}", ktxTranscodeFormatString(static_cast<ktx_transcode_fmt_e>(transcode_format_)));
+    }
+
+    vk::Sampler TextureManager::get_sampler(const vk::SamplerCreateInfo &create_info)
+    {
+        /* 同じ設定なら同じサンプラを返す (pNextは比較されるのでnullptrで使う) */
+        for (const auto &sampler : samplers_)
+        {
+            if (sampler.first == create_info)
+                return *sampler.second;
+        }
+
+        auto &gpu = Core::get_instance().gpu;
+        samplers_.emplace_back(create_info, gpu.device.createSampler(create_info));
+        return *samplers_.back().second;
+    }
+
+    VkDescriptorSet TextureManager::get_imgui_texture(const std::string &key)
+    {
+        auto it = imgui_textures_.find(key);
+        if (it != imgui_textures_.end())
+        {
+            touch(key);
+            return it->second;
+        }
+
+        auto texture = textures_.find(key);
+        if (texture == textures_.end())
+            return VK_NULL_HANDLE;
+
+        touch(key);
+        auto set = ImGui_ImplVulkan_AddTexture(texture->second.sampler, texture->second.image_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        imgui_textures_.insert({key, set});
+        return set;
+    }
+
+    uint32_t TextureManager::acquire_index_()
+    {
+        if (bindless_capacity_ == 0u)
+            return INVALID_INDEX;
+
+        if (!free_indices_.empty())
+        {
+            uint32_t index = free_indices_.back();
+            free_indices_.pop_back();
+            return index;
+        }
+
+        if (bindless_count_ >= bindless_capacity_)
+        {
+            spdlog::warn("Bindless texture slots exhausted ({})", bindless_capacity_);
+            return INVALID_INDEX;
+        }
+        return bindless_count_++;
     }
 
     Texture TextureManager::get(const std::string &key)
@@ -36,93 +247,532 @@ namespace NEGUI2
 
     Texture TextureManager::load_from_file(const std::filesystem::path &path)
     {
-        auto abs_path = std::filesystem::absolute(path);
+        Texture texture{};
+        Job job{path.string(), path, 0u};
+        Decoded decoded;
+        if (!decode_(job, decoded))
+        {
+            spdlog::error("Failed to load {}", std::filesystem::absolute(path).string());
+            return texture;
+        }
+
+        residency_[job.key] = Residency{path, frame_, false};
+        if (create_(decoded))
+        {
+            texture = textures_.at(job.key);
+        }
+        return texture;
+    }
+
+    Texture TextureManager::load_from_memory(const std::string &key, const void *pixels, const uint32_t &width, const uint32_t &height)
+    {
+        auto &core = Core::get_instance();
+
+        /* 同じ大きさなら既存のイメージへ上書きし, ビューとインデックスを維持 */
+        auto it = textures_.find(key);
+        if (it != textures_.end() && it->second.resident_mip == 0u &&
+            it->second.width == width && it->second.height == height)
+        {
+            /* キュー順で同期するので待たずに上書き */
+            core.mm.upload_image_region(key, pixels, width, {0, 0}, {width, height});
+            return it->second;
+        }
+
+        auto bytes = static_cast<const uint8_t *>(pixels);
+        Decoded decoded{key, 0u, width, height, width, height,
+                        std::vector<uint8_t>(bytes, bytes + static_cast<size_t>(width) * height * CHANNELS)};
+        if (!create_(decoded))
+            return Texture{};
+        return textures_.at(key);
+    }
+
+    bool TextureManager::load_region(const std::string &key, const void *pixels, const uint32_t &row_length, const vk::Offset2D &offset, const vk::Extent2D &extent)
+    {
+        /* 縮小中のテクスチャは座標が合わないので呼び出し側で作り直す */
+        auto it = textures_.find(key);
+        if (it == textures_.end() || it->second.resident_mip != 0u)
+            return false;
+        return Core::get_instance().mm.upload_image_region(key, pixels, row_length, offset, extent);
+    }
+
+    void TextureManager::load_async(const std::filesystem::path &path)
+    {
+        auto key = path.string();
+        auto it = residency_.find(key);
+        if (it != residency_.end() && (it->second.loading || textures_.count(key) != 0))
+            return;
+
+        residency_[key] = Residency{path, frame_, true};
+        enqueue_(key, 0u);
+    }
+
+    bool TextureManager::is_ready(const std::string &key) const
+    {
+        return textures_.count(key) != 0;
+    }
+
+    void TextureManager::touch(const std::string &key)
+    {
+        auto it = residency_.find(key);
+        if (it != residency_.end())
+        {
+            it->second.last_used_frame = frame_;
+        }
+    }
+
+    size_t TextureManager::get_resident_bytes() const
+    {
+        size_t bytes = 0u;
+        for (const auto &texture : textures_)
+        {
+            bytes += texture.second.alloc_info.size;
+        }
+        return bytes;
+    }
+
+    void TextureManager::enqueue_(const std::string &key, const uint32_t &base_mip)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back({key, residency_.at(key).path, base_mip});
+        }
+        condition_.notify_one();
+    }
+
+    void TextureManager::worker_()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this]()
+                                { return stop_ || !jobs_.empty(); });
+                if (stop_)
+                    return;
+
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            /* 失敗時は画素が空のまま返す */
+            Decoded decoded;
+            if (!decode_(job, decoded))
+            {
+                decoded = Decoded{job.key, job.base_mip, 0u, 0u, 0u, 0u, {}};
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                decoded_.push_back(std::move(decoded));
+            }
+
+            /* 休止中のメインループを起こす */
+            glfwPostEmptyEvent();
+        }
+    }
+
+    bool TextureManager::decode_(const Job &job, Decoded &decoded) const
+    {
+        if (job.path.extension() == ".ktx2")
+            return decode_ktx_(job, decoded);
+
+        auto abs_path = std::filesystem::absolute(job.path);
         int width, height, channels;
-        constexpr int DESIRED_CHANNELS = 4;
         stbi_uc *img = stbi_load(abs_path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-        std::size_t img_size = width * height * DESIRED_CHANNELS;
+        if (img == nullptr)
+            return false;
 
-        Texture texture;
-        if (img != nullptr)
-        {
-            auto &memory_manager = Core::get_instance().mm;
-            memory_manager.add_image(path.string(), width, height, Image::TYPE::TEXTURE, true);
-            Image image = memory_manager.get_image(path.string());
-            texture.image = image.image;
-            texture.format = image.format;
-            texture.alloc = image.alloc;
-            texture.alloc_info = image.alloc_info;
-
-            /* イメージビュー作成 */
-            vk::ImageView view;
-            vk::Sampler sampler;
-
-            auto& core = Core::get_instance();
-            vk::Device device = *core.gpu.device;
+        decoded.key = job.key;
+        decoded.base_mip = 0u;
+        decoded.source_width = static_cast<uint32_t>(width);
+        decoded.source_height = static_cast<uint32_t>(height);
+        decoded.width = decoded.source_width;
+        decoded.height = decoded.source_height;
+        decoded.pixels.assign(img, img + static_cast<size_t>(width) * height * CHANNELS);
+        stbi_image_free(img);
+
+        /* 常駐させるミップまで縮小 */
+        while (decoded.base_mip < job.base_mip && (decoded.width > 1u || decoded.height > 1u))
+        {
+            downsample(decoded.pixels, decoded.width, decoded.height);
+            decoded.base_mip++;
+        }
+        return true;
+    }
+
+    bool TextureManager::decode_ktx_(const Job &job, Decoded &decoded) const
+    {
+        auto abs_path = std::filesystem::absolute(job.path);
+        ktxTexture2 *ktx = nullptr;
+        if (ktxTexture2_CreateFromNamedFile(abs_path.string().c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &ktx) != KTX_SUCCESS)
+            return false;
+
+        /* Basis Universalはデバイスの圧縮形式へ変換 */
+        if (ktxTexture2_NeedsTranscoding(ktx) &&
+            ktxTexture2_TranscodeBasis(ktx, static_cast<ktx_transcode_fmt_e>(transcode_format_), 0) != KTX_SUCCESS)
+        {
+            ktxTexture_Destroy(ktxTexture(ktx));
+            return false;
+        }
+
+        if (ktx->vkFormat == VK_FORMAT_UNDEFINED || ktx->numDimensions != 2u || ktx->numFaces != 1u || ktx->isArray)
+        {
+            spdlog::error("Unsupported KTX2 layout: {}", abs_path.string());
+            ktxTexture_Destroy(ktxTexture(ktx));
+            return false;
+        }
+
+        /* 常駐させるミップ以降をファイルからそのまま使う */
+        uint32_t base_mip = std::min(job.base_mip, ktx->numLevels - 1u);
+        decoded.key = job.key;
+        decoded.base_mip = base_mip;
+        decoded.source_width = ktx->baseWidth;
+        decoded.source_height = ktx->baseHeight;
+        decoded.width = std::max(ktx->baseWidth >> base_mip, 1u);
+        decoded.height = std::max(ktx->baseHeight >> base_mip, 1u);
+        decoded.format = static_cast<vk::Format>(ktx->vkFormat);
+        decoded.pixels.clear();
+        decoded.regions.clear();
+
+        auto data = ktxTexture_GetData(ktxTexture(ktx));
+        for (uint32_t level = base_mip; level < ktx->numLevels; level++)
+        {
+            ktx_size_t offset = 0u;
+            ktxTexture_GetImageOffset(ktxTexture(ktx), level, 0u, 0u, &offset);
+            ktx_size_t size = ktxTexture_GetImageSize(ktxTexture(ktx), level);
+
+            vk::BufferImageCopy region;
+            region.setBufferOffset(decoded.pixels.size())
+                .setImageSubresource({vk::ImageAspectFlagBits::eColor, level - base_mip, 0, 1})
+                .setImageExtent({std::max(ktx->baseWidth >> level, 1u), std::max(ktx->baseHeight >> level, 1u), 1u});
+            decoded.regions.push_back(region);
+            decoded.pixels.insert(decoded.pixels.end(), data + offset, data + offset + size);
+        }
+
+        ktxTexture_Destroy(ktxTexture(ktx));
+        return true;
+    }
+
+    bool TextureManager::create_(const Decoded &decoded)
+    {
+        auto &core = Core::get_instance();
+        auto &memory_manager = core.mm;
+
+        /* 置き換え時はバインドレスインデックスを引き継ぐ */
+        uint32_t index = INVALID_INDEX;
+        auto current = textures_.find(decoded.key);
+        if (current != textures_.end())
+        {
+            /* 同じインデックスの記述子を書き換えるので提出済みのフレームのみ待つ */
+            if (current->second.index != INVALID_INDEX)
             {
-                vk::ImageSubresourceRange range;
-                range.setAspectMask(vk::ImageAspectFlagBits::eColor)
-                    .setBaseMipLevel(0)
-                    .setLevelCount(1)
-                    .setBaseArrayLayer(0)
-                    .setLayerCount(1);
-
-                vk::ImageViewCreateInfo create_info;
-                create_info.setImage(image.image)
-                    .setViewType(vk::ImageViewType::e2D)
-                    .setFormat(image.format)
-                    .setSubresourceRange(range);
-                texture.image_view = device.createImageView(create_info);
+                core.gpu.wait(core.gpu.get_submitted_value());
             }
+            index = current->second.index;
+            destroy_(decoded.key);
+            textures_.erase(current);
+        }
 
+        /* KTX2はファイルのミップをそのまま転送, それ以外はRGBA8からミップ生成 */
+        bool added = false;
+        if (decoded.regions.empty())
+        {
+            added = memory_manager.add_image(decoded.key, decoded.width, decoded.height, Image::TYPE::TEXTURE, true) &&
+                    memory_manager.upload_image(decoded.key, decoded.pixels.data(), decoded.width, decoded.height);
+        }
+        else if (core.gpu.physical_device.getFormatProperties(decoded.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage)
+        {
+            added = memory_manager.add_texture_image(decoded.key, decoded.width, decoded.height, decoded.format,
+                                                     static_cast<uint32_t>(decoded.regions.size())) &&
+                    memory_manager.upload_image_levels(decoded.key, decoded.pixels.data(), decoded.pixels.size(), decoded.regions);
+        }
+        else
+        {
+            spdlog::error("Texture format not supported: {} ({})", decoded.key, vk::to_string(decoded.format));
+        }
+
+        if (!added)
+        {
+            memory_manager.remove_image(decoded.key);
+            if (index != INVALID_INDEX)
             {
-                vk::SamplerCreateInfo create_info;
-                create_info.setMagFilter(vk::Filter::eLinear)
-                    .setMinFilter(vk::Filter::eLinear)
-                    .setAddressModeU(vk::SamplerAddressMode::eRepeat)
-                    .setAddressModeV(vk::SamplerAddressMode::eRepeat)
-                    .setAddressModeW(vk::SamplerAddressMode::eRepeat)
-                    .setAnisotropyEnable(vk::False) // TODO 有効化
-                    .setBorderColor(vk::BorderColor::eIntOpaqueBlack)
-                    .setUnnormalizedCoordinates(vk::False)
-                    .setCompareEnable(vk::False)
-                    .setCompareOp(vk::CompareOp::eAlways)
-                    .setMipmapMode(vk::SamplerMipmapMode::eLinear)
-                    .setMipLodBias(0.f)
-                    .setMinLod(0.f)
-                    .setMaxLod(0.f);
-                
-                texture.sampler = device.createSampler(create_info);
+                free_indices_.push_back(index);
             }
+            return false;
+        }
+
+        textures_.insert({decoded.key, wrap_(decoded.key, decoded.base_mip, decoded.source_width, decoded.source_height, index)});
+        return true;
+    }
+
+    Texture TextureManager::wrap_(const std::string &key, const uint32_t &resident_mip, const uint32_t &width, const uint32_t &height, const uint32_t &index)
+    {
+        auto &core = Core::get_instance();
+        vk::Device device = *core.gpu.device;
+        Image image = core.mm.get_image(key);
+
+        Texture texture;
+        texture.image = image.image;
+        texture.format = image.format;
+        texture.alloc = image.alloc;
+        texture.alloc_info = image.alloc_info;
+        texture.width = width;
+        texture.height = height;
+        texture.mip_levels = image.mip_levels;
+        texture.resident_mip = resident_mip;
+        texture.index = index == INVALID_INDEX ? acquire_index_() : index;
+        texture.sampler = get_sampler(texture_sampler_info());
 
-            textures_.insert({path.string(), texture});
-            memory_manager.upload_image(path.string(), img, width, height);
+        /* イメージビュー作成 */
+        {
+            vk::ImageSubresourceRange range;
+            range.setAspectMask(vk::ImageAspectFlagBits::eColor)
+                .setBaseMipLevel(0)
+                .setLevelCount(image.mip_levels)
+                .setBaseArrayLayer(0)
+                .setLayerCount(1);
+
+            vk::ImageViewCreateInfo create_info;
+            create_info.setImage(image.image)
+                .setViewType(vk::ImageViewType::e2D)
+                .setFormat(image.format)
+                .setSubresourceRange(range);
+            texture.image_view = device.createImageView(create_info);
         }
-        else
+
+        /* バインドレス配列へ登録 */
+        if (texture.index != INVALID_INDEX)
         {
-            spdlog::error("Failed to load {}", abs_path.string());
+            vk::DescriptorImageInfo image_info(texture.sampler, texture.image_view, vk::ImageLayout::eShaderReadOnlyOptimal);
+            vk::WriteDescriptorSet write;
+            write.setDstSet(*bindless_set)
+                .setDstBinding(0)
+                .setDstArrayElement(texture.index)
+                .setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+                .setImageInfo(image_info);
+            device.updateDescriptorSets(write, {});
         }
-        stbi_image_free(img);
 
         return texture;
     }
 
-    // TODO remove処理を追加
-    bool TextureManager::remove(const std::string& key)
+    bool TextureManager::shrink_(const std::string &key)
     {
-        bool ret = false;
-        if(textures_.count(key) != 0)
+        auto it = textures_.find(key);
+        if (it == textures_.end())
+            return false;
+
+        auto &core = Core::get_instance();
+        auto &memory_manager = core.mm;
+        auto old_image = memory_manager.get_image(key);
+        if (old_image.mip_levels <= 1u || std::max(old_image.width, old_image.height) / 2u < min_resident_size)
+            return false;
+
+        /* 最上位ミップを捨て, 残りのミップをGPU上で新しいイメージへコピー */
+        auto shrink_key = key + "#shrink";
+        uint32_t width = std::max(old_image.width / 2u, 1u);
+        uint32_t height = std::max(old_image.height / 2u, 1u);
+        if (!memory_manager.add_texture_image(shrink_key, width, height, old_image.format, old_image.mip_levels - 1u))
+            return false;
+        auto new_image = memory_manager.get_image(shrink_key);
+
+        /* 提出済みフレームのサンプルとはキュー順の実行依存で同期し, 完了は待たない */
+        auto value = core.gpu.one_shot_async([&](vk::raii::CommandBuffer &command_buffer)
+                                             {
+            std::array<vk::ImageMemoryBarrier, 2> before;
+            before[0].setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal).setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setImage(old_image.image).setSubresourceRange({vk::ImageAspectFlagBits::eColor, 1u, new_image.mip_levels, 0, 1})
+                .setSrcAccessMask(vk::AccessFlagBits::eShaderRead).setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+            before[1].setOldLayout(vk::ImageLayout::eUndefined).setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setImage(new_image.image).setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0u, new_image.mip_levels, 0, 1})
+                .setSrcAccessMask(vk::AccessFlagBits::eNone).setDstAccessMask(vk::AccessFlagBits::eTransferWrite);
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                                           {}, {}, {}, before);
+
+            std::vector<vk::ImageCopy> regions;
+            for (uint32_t level = 0u; level < new_image.mip_levels; level++)
+            {
+                vk::ImageCopy region;
+                region.setSrcSubresource({vk::ImageAspectFlagBits::eColor, level + 1u, 0, 1})
+                    .setDstSubresource({vk::ImageAspectFlagBits::eColor, level, 0, 1})
+                    .setExtent({std::max(width >> level, 1u), std::max(height >> level, 1u), 1u});
+                regions.push_back(region);
+            }
+            command_buffer.copyImage(old_image.image, vk::ImageLayout::eTransferSrcOptimal,
+                                     new_image.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+            vk::ImageMemoryBarrier after;
+            after.setOldLayout(vk::ImageLayout::eTransferDstOptimal).setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setImage(new_image.image).setSubresourceRange({vk::ImageAspectFlagBits::eColor, 0u, new_image.mip_levels, 0, 1})
+                .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite).setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                           {}, {}, {}, after); });
+
+        /* 古いイメージとビューは提出済みのフレームとコピーが終わってから破棄 (destroy_, rename_imageが遅延破棄).
+           使用中の記述子は書き換えられないので新しいインデックスへ登録し, 古いものの返却も遅らせる */
+        uint32_t resident_mip = it->second.resident_mip + 1u;
+        uint32_t source_width = it->second.width;
+        uint32_t source_height = it->second.height;
+        uint32_t index = it->second.index;
+        if (index != INVALID_INDEX)
+        {
+            uint32_t new_index = acquire_index_();
+            if (new_index == INVALID_INDEX)
+            {
+                /* 空きが無ければ同じインデックスを使うため, 参照する提出の完了を待つ */
+                core.gpu.wait(value);
+            }
+            else
+            {
+                core.mm.defer_release([this, index]()
+                                      { free_indices_.push_back(index); });
+                index = new_index;
+            }
+        }
+        destroy_(key);
+        textures_.erase(it);
+        memory_manager.rename_image(shrink_key, key);
+
+        textures_.insert({key, wrap_(key, resident_mip, source_width, source_height, index)});
+        return true;
+    }
+
+    size_t TextureManager::evict_(const size_t &requested)
+    {
+        /* 長く使われていないものから1段ずつ縮小 */
+        std::vector<std::pair<uint64_t, std::string>> candidates;
+        for (const auto &texture : textures_)
+        {
+            /* アトラスページなどファイル由来でないものは対象外 */
+            auto it = residency_.find(texture.first);
+            if (it == residency_.end())
+                continue;
+            if (it->second.last_used_frame < frame_)
+            {
+                candidates.push_back({it->second.last_used_frame, texture.first});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        size_t freed = 0u;
+        for (const auto &candidate : candidates)
+        {
+            while (freed < requested)
+            {
+                size_t before = textures_.at(candidate.second).alloc_info.size;
+                if (!shrink_(candidate.second))
+                    break;
+                freed += before - std::min(before, static_cast<size_t>(textures_.at(candidate.second).alloc_info.size));
+            }
+            if (freed >= requested)
+                break;
+        }
+
+        if (freed != 0u)
+        {
+            spdlog::info("Texture residency: evicted {} bytes", freed);
+        }
+        return freed;
+    }
+
+    void TextureManager::advance_frame_()
+    {
+        frame_++;
+    }
+
+    void TextureManager::update()
+    {
+        atlas.update();
+
+        /* デコード済みをアップロード */
+        std::vector<Decoded> decoded;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            decoded.swap(decoded_);
+        }
+        for (auto &result : decoded)
         {
-            ret = true;
-            auto texture = textures_.at(key);
-            auto &core = Core::get_instance();
-            vk::Device device = *core.gpu.device;
+            auto it = residency_.find(result.key);
+            if (it == residency_.end())
+                continue;
+
+            it->second.loading = false;
+            if (result.pixels.empty())
+            {
+                spdlog::error("Failed to load {}", std::filesystem::absolute(it->second.path).string());
+                continue;
+            }
+            create_(result);
+        }
+
+        /* 予算超過分を追い出す */
+        size_t resident_bytes = get_resident_bytes();
+        if (resident_bytes > texture_budget)
+        {
+            evict_(resident_bytes - texture_budget);
+            resident_bytes = get_resident_bytes();
+        }
+
+        /* 直近で使われた縮小済みテクスチャを1段ずつ戻す (1段上のミップは約4倍) */
+        for (auto &residency : residency_)
+        {
+            auto texture = textures_.find(residency.first);
+            if (texture == textures_.end() || residency.second.loading || texture->second.resident_mip == 0u)
+                continue;
+            if (residency.second.last_used_frame + 1u < frame_)
+                continue;
+
+            size_t estimate = texture->second.alloc_info.size * 4u;
+            if (resident_bytes + estimate > texture_budget)
+                continue;
 
-            device.destroyImageView(texture.image_view);
-            device.destroySampler(texture.sampler);
+            residency.second.loading = true;
+            resident_bytes += estimate;
+            enqueue_(residency.first, texture->second.resident_mip - 1u);
+        }
+    }
+
+    void TextureManager::destroy_(const std::string &key)
+    {
+        auto &core = Core::get_instance();
+        vk::Device device = *core.gpu.device;
+
+        /* 提出済みのフレームが使い終わってから破棄. サンプラは共有なので破棄しない */
+        VkDescriptorSet imgui_set = VK_NULL_HANDLE;
+        auto imgui_texture = imgui_textures_.find(key);
+        if (imgui_texture != imgui_textures_.end())
+        {
+            imgui_set = imgui_texture->second;
+            imgui_textures_.erase(imgui_texture);
         }
 
-        return ret;
+        core.mm.defer_release([device, imgui_set, image_view = textures_.at(key).image_view]()
+                              {
+            if (imgui_set != VK_NULL_HANDLE)
+                ImGui_ImplVulkan_RemoveTexture(imgui_set);
+            device.destroyImageView(image_view); });
+    }
+
+    bool TextureManager::remove(const std::string& key)
+    {
+        auto it = textures_.find(key);
+        if (it == textures_.end())
+            return false;
+
+        destroy_(key);
+        if (it->second.index != INVALID_INDEX)
+        {
+            /* 使用中の記述子を再利用しないよう, インデックスの返却も遅らせる */
+            Core::get_instance().mm.defer_release([this, index = it->second.index]()
+                                                  { free_indices_.push_back(index); });
+        }
+        textures_.erase(it);
+        residency_.erase(key);
+        Core::get_instance().mm.remove_image(key);
+        return true;
     }
-    // TODO リファクタリング
 }
\ No newline at end of file
@@ -1,11 +1,17 @@
 #ifndef _TEXTURE_MANAGER_HPP
 #define _TEXTURE_MANAGER_HPP
-#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "NEGUI2/Core/MemoryManager.hpp"
+#include "NEGUI2/Core/TextureAtlas.hpp"
 
 namespace NEGUI2
 {
@@ -14,25 +20,108 @@ namespace NEGUI2
     {
         vk::Image image;
         vk::ImageView image_view;
-        vk::Sampler sampler;
+        vk::Sampler sampler;   // SamplerCacheの共有サンプラ
         vk::Format format;
         VmaAllocation alloc;
         VmaAllocationInfo alloc_info;
+        uint32_t width;        // 元画像の大きさ
+        uint32_t height;
+        uint32_t mip_levels;   // 常駐しているミップ数
+        uint32_t resident_mip; // 常駐している最上位ミップ (0が元画像)
+        uint32_t index;        // バインドレス配列のインデックス
     };
 
     class TextureManager
     {
         friend class Core;
+
+        /* ワーカースレッドでのデコード */
+        struct Job
+        {
+            std::string key;
+            std::filesystem::path path;
+            uint32_t base_mip;
+        };
+
+        struct Decoded
+        {
+            std::string key;
+            uint32_t base_mip;
+            uint32_t width;
+            uint32_t height;
+            uint32_t source_width;
+            uint32_t source_height;
+            std::vector<uint8_t> pixels;             // RGBA8, またはKTX2の各ミップを連結したもの
+            vk::Format format;                       // KTX2のみ
+            std::vector<vk::BufferImageCopy> regions; // 空ならRGBA8としてミップを生成
+        };
+
+        struct Residency
+        {
+            std::filesystem::path path;
+            uint64_t last_used_frame;
+            bool loading;
+        };
+
         std::unordered_map<std::string, Texture> textures_;
+        std::unordered_map<std::string, Residency> residency_;
+        std::vector<std::thread> workers_;
+        std::deque<Job> jobs_;
+        std::vector<Decoded> decoded_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool stop_;
+        uint64_t frame_; // シーンを記録したフレームの数. 描画しない休止中は進めない
+        uint32_t transcode_format_; // Basis Universalの変換先 (ktx_transcode_fmt_e)
+
+        /* 共有サンプラとバインドレス配列 */
+        std::vector<std::pair<vk::SamplerCreateInfo, vk::raii::Sampler>> samplers_;
+        vk::raii::DescriptorPool bindless_pool_;
+        std::vector<uint32_t> free_indices_;
+        uint32_t bindless_count_;
+        uint32_t bindless_capacity_;
+        std::unordered_map<std::string, VkDescriptorSet> imgui_textures_;
+
         TextureManager();
         void init(); // TODO すべてのモジュールにデストロイを追加
         TextureManager(const TextureManager& other) = delete;
         TextureManager& operator=(const TextureManager& other) = delete;
+        void init_bindless_();
+
+        void worker_();
+        void select_transcode_format_();
+        bool decode_(const Job &job, Decoded &decoded) const;
+        bool decode_ktx_(const Job &job, Decoded &decoded) const;
+        void enqueue_(const std::string &key, const uint32_t &base_mip);
+        bool create_(const Decoded &decoded);
+        Texture wrap_(const std::string &key, const uint32_t &resident_mip, const uint32_t &width, const uint32_t &height, const uint32_t &index);
+        uint32_t acquire_index_();
+        bool shrink_(const std::string &key);
+        size_t evict_(const size_t &requested);
+        void destroy_(const std::string &key);
+        void advance_frame_(); // シーンのコマンドを記録したフレームの終わりにCoreが呼ぶ
+
     public:
         ~TextureManager();
+        size_t texture_budget;   // 常駐させるテクスチャの上限 [byte]
+        uint32_t min_resident_size; // 縮小時に残す最小の辺 [pixel]
+        TextureAtlas atlas;
+        vk::raii::DescriptorSetLayout bindless_layout;
+        vk::raii::DescriptorSet bindless_set; // set = DescriptorSetIndex::BINDLESS, binding = 0 (Bindless.glsl)
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
         Texture get(const std::string& key);
         Texture load_from_file(const std::filesystem::path& path);
+        Texture load_from_memory(const std::string& key, const void *pixels, const uint32_t& width, const uint32_t& height);
+        bool load_region(const std::string& key, const void *pixels, const uint32_t& row_length, const vk::Offset2D& offset, const vk::Extent2D& extent); // 常駐中の全解像度テクスチャの一部のみ更新
+        void load_async(const std::filesystem::path& path);
+        bool is_ready(const std::string& key) const;
+        void touch(const std::string& key); // 描画を記録する時に呼ぶ
+        void update();
+        size_t get_resident_bytes() const;
         bool remove(const std::string& key);
+        vk::Sampler get_sampler(const vk::SamplerCreateInfo& create_info);
+        VkDescriptorSet get_imgui_texture(const std::string& key);
     };
 }
 
@@ -0,0 +1,121 @@
+#include "NEGUI2/Core/Trace.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+    std::string escape_json(const char *text)
+    {
+        std::string escaped;
+        for (const char *c = text; *c != '\0'; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                escaped.push_back('\\');
+            }
+            escaped.push_back(*c);
+        }
+        return escaped;
+    }
+}
+
+namespace NEGUI2
+{
+    Trace::Trace() : mutex_(), buffers_(), origin_ticks_(now()), origin_ns_(steady_ns())
+    {
+    }
+
+    Trace::~Trace()
+    {
+    }
+
+    Trace &Trace::get_instance()
+    {
+        static Trace trace;
+        return trace;
+    }
+
+    Trace::ThreadBuffer &Trace::register_thread_()
+    {
+        /* スレッド初回の記録時のみロックを取る */
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto buffer = std::make_unique<ThreadBuffer>();
+        for (auto &slot : buffer->slots)
+        {
+            slot.sequence.store(0u, std::memory_order_relaxed);
+        }
+        buffer->head.store(0u, std::memory_order_relaxed);
+        buffer->thread_id = static_cast<uint32_t>(buffers_.size());
+        buffers_.push_back(std::move(buffer));
+        return *buffers_.back();
+    }
+
+    std::vector<std::pair<uint32_t, Trace::Event>> Trace::collect()
+    {
+        std::vector<std::pair<uint32_t, Event>> events;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &buffer : buffers_)
+        {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t tail = head > BUFFER_SIZE ? head - BUFFER_SIZE : 0u;
+            for (uint64_t i = tail; i < head; ++i)
+            {
+                /* 読む前後で通し番号が一致した要素のみ採用 (上書き中/上書き済みは捨てる) */
+                const auto &slot = buffer->slots[i & (BUFFER_SIZE - 1u)];
+                if (slot.sequence.load(std::memory_order_acquire) != i + 1u)
+                    continue;
+                Event event{slot.name.load(std::memory_order_relaxed),
+                            slot.begin.load(std::memory_order_relaxed),
+                            slot.end.load(std::memory_order_relaxed)};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != i + 1u)
+                    continue;
+                events.push_back({buffer->thread_id, event});
+            }
+        }
+
+        std::sort(events.begin(), events.end(), [](const auto &a, const auto &b)
+                  { return a.second.begin < b.second.begin; });
+        return events;
+    }
+
+    bool Trace::write_chrome_trace(const std::string &path)
+    {
+        std::ofstream stream(path);
+        if (!stream)
+        {
+            spdlog::error("Failed to open trace file: {}", path);
+            return false;
+        }
+
+        auto events = collect();
+
+        /* 起動時と現在の2点からtick→nsの換算係数を求める */
+        double ns_per_tick = 1.0;
+#ifdef NEGUI2_TRACE_USE_TSC
+        {
+            int64_t ticks = now() - origin_ticks_;
+            int64_t ns = steady_ns() - origin_ns_;
+            ns_per_tick = ticks > 0 ? static_cast<double>(ns) / static_cast<double>(ticks) : 1.0;
+        }
+#endif
+
+        /* Complete Event ("ph":"X") の配列, 時間単位はus */
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const auto &event : events)
+        {
+            double ts = static_cast<double>(event.second.begin - origin_ticks_) * ns_per_tick * 1E-3;
+            double dur = static_cast<double>(event.second.end - event.second.begin) * ns_per_tick * 1E-3;
+            stream << (first ? "" : ",") << "\n{\"name\":\"" << escape_json(event.second.name)
+                   << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.first
+                   << ",\"ts\":" << std::fixed << ts << ",\"dur\":" << dur << "}";
+            first = false;
+        }
+        stream << "\n]}\n";
+
+        spdlog::info("Trace written: {} ({} events)", path, events.size());
+        return static_cast<bool>(stream);
+    }
+}
\ No newline at end of file
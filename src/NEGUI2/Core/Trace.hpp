@@ -0,0 +1,136 @@
+#ifndef _TRACE_HPP
+#define _TRACE_HPP
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define NEGUI2_TRACE_USE_TSC
+#endif
+
+namespace NEGUI2
+{
+    /* CPU区間計測 (Chrome trace形式で出力) */
+    class Trace
+    {
+    public:
+        struct Event
+        {
+            const char *name; // 文字列リテラルのみ
+            int64_t begin;    // now()の値 (出力時にnsへ換算)
+            int64_t end;
+        };
+
+        static constexpr size_t BUFFER_SIZE = 1u << 14; // スレッド毎のイベント数 (2の累乗)
+
+    private:
+        /* collectと並行して書かれるので各要素はatomic. sequenceは書き終えた記録の通し番号+1 (書き込み中は0) */
+        struct Slot
+        {
+            std::atomic<uint64_t> sequence;
+            std::atomic<const char *> name;
+            std::atomic<int64_t> begin;
+            std::atomic<int64_t> end;
+        };
+
+        /* スレッド毎のリングバッファ (書き込みは所有スレッドのみ) */
+        struct ThreadBuffer
+        {
+            std::array<Slot, BUFFER_SIZE> slots;
+            std::atomic<uint64_t> head;
+            uint32_t thread_id;
+        };
+
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+        int64_t origin_ticks_;
+        int64_t origin_ns_;
+
+        Trace();
+        Trace(const Trace &other) = delete;
+        Trace &operator=(const Trace &other) = delete;
+        ThreadBuffer &register_thread_();
+
+    public:
+        ~Trace();
+        static Trace &get_instance();
+        static constexpr bool is_enabled()
+        {
+#ifdef NEGUI2_ENABLE_TRACE
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        /* x86ではTSCを直接読む (steady_clockより安価, 出力時に較正) */
+        static int64_t now()
+        {
+#ifdef NEGUI2_TRACE_USE_TSC
+            return static_cast<int64_t>(__rdtsc());
+#else
+            return steady_ns();
+#endif
+        }
+
+        static int64_t steady_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void record(const char *name, const int64_t &begin, const int64_t &end)
+        {
+            thread_local ThreadBuffer *buffer = &register_thread_();
+            uint64_t head = buffer->head.load(std::memory_order_relaxed);
+            auto &slot = buffer->slots[head & (BUFFER_SIZE - 1u)];
+
+            /* 書き込み中の印を先に出す (x86ではどれも通常のストア) */
+            slot.sequence.store(0u, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.begin.store(begin, std::memory_order_relaxed);
+            slot.end.store(end, std::memory_order_relaxed);
+            slot.sequence.store(head + 1u, std::memory_order_release);
+            buffer->head.store(head + 1u, std::memory_order_release);
+        }
+
+        /* 記録中のスレッドがあっても壊れた値は返さないが, 取りこぼしはあり得る.
+           全イベントを得るには記録するスレッドが止まっている時に呼ぶ */
+        std::vector<std::pair<uint32_t, Event>> collect();
+        bool write_chrome_trace(const std::string &path);
+    };
+
+    class TraceScope
+    {
+        const char *name_;
+        int64_t begin_;
+
+    public:
+        explicit TraceScope(const char *name) : name_(name), begin_(Trace::now()) {}
+        ~TraceScope()
+        {
+            Trace::get_instance().record(name_, begin_, Trace::now());
+        }
+        TraceScope(const TraceScope &other) = delete;
+        TraceScope &operator=(const TraceScope &other) = delete;
+    };
+}
+
+#define NEGUI2_TRACE_CONCAT_(a, b) a##b
+#define NEGUI2_TRACE_CONCAT(a, b) NEGUI2_TRACE_CONCAT_(a, b)
+#ifdef NEGUI2_ENABLE_TRACE
+#define NEGUI2_TRACE_SCOPE(name) ::NEGUI2::TraceScope NEGUI2_TRACE_CONCAT(negui2_trace_scope_, __LINE__)(name)
+#else
+#define NEGUI2_TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif
\ No newline at end of file
@@ -2,6 +2,23 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 #include <spdlog/spdlog.h>
+#include <cstdlib>
+
+namespace
+{
+  /* ImGuiのコールバックより先に登録し, ImGui側から連鎖して呼ばれる */
+  bool input_received = true;
+
+  void on_cursor_pos(GLFWwindow *, double, double) { input_received = true; }
+  void on_mouse_button(GLFWwindow *, int, int, int) { input_received = true; }
+  void on_scroll(GLFWwindow *, double, double) { input_received = true; }
+  void on_key(GLFWwindow *, int, int, int, int) { input_received = true; }
+  void on_char(GLFWwindow *, unsigned int) { input_received = true; }
+  void on_cursor_enter(GLFWwindow *, int) { input_received = true; }
+  void on_focus(GLFWwindow *, int) { input_received = true; }
+  void on_resize(GLFWwindow *, int, int) { input_received = true; }
+  void on_refresh(GLFWwindow *) { input_received = true; }
+}
 
 namespace NEGUI2
 {
@@ -16,7 +33,22 @@ namespace NEGUI2
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+    /* ベンチマーク等の無人実行時はウィンドウを表示しない */
+    if (std::getenv("NEGUI2_HIDDEN_WINDOW") != nullptr)
+    {
+      glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
     window_ = glfwCreateWindow(WIDTH, HEIGHT, "NEGUI2", nullptr, nullptr);
+
+    glfwSetCursorPosCallback(window_, on_cursor_pos);
+    glfwSetMouseButtonCallback(window_, on_mouse_button);
+    glfwSetScrollCallback(window_, on_scroll);
+    glfwSetKeyCallback(window_, on_key);
+    glfwSetCharCallback(window_, on_char);
+    glfwSetCursorEnterCallback(window_, on_cursor_enter);
+    glfwSetWindowFocusCallback(window_, on_focus);
+    glfwSetFramebufferSizeCallback(window_, on_resize);
+    glfwSetWindowRefreshCallback(window_, on_refresh);
   }
 
   Window::~Window()
@@ -49,4 +81,11 @@ namespace NEGUI2
 
     return extent;
   }
+
+  bool Window::consume_input()
+  {
+    bool ret = input_received;
+    input_received = false;
+    return ret;
+  }
 }
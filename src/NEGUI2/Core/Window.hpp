@@ -27,6 +27,7 @@ namespace NEGUI2
     bool should_close() const;
     void get_extent(int &width, int &height) const;
     vk::Extent2D get_extent() const;
+    bool consume_input(); // 前回呼び出し以降に入力があったか
   };
 
 }
@@ -7,7 +7,7 @@ namespace NEGUI2
 {
     AABB::AABB()
     : BaseTransform(), pipeline_(nullptr), pipeline_layout_(nullptr),
-      box_(), push_constant_()
+      box_(), push_constant_(), color_(1.f, 0.f, 0.f, 1.f)
     {
     }
 
@@ -21,13 +21,20 @@ namespace NEGUI2
         auto &core = Core::get_instance();
 
         command.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline_);
-        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {*core.gpu.descriptor_set}, nullptr);
+        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, DescriptorSetIndex::COMMON, {core.gpu.descriptor_set}, nullptr);
+
+        /* 描画毎の色はフレーム用バッファから動的オフセットで渡す */
+        auto draw = core.frame_allocator.push(color_);
+        if (!draw.descriptor_set)
+            return;
+        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, DescriptorSetIndex::DRAW, {draw.descriptor_set}, {draw.offset});
+
         Eigen::Vector3f max = box_.max().cast<float>();
         Eigen::Vector3f min = box_.min().cast<float>();
         auto diff = max - min;
         Eigen::Affine3f offset(Eigen::Translation3f(min.x(), min.y(), min.z()));
         Eigen::Matrix4f scale = Eigen::Scaling(Eigen::Vector4f(diff.x(), diff.y(), diff.z(), 1.f));
-        push_constant_.model = transform_.matrix().cast<float>() * offset.matrix() * scale.matrix();
+        push_constant_.model = render_matrix_ * offset.matrix() * scale.matrix();
         command.pushConstants<PushConstant>(*pipeline_layout_, vk::ShaderStageFlagBits::eVertex, 0, push_constant_);
         
         command.draw(24, 1, 0, 0);
@@ -38,6 +45,11 @@ namespace NEGUI2
         box_ = box;
     }
 
+    void AABB::set_color(const Eigen::Vector4f &color)
+    {
+        color_ = color;
+    }
+
     void AABB::init()
     {
         auto &core = Core::get_instance();
@@ -105,7 +117,8 @@ namespace NEGUI2
                                .setSrcAlphaBlendFactor(vk::BlendFactor::eOne)
                                .setDstAlphaBlendFactor(vk::BlendFactor::eOne)
                                .setAlphaBlendOp(vk::BlendOp::eMax);
-        colorBlendAttachment[1].setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
+        /* ピック画像には書き込まない */
+        colorBlendAttachment[1].setColorWriteMask({})
                                .setBlendEnable(vk::False);
 
         std::array<float, 4> blend_constant{};
@@ -121,29 +134,38 @@ namespace NEGUI2
                      .setSize(sizeof(PushConstant))
                      .setOffset(0);
 
+        /* BINDLESSの番号はテクスチャを使わないので空のレイアウトで埋める */
+        std::array<vk::DescriptorSetLayout, 3> set_layouts;
+        set_layouts[DescriptorSetIndex::COMMON] = core.gpu.descriptor_set_layout;
+        set_layouts[DescriptorSetIndex::BINDLESS] = core.gpu.descriptors.get_layout({});
+        set_layouts[DescriptorSetIndex::DRAW] = core.frame_allocator.get_descriptor_set_layout();
         vk::PipelineLayoutCreateInfo pipeline_layout;
-        pipeline_layout.setSetLayouts(*core.gpu.descriptor_set_layout)
+        pipeline_layout.setSetLayouts(set_layouts)
                        .setPushConstantRanges(push_constant);
 
         auto &device = core.gpu.device;
         pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
 
-        auto &render_pass = core.off_screen.render_pass;
+        /* ビューポートは動的解像度に合わせて毎フレーム設定 */
+        std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic_state;
+        dynamic_state.setDynamicStates(dynamic_states);
 
         vk::GraphicsPipelineCreateInfo pipeline_info;
         pipeline_info.setStages(shader_stages)
             .setPVertexInputState(&vertex_input_state)
             .setPInputAssemblyState(&input_assembly)
             .setPViewportState(&viewport_state)
+            .setPDynamicState(&dynamic_state)
             .setPRasterizationState(&rasterizer)
             .setPMultisampleState(&multisampling)
             .setPColorBlendState(&color_blending)
             .setLayout(*pipeline_layout_)
-            .setRenderPass(*render_pass)
             .setPDepthStencilState(&depth_stencil)
             .setSubpass(0)
             .setBasePipelineHandle(nullptr);
 
+        core.off_screen.set_render_target(pipeline_info);
         auto &pipeline_cache = core.gpu.pipeline_cache;
         pipeline_ = device.createGraphicsPipeline(pipeline_cache, pipeline_info);
     }
@@ -12,6 +12,7 @@ namespace NEGUI2
         vk::raii::PipelineLayout pipeline_layout_;
         Eigen::AlignedBox3d box_;
         PushConstant push_constant_;
+        Eigen::Vector4f color_;
         
 
         public:
@@ -20,6 +21,7 @@ namespace NEGUI2
 
         void init();
         void set_box(const Eigen::AlignedBox3d& box);
+        void set_color(const Eigen::Vector4f& color);
         void render(vk::raii::CommandBuffer &command);
     };
 
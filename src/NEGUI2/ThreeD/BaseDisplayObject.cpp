@@ -11,6 +11,12 @@ namespace NEGUI2
     {
     }
 
+    uint32_t BaseDisplayObject::get_primitive_count() const
+    {
+        /* 0はオブジェクト単位で選択 */
+        return 0u;
+    }
+
     bool BaseDisplayObject::is_enable() const
     {
         return enable_;
@@ -24,6 +24,7 @@ namespace NEGUI2
         virtual void rebuild() = 0;
         virtual int32_t get_type_id() = 0;
         virtual int32_t get_instance_id() = 0;
+        virtual uint32_t get_primitive_count() const;
         virtual bool is_enable() const;
         virtual void set_enable(const bool enable = true);
     };
@@ -0,0 +1,32 @@
+#include "NEGUI2/ThreeD/BaseNearestPickable.hpp"
+
+namespace NEGUI2
+{
+    BaseNearestPickable::BaseNearestPickable()
+        : BasePickable(), nearest_{false, 0u, 0.0, Eigen::Vector3d::Zero()}
+    {
+    }
+
+    BaseNearestPickable::~BaseNearestPickable()
+    {
+    }
+
+    double BaseNearestPickable::pick(const Eigen::Vector3d &origin, const Eigen::Vector3d &direction)
+    {
+        /* 直近のGPU問い合わせ結果を使う */
+        if (!nearest_.hit)
+            return -1.0;
+
+        return (nearest_.position - origin).norm();
+    }
+
+    void BaseNearestPickable::set_nearest(const NearestResult &nearest)
+    {
+        nearest_ = nearest;
+    }
+
+    NearestResult BaseNearestPickable::nearest() const
+    {
+        return nearest_;
+    }
+}
\ No newline at end of file
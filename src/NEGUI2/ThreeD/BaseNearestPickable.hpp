@@ -0,0 +1,45 @@
+#ifndef _BASE_NEAREST_PICKABLE_HPP
+#define _BASE_NEAREST_PICKABLE_HPP
+#include "NEGUI2/ThreeD/BasePickable.hpp"
+#include <Eigen/Dense>
+#include <vulkan/vulkan_raii.hpp>
+#include <cinttypes>
+
+namespace NEGUI2
+{
+    /* GPU上の頂点バッファから最近傍プリミティブを探す対象 */
+    struct NearestSource
+    {
+        vk::Buffer buffer;
+        uint32_t count;
+        uint32_t stride; // [float]
+        uint32_t first;  // 位置 (線分の始点) のオフセット [float]
+        uint32_t second; // 線分の終点のオフセット [float]
+        bool segment;
+        Eigen::Matrix4f model;
+    };
+
+    struct NearestResult
+    {
+        bool hit;
+        uint32_t index;
+        double distance; // 画面上の距離 [pixel]
+        Eigen::Vector3d position;
+    };
+
+    class BaseNearestPickable : public BasePickable
+    {
+    protected:
+        NearestResult nearest_;
+
+    public:
+        BaseNearestPickable();
+        ~BaseNearestPickable() override;
+        virtual NearestSource nearest_source() = 0;
+        double pick(const Eigen::Vector3d &origin, const Eigen::Vector3d &direction) override;
+        void set_nearest(const NearestResult &nearest);
+        NearestResult nearest() const;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "NEGUI2/ThreeD/BasePickable.hpp"
+#include "NEGUI2/Core/Core.hpp"
 
 namespace NEGUI2
 {
     BasePickable::BasePickable()
-        : display_aabb_(false)
+        : box_changed_(true), display_aabb_(false)
     {
     }
 
@@ -19,11 +20,25 @@ namespace NEGUI2
     void BasePickable::set_display_aabb(const bool aabb)
     {
         display_aabb_ = aabb;
+        Core::get_instance().invalidate();
     }
 
     void BasePickable::toggle_display_aabb()
     {
         display_aabb_ = !display_aabb_;
+        Core::get_instance().invalidate();
+    }
+
+    void BasePickable::set_box_(const Eigen::AlignedBox3d &box)
+    {
+        box_ = box;
+        box_changed_ = true;
+    }
+
+    void BasePickable::extend_box_(const Eigen::Vector3d &point)
+    {
+        box_.extend(point);
+        box_changed_ = true;
     }
 
     Eigen::AlignedBox3d BasePickable::box() const
@@ -5,9 +5,14 @@ namespace NEGUI2
 {
     class BasePickable
     {
+        friend class TransformHierarchy;
+        bool box_changed_; // ワールド座標のAABBを取り直す
+
     protected:
         Eigen::AlignedBox3d box_;
         bool display_aabb_;
+        void set_box_(const Eigen::AlignedBox3d &box);
+        void extend_box_(const Eigen::Vector3d &point);
 
     public:
         BasePickable();
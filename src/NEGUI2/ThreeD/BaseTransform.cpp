@@ -1,14 +1,33 @@
 #include "NEGUI2/ThreeD/BaseTransform.hpp"
+#include "NEGUI2/ThreeD/TransformHierarchy.hpp"
 
 namespace NEGUI2
 {
     BaseTransform::BaseTransform()
-        : transform_(Eigen::Affine3d::Identity())
+        : hierarchy_(nullptr), node_(TransformHierarchy::NONE), transform_(Eigen::Affine3d::Identity()),
+          world_(Eigen::Affine3d::Identity()), render_matrix_(Eigen::Matrix4f::Identity())
     {
     }
 
     BaseTransform::~BaseTransform()
     {
+        if (hierarchy_ != nullptr)
+        {
+            hierarchy_->remove(this);
+        }
+    }
+
+    void BaseTransform::transform_changed_()
+    {
+        /* 階層に属していれば子孫ごと次の更新で計算し直す. 再描画の要求は階層の持ち主 (ThreeD) が行う */
+        if (hierarchy_ != nullptr)
+        {
+            hierarchy_->set_local(node_, transform_);
+        }
+        else
+        {
+            world_ = transform_;
+        }
     }
 
     Eigen::Affine3d BaseTransform::get_transform() const
@@ -19,6 +38,12 @@ namespace NEGUI2
     void BaseTransform::set_transform(const Eigen::Affine3d &transform)
     {
         transform_ = transform;
+        transform_changed_();
+    }
+
+    Eigen::Affine3d BaseTransform::get_world_transform() const
+    {
+        return world_;
     }
 
     Eigen::Vector3d BaseTransform::get_position() const
@@ -29,6 +54,7 @@ namespace NEGUI2
     void BaseTransform::set_position(const Eigen::Vector3d &position)
     {
         transform_.translation() = position;
+        transform_changed_();
     }
 
     Eigen::Matrix3d BaseTransform::get_orientation() const
@@ -41,6 +67,17 @@ namespace NEGUI2
         /* reset rotation */
         auto inv = transform_.rotation();
         transform_ = rotation * inv.inverse() * transform_;
+        transform_changed_();
+    }
+
+    Eigen::Matrix4f BaseTransform::get_render_matrix() const
+    {
+        return render_matrix_;
+    }
+
+    void BaseTransform::set_render_matrix(const Eigen::Matrix4f &matrix)
+    {
+        render_matrix_ = matrix;
     }
 
     Eigen::Vector3d BaseTransform::front() const
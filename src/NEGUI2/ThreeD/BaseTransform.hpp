@@ -5,10 +5,19 @@
 
 namespace NEGUI2
 {
+    class TransformHierarchy;
+
     class BaseTransform
     {
+        friend class TransformHierarchy;
+        TransformHierarchy *hierarchy_; // ThreeDに追加されている間のみ
+        uint32_t node_;
+
     protected:
-        Eigen::Affine3d transform_;
+        Eigen::Affine3d transform_;     // 親からの相対 (親が無ければワールド)
+        Eigen::Affine3d world_;         // 親を含めたワールド変換
+        Eigen::Matrix4f render_matrix_; // カメラ原点からの相対 (GPUへ渡す)
+        void transform_changed_();
 
     public:
         BaseTransform();
@@ -16,6 +25,7 @@ namespace NEGUI2
 
         Eigen::Affine3d get_transform() const;
         void set_transform(const Eigen::Affine3d& transform);
+        Eigen::Affine3d get_world_transform() const; // 階層の更新 (描画前) 時点の値
         Eigen::Vector3d get_position() const;
         void set_position(const Eigen::Vector3d& position);
         Eigen::Matrix3d get_orientation() const;
@@ -24,6 +34,9 @@ namespace NEGUI2
         Eigen::Vector3d right() const;
         Eigen::Vector3d up() const;
 
+        Eigen::Matrix4f get_render_matrix() const;
+        void set_render_matrix(const Eigen::Matrix4f& matrix); // ThreeDが描画前にまとめて設定
+
     };
 }
 
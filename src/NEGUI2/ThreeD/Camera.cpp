@@ -44,12 +44,22 @@ namespace
 
     struct CameraData
     {
-        Eigen::Matrix4f transform;
+        Eigen::Matrix4f transform; // 平行移動を除いたビュー (モデル行列はカメラ原点からの相対)
         Eigen::Matrix4f projection;
         Eigen::Matrix4f view;
         Eigen::Vector2f resolution;
         uint32_t time_ms;
     };
+
+    /* shader/Mesh.frag, Pick.glsl のMouse (std140で16バイト) と同じ配置 */
+    struct MouseData
+    {
+        float width;
+        float height;
+        float x;
+        float y;
+    };
+    static_assert(sizeof(MouseData) == 16u, "MouseData must match the std140 Mouse block");
 }
 
 namespace NEGUI2
@@ -58,6 +68,8 @@ namespace NEGUI2
     Camera::Camera(const double &fovy, const double &aspect, const double &znear, const double &zfar)
         : projection_(Eigen::Matrix4d::Identity()), fovy_(fovy), aspect_(aspect), znear_(znear), zfar_(zfar),
           width_(1920.f), height_(1080.f), mouse_x_(0.f), mouse_y_(0.f),
+          uploaded_(false), uploaded_transform_(Eigen::Matrix4f::Zero()), uploaded_origin_(Eigen::Vector3d::Zero()),
+          uploaded_mouse_(Eigen::Vector4f::Zero()),
           BaseTransform::BaseTransform()
     {
         aspect_ = static_cast<double>(width_) / static_cast<double>(height_);
@@ -74,7 +86,7 @@ namespace NEGUI2
         auto &mm = core.mm;
         {
             mm.add_memory("camera", sizeof(CameraData), Memory::TYPE::UNIFORM);
-            mm.add_memory("mouse", 2 * sizeof(float), Memory::TYPE::UNIFORM);
+            mm.add_memory("mouse", sizeof(MouseData), Memory::TYPE::UNIFORM);
         }
 
         auto &gpu = core.gpu;
@@ -87,8 +99,8 @@ namespace NEGUI2
             buffer_infos[1].setBuffer(camera_memory.buffer).setOffset(0u).setRange(vk::WholeSize);
 
             std::array<vk::WriteDescriptorSet, 2> write_descriptor_sets;
-            write_descriptor_sets[0].setDstSet(*gpu.descriptor_set).setDstBinding(0u).setDstArrayElement(0).setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eUniformBuffer).setBufferInfo(buffer_infos[0]);
-            write_descriptor_sets[1].setDstSet(*gpu.descriptor_set).setDstBinding(1u).setDstArrayElement(0).setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eUniformBuffer).setBufferInfo(buffer_infos[1]);
+            write_descriptor_sets[0].setDstSet(gpu.descriptor_set).setDstBinding(0u).setDstArrayElement(0).setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eUniformBuffer).setBufferInfo(buffer_infos[0]);
+            write_descriptor_sets[1].setDstSet(gpu.descriptor_set).setDstBinding(1u).setDstArrayElement(0).setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eUniformBuffer).setBufferInfo(buffer_infos[1]);
 
             gpu.device.updateDescriptorSets(write_descriptor_sets, nullptr);
         }
@@ -114,28 +126,41 @@ namespace NEGUI2
         mouse_y_ = static_cast<float>(y);
     }
 
-    void Camera::upload()
+    void Camera::upload(const bool force)
     {
         auto &core = Core::get_instance();
         auto &mm = core.mm;
 
+        /* 原点から離れた座標でもfloatの桁落ちが出ないよう, 平行移動はモデル行列側でdoubleのまま差し引く */
+        Eigen::Affine3d rotation = transform_;
+        rotation.translation().setZero();
+        Eigen::Matrix4f transform = (projection_ * rotation.matrix().inverse()).cast<float>();
+        Eigen::Vector3d origin = this->origin();
+
+        /* 変化が無ければ書き込まない (再描画の要求にもならない) */
+        Eigen::Vector4f mouse(width_, height_, mouse_x_, mouse_y_);
+        if (uploaded_ && !force && transform == uploaded_transform_ && origin == uploaded_origin_ && mouse == uploaded_mouse_)
+            return;
+
+        uploaded_ = true;
+        uploaded_transform_ = transform;
+        uploaded_origin_ = origin;
+        uploaded_mouse_ = mouse;
+
         {
             CameraData camera_data;
-            auto memory = mm.get_memory("camera");
-            auto transform = projection_ * transform_.matrix().inverse();
-            camera_data.transform = transform.matrix().cast<float>();
+            camera_data.transform = transform;
             camera_data.projection = projection_.cast<float>();
             camera_data.view = transform_.matrix().cast<float>();
             camera_data.resolution = Eigen::Vector2f(width_, height_);
             camera_data.time_ms = ::timeSinceEpochMillisec();
 
-            std::memcpy(memory.alloc_info.pMappedData, &camera_data, sizeof(CameraData));
+            mm.write_memory("camera", &camera_data, sizeof(CameraData));
         }
 
         {
-            std::array<float, 4> buffer{width_, height_, mouse_x_, mouse_y_};
-            auto memory = mm.get_memory("mouse");
-            std::memcpy(memory.alloc_info.pMappedData, buffer.data(), sizeof(float) * buffer.size());
+            MouseData mouse_data{width_, height_, mouse_x_, mouse_y_};
+            mm.write_memory("mouse", &mouse_data, sizeof(MouseData));
         }
     }
 
@@ -157,6 +182,11 @@ namespace NEGUI2
         set_orientation(quat.matrix());
     }
 
+    Eigen::Vector3d Camera::origin() const
+    {
+        return transform_.translation();
+    }
+
     Eigen::Vector3d Camera::uv_to_near_xyz(const Eigen::Vector2d &uv) const
     {
         auto vec = Eigen::Vector4d(uv.x(), uv.y(), 0.0, 1.0);
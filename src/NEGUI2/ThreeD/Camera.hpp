@@ -20,6 +20,11 @@ namespace NEGUI2
         float mouse_x_;
         float mouse_y_;
 
+        /* 前回転送した内容 (変化が無ければ転送しない) */
+        bool uploaded_;
+        Eigen::Matrix4f uploaded_transform_;
+        Eigen::Vector3d uploaded_origin_;
+        Eigen::Vector4f uploaded_mouse_;
 
 
     public:
@@ -29,8 +34,9 @@ namespace NEGUI2
         void set_extent(const uint32_t& width, const uint32_t& height);
         void set_extent(const vk::Extent2D& extent);
         void set_mouse(const uint32_t& x, const uint32_t& y);
-        void upload();
+        void upload(const bool force = false); // forceで時刻のみの更新も転送
         void lookat(const Eigen::Vector3d& target, const Eigen::Vector3d& up = Eigen::Vector3d::UnitZ());
+        Eigen::Vector3d origin() const; // 描画の原点 (モデル行列はここからの相対で渡す)
         
         Eigen::Vector3d uv_to_near_xyz(const Eigen::Vector2d& uv) const;
         Eigen::Vector3d uv_to_far_xyz(const Eigen::Vector2d& uv) const;
@@ -22,7 +22,7 @@ namespace NEGUI2
     void Coordinate::init()
     {
         /* Init aabb */
-        box_ = Eigen::AlignedBox3d(Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(1.0, 1.0, 1.0));
+        set_box_(Eigen::AlignedBox3d(Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(1.0, 1.0, 1.0)));
 
         /* Init Vertex buffer */
         {
@@ -65,14 +65,14 @@ namespace NEGUI2
 
     void Coordinate::update(vk::raii::CommandBuffer &command)
     {
-        push_constant_.model = get_transform().matrix().cast<float>();
+        push_constant_.model = get_render_matrix();
 
         auto &core = Core::get_instance();
 
         command.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline_);
         auto vertex_buffer = core.mm.get_memory("CoordinateVertex");
         auto color_buffer = core.mm.get_memory("CoordinateColor");
-        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {*core.gpu.descriptor_set}, nullptr);
+        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {core.gpu.descriptor_set}, nullptr);
         command.bindVertexBuffers(0, {vertex_buffer.buffer, color_buffer.buffer}, {0, 0});
         command.pushConstants<PushConstant>(*pipeline_layout_, vk::ShaderStageFlagBits::eVertex, 0, push_constant_);
 
@@ -163,29 +163,33 @@ namespace NEGUI2
             .setOffset(0);
 
         vk::PipelineLayoutCreateInfo pipeline_layout;
-        pipeline_layout.setSetLayouts(*core.gpu.descriptor_set_layout)
+        pipeline_layout.setSetLayouts(core.gpu.descriptor_set_layout)
             .setPushConstantRanges(push_constant);
         // TODO push constnatの実装
 
         auto &device = core.gpu.device;
         pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
 
-        auto &render_pass = core.off_screen.render_pass;
+        /* ビューポートは動的解像度に合わせて毎フレーム設定 */
+        std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic_state;
+        dynamic_state.setDynamicStates(dynamic_states);
 
         vk::GraphicsPipelineCreateInfo pipeline_info;
         pipeline_info.setStages(shader_stages)
             .setPVertexInputState(&vertex_input_state)
             .setPInputAssemblyState(&input_assembly)
             .setPViewportState(&viewport_state)
+            .setPDynamicState(&dynamic_state)
             .setPRasterizationState(&rasterizer)
             .setPMultisampleState(&multisampling)
             .setPColorBlendState(&color_blending)
             .setLayout(*pipeline_layout_)
-            .setRenderPass(*render_pass)
             .setPDepthStencilState(&depth_stencil)
             .setSubpass(0)
             .setBasePipelineHandle(nullptr);
 
+        core.off_screen.set_render_target(pipeline_info);
         auto &pipeline_cache = core.gpu.pipeline_cache;
         pipeline_ = device.createGraphicsPipeline(pipeline_cache, pipeline_info);
     }
@@ -203,7 +207,7 @@ namespace NEGUI2
 
     double Coordinate::pick(const Eigen::Vector3d &origin, const Eigen::Vector3d &direction)
     {
-        const Eigen::Vector3d position = get_position();
+        const Eigen::Vector3d position = get_world_transform().translation();
         auto diff = position - origin;
         
         auto dot = diff.dot(direction);
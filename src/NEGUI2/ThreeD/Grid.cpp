@@ -31,12 +31,12 @@ namespace NEGUI2
 
     void Grid::update(vk::raii::CommandBuffer &command)
     {       
-        push_constant_.model = get_transform().matrix().cast<float>();
+        push_constant_.model = get_render_matrix();
         
         auto &core = Core::get_instance();
 
         command.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline_);
-        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {*core.gpu.descriptor_set}, nullptr);
+        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {core.gpu.descriptor_set}, nullptr);
         command.pushConstants<PushConstant>(*pipeline_layout_, vk::ShaderStageFlagBits::eVertex, 0, push_constant_);
         
         command.draw(6, 1, 0, 0);
@@ -110,7 +110,8 @@ namespace NEGUI2
                                .setSrcAlphaBlendFactor(vk::BlendFactor::eOne)
                                .setDstAlphaBlendFactor(vk::BlendFactor::eOne)
                                .setAlphaBlendOp(vk::BlendOp::eMax);
-        colorBlendAttachment[1].setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
+        /* ピック画像には書き込まない */
+        colorBlendAttachment[1].setColorWriteMask({})
                                .setBlendEnable(vk::False);
 
         std::array<float, 4> blend_constant{};
@@ -127,28 +128,32 @@ namespace NEGUI2
                      .setOffset(0);
 
         vk::PipelineLayoutCreateInfo pipeline_layout;
-        pipeline_layout.setSetLayouts(*core.gpu.descriptor_set_layout)
+        pipeline_layout.setSetLayouts(core.gpu.descriptor_set_layout)
                        .setPushConstantRanges(push_constant);
 
         auto &device = core.gpu.device;
         pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
 
-        auto &render_pass = core.off_screen.render_pass;
+        /* ビューポートは動的解像度に合わせて毎フレーム設定 */
+        std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic_state;
+        dynamic_state.setDynamicStates(dynamic_states);
 
         vk::GraphicsPipelineCreateInfo pipeline_info;
         pipeline_info.setStages(shader_stages)
             .setPVertexInputState(&vertex_input_state)
             .setPInputAssemblyState(&input_assembly)
             .setPViewportState(&viewport_state)
+            .setPDynamicState(&dynamic_state)
             .setPRasterizationState(&rasterizer)
             .setPMultisampleState(&multisampling)
             .setPColorBlendState(&color_blending)
             .setLayout(*pipeline_layout_)
-            .setRenderPass(*render_pass)
             .setPDepthStencilState(&depth_stencil)
             .setSubpass(0)
             .setBasePipelineHandle(nullptr);
 
+        core.off_screen.set_render_target(pipeline_info);
         auto &pipeline_cache = core.gpu.pipeline_cache;
         pipeline_ = device.createGraphicsPipeline(pipeline_cache, pipeline_info);
     }
@@ -2,11 +2,12 @@
 #define _LINE_HPP
 #include "NEGUI2/ThreeD/BaseDisplayObject.hpp"
 #include "NEGUI2/ThreeD/BaseTransform.hpp"
+#include "NEGUI2/ThreeD/BaseNearestPickable.hpp"
 #include <Eigen/Dense>
 
 namespace NEGUI2
 {
-    class Line : public BaseDisplayObject, BaseTransform
+    class Line : public BaseDisplayObject, public BaseTransform, public BaseNearestPickable
     {
     public:
         struct LineData
@@ -35,6 +36,8 @@ namespace NEGUI2
         void rebuild() override;
         int32_t get_type_id() override;
         int32_t get_instance_id() override;
+        uint32_t get_primitive_count() const override;
+        NearestSource nearest_source() override;
 
         bool add(const Eigen::Vector3f &start, const Eigen::Vector3f &end,
                  const Eigen::Vector4f &color = Eigen::Vector4f::UnitW(), const float &diameter = 0.25);
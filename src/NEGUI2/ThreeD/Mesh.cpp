@@ -8,6 +8,10 @@
 #include <assimp/postprocess.h>
 
 namespace {
+/* Mesh.glsl の MatcapBlock (layout(offset = 80)) と一致させる */
+constexpr uint32_t MATCAP_OFFSET = sizeof(NEGUI2::PushConstant);
+static_assert(MATCAP_OFFSET == 80u, "MatcapBlock offset mismatch");
+
 Eigen::Vector3f min(const std::vector<Eigen::Vector3f>& vectors)
 {
     float x = vectors[0].x();
@@ -50,7 +54,7 @@ namespace NEGUI2
     int32_t Mesh::instance_count_ = 0u;
     Mesh::Mesh()
         : BaseTransform(), pipeline_(nullptr), pipeline_layout_(nullptr),
-          vertex_data_(), normal_data_(), indices_(), color_data_()
+          vertex_data_(), normal_data_(), indices_(), color_data_(), matcap_()
     {
         Mesh::instance_count_++;
         push_constant_.class_id = get_type_id();
@@ -93,6 +97,12 @@ namespace NEGUI2
         init();
     }
 
+    void Mesh::set_matcap(const std::string& key)
+    {
+        matcap_ = key;
+        Core::get_instance().invalidate();
+    }
+
     void Mesh::init()
     {
         Eigen::Vector3f min = ::min(vertex_data_);
@@ -108,7 +118,7 @@ namespace NEGUI2
         /* Init aabb */
         min = min - center;
         max = max - center;
-        box_ = Eigen::AlignedBox3d(min.cast<double>(), max.cast<double>());
+        set_box_(Eigen::AlignedBox3d(min.cast<double>(), max.cast<double>()));
 
         /* Init Vertex buffer */
         {
@@ -153,7 +163,7 @@ namespace NEGUI2
 
     void Mesh::update(vk::raii::CommandBuffer &command)
     {
-        push_constant_.model = get_transform().matrix().cast<float>();
+        push_constant_.model = get_render_matrix();
 
         auto &core = Core::get_instance();
 
@@ -161,10 +171,27 @@ namespace NEGUI2
         auto vertex_buffer = core.mm.get_memory(fmt::format("MeshVertex{}", push_constant_.instance_id));
         auto normal_buffer = core.mm.get_memory(fmt::format("MeshNormal{}", push_constant_.instance_id));
         auto index_buffer = core.mm.get_memory(fmt::format("MeshIndex{}", push_constant_.instance_id));
-        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {*core.gpu.descriptor_set}, nullptr);
         command.bindVertexBuffers(0, {vertex_buffer.buffer, normal_buffer.buffer}, {0, 0});
         command.pushConstants<PushConstant>(*pipeline_layout_, vk::ShaderStageFlagBits::eVertex, 0, push_constant_);
 
+        if (core.gpu.descriptor_indexing_supported)
+        {
+            /* 読み込み中のマットキャップは陰影のみで描く */
+            uint32_t texture_index = TextureManager::INVALID_INDEX;
+            if (!matcap_.empty() && core.tm.is_ready(matcap_))
+            {
+                texture_index = core.tm.get(matcap_).index;
+                core.tm.touch(matcap_);
+            }
+            std::array<vk::DescriptorSet, 2> descriptor_sets{core.gpu.descriptor_set, *core.tm.bindless_set};
+            command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, DescriptorSetIndex::COMMON, descriptor_sets, nullptr);
+            command.pushConstants<uint32_t>(*pipeline_layout_, vk::ShaderStageFlagBits::eFragment, MATCAP_OFFSET, texture_index);
+        }
+        else
+        {
+            command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, DescriptorSetIndex::COMMON, {core.gpu.descriptor_set}, nullptr);
+        }
+
         command.bindIndexBuffer(index_buffer.buffer, 0, vk::IndexType::eUint32);
         command.drawIndexed(static_cast<uint32_t>(indices_.size()), 1, 0, 0, 0);
     }
@@ -184,7 +211,10 @@ namespace NEGUI2
 
         /* Fragmentシェーダ */
         {
-            shader_stages[1].setStage(vk::ShaderStageFlagBits::eFragment).setPName("main").setModule(shader.get("MESH.FRAG"));
+            const char *name = core.gpu.descriptor_indexing_supported
+                                   ? (core.gpu.primitive_id_supported ? "MESH_MATCAP.FRAG" : "MESH_MATCAP_NO_PRIMITIVE.FRAG")
+                                   : (core.gpu.primitive_id_supported ? "MESH.FRAG" : "MESH_NO_PRIMITIVE.FRAG");
+            shader_stages[1].setStage(vk::ShaderStageFlagBits::eFragment).setPName("main").setModule(shader.get(name));
         }
         std::array<vk::VertexInputBindingDescription, 2> binding_description;
         binding_description[0].binding = 0;
@@ -246,34 +276,49 @@ namespace NEGUI2
             .setAttachments(colorBlendAttachment)
             .setBlendConstants(blend_constant);
 
-        vk::PushConstantRange push_constant;
-        push_constant.setStageFlags(vk::ShaderStageFlagBits::eVertex)
+        std::array<vk::PushConstantRange, 2> push_constants;
+        push_constants[0].setStageFlags(vk::ShaderStageFlagBits::eVertex)
             .setSize(sizeof(PushConstant))
             .setOffset(0);
+        push_constants[1].setStageFlags(vk::ShaderStageFlagBits::eFragment)
+            .setSize(sizeof(uint32_t))
+            .setOffset(MATCAP_OFFSET);
+
+        /* マットキャップはバインドレス配列から引く */
+        std::vector<vk::DescriptorSetLayout> set_layouts{core.gpu.descriptor_set_layout};
+        if (core.gpu.descriptor_indexing_supported)
+        {
+            set_layouts.resize(DescriptorSetIndex::BINDLESS + 1u);
+            set_layouts[DescriptorSetIndex::BINDLESS] = *core.tm.bindless_layout;
+        }
 
         vk::PipelineLayoutCreateInfo pipeline_layout;
-        pipeline_layout.setSetLayouts(*core.gpu.descriptor_set_layout)
-            .setPushConstantRanges(push_constant);
+        pipeline_layout.setSetLayouts(set_layouts)
+            .setPushConstantRanges(push_constants);
 
         auto &device = core.gpu.device;
         pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
 
-        auto &render_pass = core.off_screen.render_pass;
+        /* ビューポートは動的解像度に合わせて毎フレーム設定 */
+        std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic_state;
+        dynamic_state.setDynamicStates(dynamic_states);
 
         vk::GraphicsPipelineCreateInfo pipeline_info;
         pipeline_info.setStages(shader_stages)
             .setPVertexInputState(&vertex_input_state)
             .setPInputAssemblyState(&input_assembly)
             .setPViewportState(&viewport_state)
+            .setPDynamicState(&dynamic_state)
             .setPRasterizationState(&rasterizer)
             .setPMultisampleState(&multisampling)
             .setPColorBlendState(&color_blending)
             .setLayout(*pipeline_layout_)
-            .setRenderPass(*render_pass)
             .setPDepthStencilState(&depth_stencil)
             .setSubpass(0)
             .setBasePipelineHandle(nullptr);
 
+        core.off_screen.set_render_target(pipeline_info);
         auto &pipeline_cache = core.gpu.pipeline_cache;
         pipeline_ = device.createGraphicsPipeline(pipeline_cache, pipeline_info);
     }
@@ -289,6 +334,11 @@ namespace NEGUI2
         return push_constant_.instance_id;
     }
 
+    uint32_t Mesh::get_primitive_count() const
+    {
+        return static_cast<uint32_t>(indices_.size() / 3u);
+    }
+
     double Mesh::pick(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction)
     {
         auto& three_d = Core::get_instance().three_d;
@@ -6,6 +6,7 @@
 #include <Eigen/Dense>
 #include <vector>
 #include <filesystem>
+#include <string>
 
 namespace NEGUI2
 {
@@ -22,18 +23,21 @@ namespace NEGUI2
         std::vector<Eigen::Vector3f> normal_data_;
         std::vector<uint32_t> indices_;
         std::vector<Eigen::Vector4f> color_data_;
+        std::string matcap_; // TextureManagerのキー
 
         public:
         Mesh();
         ~Mesh() override;
 
         void load(const std::filesystem::path& path);
+        void set_matcap(const std::string& key); // 空なら陰影のみ
         void init() override;
         void destroy() override;
         void update(vk::raii::CommandBuffer &command) override;
         void rebuild() override;
         int32_t get_type_id() override;
         int32_t get_instance_id() override;
+        uint32_t get_primitive_count() const override;
         double pick(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction) override;
     };
 
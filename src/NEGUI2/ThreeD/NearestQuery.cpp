@@ -0,0 +1,227 @@
+#include "NEGUI2/ThreeD/NearestQuery.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstring>
+
+namespace NEGUI2
+{
+    NearestQuery::NearestQuery()
+        : descriptor_set_layout_(nullptr), pipeline_layout_(nullptr), pipeline_(nullptr), slots_(), tolerance(8.0)
+    {
+    }
+
+    NearestQuery::~NearestQuery()
+    {
+    }
+
+    void NearestQuery::init()
+    {
+        auto &core = Core::get_instance();
+        auto &device = core.gpu.device;
+
+        /* binding 0: 頂点, 1: 部分結果, 2: 結果, 3: カメラ */
+        {
+            std::vector<vk::DescriptorSetLayoutBinding> bindings(4);
+            bindings[0] = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            bindings[1] = vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            bindings[2] = vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            bindings[3] = vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            descriptor_set_layout_ = core.gpu.descriptors.get_layout(bindings);
+        }
+
+        {
+            vk::PushConstantRange push_constant;
+            push_constant.setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                .setSize(sizeof(PushBlock))
+                .setOffset(0);
+
+            vk::PipelineLayoutCreateInfo pipeline_layout;
+            pipeline_layout.setSetLayouts(descriptor_set_layout_)
+                .setPushConstantRanges(push_constant);
+            pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
+        }
+
+        {
+            vk::PipelineShaderStageCreateInfo shader_stage;
+            shader_stage.setStage(vk::ShaderStageFlagBits::eCompute).setPName("main").setModule(core.shader.get("NEAREST.COMP"));
+
+            vk::ComputePipelineCreateInfo pipeline_info;
+            pipeline_info.setStage(shader_stage)
+                .setLayout(*pipeline_layout_);
+
+            auto &pipeline_cache = core.gpu.pipeline_cache;
+            pipeline_ = device.createComputePipeline(pipeline_cache, pipeline_info);
+        }
+    }
+
+    void NearestQuery::prepare_(Job &job, const uint32_t &slot, const size_t &index, const uint32_t &group_count)
+    {
+        auto &core = Core::get_instance();
+        auto &mm = core.mm;
+
+        /* このスロットの前回の読み出しは完了済みなので作り直してよい */
+        if (job.partial_capacity < group_count)
+        {
+            job.partial_capacity = group_count;
+            mm.add_memory(fmt::format("NearestPartials{}_{}", slot, index), sizeof(Candidate) * job.partial_capacity, Memory::TYPE::SSBO);
+        }
+
+        if (!job.result_allocated)
+        {
+            mm.add_memory(fmt::format("NearestResult{}_{}", slot, index), sizeof(Candidate), Memory::TYPE::SSBO);
+            mm.add_memory(fmt::format("NearestReadback{}_{}", slot, index), sizeof(Candidate), Memory::TYPE::READBACK);
+            job.result_allocated = true;
+        }
+    }
+
+    void NearestQuery::record(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot, const Eigen::Vector2d &uv,
+                              const entt::registry &registry)
+    {
+        if (slot >= slots_.size())
+        {
+            slots_.resize(slot + 1u);
+        }
+        auto &current = slots_[slot];
+        if (current.pending)
+            return;
+
+        auto &core = Core::get_instance();
+        auto &mm = core.mm;
+        auto extent = core.off_screen.get_render_extent();
+        float cursor_x = static_cast<float>((uv.x() + 1.0) / 2.0 * static_cast<double>(extent.width));
+        float cursor_y = static_cast<float>((uv.y() + 1.0) / 2.0 * static_cast<double>(extent.height));
+        auto camera_buffer = mm.get_memory("camera").buffer;
+
+        current.job_count = 0u;
+        current.origin = core.three_d.camera().origin();
+        for (auto [entity, nearest] : registry.view<const NearestComponent>().each())
+        {
+            const auto &target = nearest.target;
+            if (!nearest.object->is_enable())
+                continue;
+
+            auto source = target->nearest_source();
+            if (source.count == 0u)
+            {
+                target->set_nearest({false, 0u, 0.0, Eigen::Vector3d::Zero()});
+                continue;
+            }
+
+            size_t index = current.job_count++;
+            if (index >= current.jobs.size())
+            {
+                current.jobs.resize(index + 1u);
+            }
+            auto &job = current.jobs[index];
+            job.target = target;
+
+            uint32_t group_count = std::min((source.count + LOCAL_SIZE - 1u) / LOCAL_SIZE, MAX_GROUP_COUNT);
+            prepare_(job, slot, index, group_count);
+
+            auto partial_buffer = mm.get_memory(fmt::format("NearestPartials{}_{}", slot, index)).buffer;
+            auto result_buffer = mm.get_memory(fmt::format("NearestResult{}_{}", slot, index)).buffer;
+            auto readback_buffer = mm.get_memory(fmt::format("NearestReadback{}_{}", slot, index)).buffer;
+
+            /* 頂点バッファはデフラグで差し替わるため毎回フレーム用のセットに書く */
+            auto descriptor_set = core.gpu.descriptors.allocate_transient(descriptor_set_layout_);
+            {
+                std::array<vk::DescriptorBufferInfo, 4> buffer_infos;
+                buffer_infos[0].setBuffer(source.buffer).setOffset(0u).setRange(vk::WholeSize);
+                buffer_infos[1].setBuffer(partial_buffer).setOffset(0u).setRange(vk::WholeSize);
+                buffer_infos[2].setBuffer(result_buffer).setOffset(0u).setRange(vk::WholeSize);
+                buffer_infos[3].setBuffer(camera_buffer).setOffset(0u).setRange(vk::WholeSize);
+
+                std::array<vk::WriteDescriptorSet, 4> write_descriptor_sets;
+                for (uint32_t i = 0u; i < write_descriptor_sets.size(); i++)
+                {
+                    write_descriptor_sets[i].setDstSet(descriptor_set).setDstBinding(i).setDstArrayElement(0)
+                        .setDescriptorCount(1)
+                        .setDescriptorType(i == 3u ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer)
+                        .setBufferInfo(buffer_infos[i]);
+                }
+                core.gpu.device.updateDescriptorSets(write_descriptor_sets, nullptr);
+            }
+
+            PushBlock push_block;
+            push_block.model = source.model;
+            push_block.cursor[0] = cursor_x;
+            push_block.cursor[1] = cursor_y;
+            push_block.tolerance = static_cast<float>(tolerance);
+            push_block.count = source.count;
+            push_block.stride = source.stride;
+            push_block.first = source.first;
+            push_block.second = source.second;
+            push_block.mode = source.segment ? 1u : 0u;
+
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline_);
+            command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipeline_layout_, 0, {descriptor_set}, nullptr);
+
+            /* ワークグループ毎に最近傍を求め, 単一ワークグループで集約 */
+            command_buffer.pushConstants<PushBlock>(*pipeline_layout_, vk::ShaderStageFlagBits::eCompute, 0, push_block);
+            command_buffer.dispatch(group_count, 1u, 1u);
+
+            vk::BufferMemoryBarrier partial_barrier;
+            partial_barrier.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(partial_buffer).setOffset(0u).setSize(vk::WholeSize);
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+                                           {}, nullptr, partial_barrier, nullptr);
+
+            push_block.count = group_count;
+            push_block.mode = 2u;
+            command_buffer.pushConstants<PushBlock>(*pipeline_layout_, vk::ShaderStageFlagBits::eCompute, 0, push_block);
+            command_buffer.dispatch(1u, 1u, 1u);
+
+            vk::BufferMemoryBarrier before;
+            before.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(result_buffer).setOffset(0u).setSize(vk::WholeSize);
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                           {}, nullptr, before, nullptr);
+
+            vk::BufferCopy region{0u, 0u, sizeof(Candidate)};
+            command_buffer.copyBuffer(result_buffer, readback_buffer, region);
+
+            vk::BufferMemoryBarrier after;
+            after.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eHostRead)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(readback_buffer).setOffset(0u).setSize(vk::WholeSize);
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                           {}, nullptr, after, nullptr);
+        }
+
+        current.pending = current.job_count != 0u;
+    }
+
+    void NearestQuery::resolve(const uint32_t &slot)
+    {
+        /* スロットの提出完了待ち後に呼ぶこと */
+        if (slot >= slots_.size() || !slots_[slot].pending)
+            return;
+
+        auto &mm = Core::get_instance().mm;
+        auto &current = slots_[slot];
+        for (size_t i = 0u; i < current.job_count; i++)
+        {
+            auto &job = current.jobs[i];
+            auto readback_name = fmt::format("NearestReadback{}_{}", slot, i);
+            mm.invalidate_memory(readback_name);
+
+            Candidate candidate;
+            std::memcpy(&candidate, mm.get_memory(readback_name).alloc_info.pMappedData, sizeof(Candidate));
+
+            NearestResult result{candidate.hit != 0u, candidate.index, static_cast<double>(candidate.position[3]),
+                                 current.origin + Eigen::Vector3d(candidate.position[0], candidate.position[1], candidate.position[2])};
+            job.target->set_nearest(result);
+            job.target.reset();
+            spdlog::debug("Nearest {} index {} distance {}", result.hit, result.index, result.distance);
+        }
+        current.job_count = 0u;
+        current.pending = false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef _NEAREST_QUERY_HPP
+#define _NEAREST_QUERY_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <Eigen/Dense>
+#include <cinttypes>
+#include <memory>
+#include <vector>
+#include "NEGUI2/ThreeD/BaseDisplayObject.hpp"
+#include "NEGUI2/ThreeD/BaseNearestPickable.hpp"
+#include "NEGUI2/ThreeD/SceneComponent.hpp"
+#include <entt/entt.hpp>
+
+namespace NEGUI2
+{
+    /* カーソル近傍の点/線分をGPU上の並列リダクションで探す */
+    class NearestQuery
+    {
+    public:
+        static constexpr uint32_t LOCAL_SIZE = 256u;
+        static constexpr uint32_t MAX_GROUP_COUNT = 65535u;
+
+    private:
+        /* shader/Nearest.comp と同じ配置 */
+        struct Candidate
+        {
+            float position[4];
+            uint32_t index;
+            uint32_t hit;
+            uint32_t reserved[2];
+        };
+
+        struct PushBlock
+        {
+            Eigen::Matrix4f model;
+            float cursor[2];
+            float tolerance;
+            uint32_t count;
+            uint32_t stride;
+            uint32_t first;
+            uint32_t second;
+            uint32_t mode;
+        };
+
+        struct Job
+        {
+            std::shared_ptr<BaseNearestPickable> target;
+            size_t partial_capacity = 0u;
+            bool result_allocated = false;
+        };
+
+        struct Slot
+        {
+            bool pending = false;
+            size_t job_count = 0u;
+            std::vector<Job> jobs;
+            Eigen::Vector3d origin = Eigen::Vector3d::Zero(); // 記録時のカメラ原点 (結果は相対座標)
+        };
+
+        vk::DescriptorSetLayout descriptor_set_layout_; // DescriptorAllocatorが所有
+        vk::raii::PipelineLayout pipeline_layout_;
+        vk::raii::Pipeline pipeline_;
+        std::vector<Slot> slots_;
+
+        void prepare_(Job &job, const uint32_t &slot, const size_t &index, const uint32_t &group_count);
+
+    public:
+        NearestQuery();
+        ~NearestQuery();
+        void init();
+
+        double tolerance; // [pixel]
+
+        void record(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot, const Eigen::Vector2d &uv,
+                    const entt::registry &registry);
+        void resolve(const uint32_t &slot);
+    };
+}
+
+#endif
\ No newline at end of file
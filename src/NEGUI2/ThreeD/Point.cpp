@@ -13,7 +13,7 @@ namespace NEGUI2
 {
     int32_t Point::instance_count_ = 0u;
     Point::Point()
-        : BaseTransform(), pipeline_(nullptr), pipeline_layout_(nullptr), push_constant_(),
+        : BaseTransform(), BaseNearestPickable(), pipeline_(nullptr), pipeline_layout_(nullptr), push_constant_(),
           point_data_()
     {
         instance_count_++;
@@ -45,13 +45,13 @@ namespace NEGUI2
 
     void Point::update(vk::raii::CommandBuffer &command)
     {
-        push_constant_.model = get_transform().matrix().cast<float>();
+        push_constant_.model = get_render_matrix();
 
         auto &core = Core::get_instance();
         command.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline_);
         std::string memory_name = fmt::format("PointVertex{}", push_constant_.instance_id);
         auto vertex_buffer = core.mm.get_memory(memory_name);
-        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {*core.gpu.descriptor_set}, nullptr);
+        command.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipeline_layout_, 0, {core.gpu.descriptor_set}, nullptr);
         command.bindVertexBuffers(0, {vertex_buffer.buffer}, {0});
         command.pushConstants<PushConstant>(*pipeline_layout_, vk::ShaderStageFlagBits::eVertex, 0, push_constant_);
         command.draw(point_data_.size(), 1, 0, 0);
@@ -147,28 +147,32 @@ namespace NEGUI2
             .setOffset(0);
 
         vk::PipelineLayoutCreateInfo pipeline_layout;
-        pipeline_layout.setSetLayouts(*core.gpu.descriptor_set_layout)
+        pipeline_layout.setSetLayouts(core.gpu.descriptor_set_layout)
             .setPushConstantRanges(push_constant);
 
         auto &device = core.gpu.device;
         pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
 
-        auto &render_pass = core.off_screen.render_pass;
+        /* ビューポートは動的解像度に合わせて毎フレーム設定 */
+        std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic_state;
+        dynamic_state.setDynamicStates(dynamic_states);
 
         vk::GraphicsPipelineCreateInfo pipeline_info;
         pipeline_info.setStages(shader_stages)
             .setPVertexInputState(&vertex_input_state)
             .setPInputAssemblyState(&input_assembly)
             .setPViewportState(&viewport_state)
+            .setPDynamicState(&dynamic_state)
             .setPRasterizationState(&rasterizer)
             .setPMultisampleState(&multisampling)
             .setPColorBlendState(&color_blending)
             .setLayout(*pipeline_layout_)
-            .setRenderPass(*render_pass)
             .setPDepthStencilState(&depth_stencil)
             .setSubpass(0)
             .setBasePipelineHandle(nullptr);
 
+        core.off_screen.set_render_target(pipeline_info);
         auto &pipeline_cache = core.gpu.pipeline_cache;
         pipeline_ = device.createGraphicsPipeline(pipeline_cache, pipeline_info);
     }
@@ -184,11 +188,31 @@ namespace NEGUI2
         return push_constant_.instance_id;
     }
 
+    uint32_t Point::get_primitive_count() const
+    {
+        return static_cast<uint32_t>(point_data_.size());
+    }
+
+    NearestSource Point::nearest_source()
+    {
+        auto &core = Core::get_instance();
+        NearestSource source;
+        source.buffer = core.mm.get_memory(fmt::format("PointVertex{}", push_constant_.instance_id)).buffer;
+        source.count = static_cast<uint32_t>(point_data_.size());
+        source.stride = sizeof(PointData) / sizeof(float);
+        source.first = offsetof(PointData, position) / sizeof(float);
+        source.second = offsetof(PointData, position) / sizeof(float);
+        source.segment = false;
+        source.model = get_render_matrix();
+        return source;
+    }
+
     bool Point::add(const Eigen::Vector3f& position, const Eigen::Vector4f& color, const float& diameter)
     {
         if(point_data_.size() >= MAX_POINT) return false;
 
         point_data_.push_back({position, color, diameter});
+        extend_box_(position.cast<double>());
         auto &core = Core::get_instance();
         // TODO更新した部分だけアップ
         std::string memory_name = fmt::format("PointVertex{}", push_constant_.instance_id);
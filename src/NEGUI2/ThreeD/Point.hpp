@@ -2,11 +2,12 @@
 #define _Point_HPP
 #include "NEGUI2/ThreeD/BaseDisplayObject.hpp"
 #include "NEGUI2/ThreeD/BaseTransform.hpp"
+#include "NEGUI2/ThreeD/BaseNearestPickable.hpp"
 #include <Eigen/Dense>
 
 namespace NEGUI2
 {
-    class Point : public BaseDisplayObject, BaseTransform
+    class Point : public BaseDisplayObject, public BaseTransform, public BaseNearestPickable
     {
     public:
         struct PointData
@@ -34,6 +35,8 @@ namespace NEGUI2
         void rebuild() override;
         int32_t get_type_id() override;
         int32_t get_instance_id() override;
+        uint32_t get_primitive_count() const override;
+        NearestSource nearest_source() override;
 
         bool add(const Eigen::Vector3f &position, const Eigen::Vector4f &color = Eigen::Vector4f::UnitW(), const float &diameter = 2);
         bool popback();
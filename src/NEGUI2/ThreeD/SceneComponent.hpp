@@ -0,0 +1,53 @@
+#ifndef _SCENE_COMPONENT_HPP
+#define _SCENE_COMPONENT_HPP
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <Eigen/Geometry>
+
+namespace NEGUI2
+{
+    class BaseDisplayObject;
+    class BaseTransform;
+    class BasePickable;
+    class BaseNearestPickable;
+
+    /* ThreeDのレジストリに載せるコンポーネント. 型の判定は追加時に済ませ, 毎フレームはビューで詰まった配列を回す */
+    struct RenderComponent
+    {
+        std::shared_ptr<BaseDisplayObject> object; // pickでそのまま返せるよう所有する
+        const std::string *scope_name;             // プロファイラ用の型名
+        uint64_t order;                            // 追加順 (描画順)
+    };
+
+    /* シェーダへ渡すピックID. 生成後は変わらないので追加時に写す */
+    struct PickIdComponent
+    {
+        int32_t type;
+        int32_t instance;
+    };
+
+    struct TransformComponent
+    {
+        BaseTransform *transform;
+    };
+
+    struct BoundsComponent
+    {
+        Eigen::AlignedBox3d world_box; // 階層の更新後に写す. 変換を持たなければ空 (除外も表示もしない)
+        uint64_t order;
+    };
+
+    struct PickComponent
+    {
+        BasePickable *pickable; // 詳細判定とAABB表示の切り替えのみに使う
+    };
+
+    struct NearestComponent
+    {
+        std::shared_ptr<BaseNearestPickable> target; // 読み出し完了まで保持するため所有する
+        BaseDisplayObject *object;
+    };
+}
+
+#endif
\ No newline at end of file
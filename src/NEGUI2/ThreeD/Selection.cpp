@@ -0,0 +1,314 @@
+#include "NEGUI2/ThreeD/Selection.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include <spdlog/spdlog.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace NEGUI2
+{
+    Selection::Selection()
+        : descriptor_set_layout_(nullptr), pipeline_layout_(nullptr), pipeline_(nullptr), requests_(), slots_()
+    {
+    }
+
+    Selection::~Selection()
+    {
+    }
+
+    void Selection::init()
+    {
+        auto &core = Core::get_instance();
+        auto &device = core.gpu.device;
+
+        /* binding 0: ピック画像, 1: 対象一覧, 2: 投げ縄, 3: ビット集合 */
+        {
+            std::vector<vk::DescriptorSetLayoutBinding> bindings(4);
+            bindings[0] = vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute);
+            bindings[1] = vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            bindings[2] = vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            bindings[3] = vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute);
+            descriptor_set_layout_ = core.gpu.descriptors.get_layout(bindings);
+        }
+
+        {
+            vk::PushConstantRange push_constant;
+            push_constant.setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                .setSize(sizeof(PushBlock))
+                .setOffset(0);
+
+            vk::PipelineLayoutCreateInfo pipeline_layout;
+            pipeline_layout.setSetLayouts(descriptor_set_layout_)
+                .setPushConstantRanges(push_constant);
+            pipeline_layout_ = device.createPipelineLayout(pipeline_layout);
+        }
+
+        {
+            vk::PipelineShaderStageCreateInfo shader_stage;
+            shader_stage.setStage(vk::ShaderStageFlagBits::eCompute).setPName("main").setModule(core.shader.get("SELECTION.COMP"));
+
+            vk::ComputePipelineCreateInfo pipeline_info;
+            pipeline_info.setStage(shader_stage)
+                .setLayout(*pipeline_layout_);
+
+            auto &pipeline_cache = core.gpu.pipeline_cache;
+            pipeline_ = device.createComputePipeline(pipeline_cache, pipeline_info);
+        }
+    }
+
+    void Selection::select_rect(const Eigen::Vector2d &uv_min, const Eigen::Vector2d &uv_max, Callback callback)
+    {
+        requests_.push_back({uv_min.cwiseMin(uv_max), uv_min.cwiseMax(uv_max), {}, std::move(callback)});
+    }
+
+    void Selection::select_lasso(const std::vector<Eigen::Vector2d> &uv_polygon, Callback callback)
+    {
+        if (uv_polygon.size() < 3u)
+        {
+            spdlog::warn("Lasso selection needs at least 3 points.");
+            callback({});
+            return;
+        }
+
+        Eigen::Vector2d uv_min = Eigen::Vector2d::Constant(std::numeric_limits<double>::max());
+        Eigen::Vector2d uv_max = Eigen::Vector2d::Constant(std::numeric_limits<double>::lowest());
+        for (const auto &uv : uv_polygon)
+        {
+            uv_min = uv_min.cwiseMin(uv);
+            uv_max = uv_max.cwiseMax(uv);
+        }
+        requests_.push_back({uv_min, uv_max, uv_polygon, std::move(callback)});
+    }
+
+    bool Selection::is_pending() const
+    {
+        if (!requests_.empty())
+            return true;
+
+        return std::any_of(slots_.begin(), slots_.end(), [](const Slot &slot)
+                           { return slot.pending; });
+    }
+
+    void Selection::reserve_(Slot &slot, const uint32_t &index, const size_t &target_count, const size_t &lasso_count, const size_t &word_count)
+    {
+        auto &core = Core::get_instance();
+        auto &mm = core.mm;
+
+        /* このスロットの前回の読み出しは完了済みなので作り直してよい */
+        if (slot.target_capacity < target_count)
+        {
+            slot.target_capacity = std::max(target_count, slot.target_capacity * 2u);
+            mm.add_memory(fmt::format("SelectionTargets{}", index), sizeof(Target) * slot.target_capacity, Memory::TYPE::SSBO);
+        }
+
+        if (slot.lasso_capacity < std::max<size_t>(lasso_count, 1u))
+        {
+            slot.lasso_capacity = std::max({lasso_count, slot.lasso_capacity * 2u, size_t(1u)});
+            mm.add_memory(fmt::format("SelectionLasso{}", index), sizeof(Eigen::Vector2f) * slot.lasso_capacity, Memory::TYPE::SSBO);
+        }
+
+        if (slot.word_capacity < word_count)
+        {
+            slot.word_capacity = std::max(word_count, slot.word_capacity * 2u);
+            mm.add_memory(fmt::format("SelectionBits{}", index), sizeof(uint32_t) * slot.word_capacity, Memory::TYPE::SSBO);
+            mm.add_memory(fmt::format("SelectionReadback{}", index), sizeof(uint32_t) * slot.word_capacity, Memory::TYPE::READBACK);
+        }
+    }
+
+    void Selection::record(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot, const entt::registry &registry)
+    {
+        /* 1フレームに1要求ずつ処理 */
+        if (requests_.empty())
+            return;
+
+        if (slot >= slots_.size())
+        {
+            slots_.resize(slot + 1u);
+        }
+        auto &current = slots_[slot];
+        if (current.pending)
+            return;
+
+        auto request = std::move(requests_.front());
+        requests_.pop_front();
+
+        auto &core = Core::get_instance();
+        auto extent = core.off_screen.get_render_extent();
+        auto to_pixel = [&extent](const Eigen::Vector2d &uv)
+        {
+            return Eigen::Vector2d((uv.x() + 1.0) / 2.0 * static_cast<double>(extent.width),
+                                   (uv.y() + 1.0) / 2.0 * static_cast<double>(extent.height));
+        };
+
+        /* 読み出す範囲 [pixel] */
+        auto lower = to_pixel(request.uv_min);
+        auto upper = to_pixel(request.uv_max);
+        int32_t x0 = std::clamp(static_cast<int32_t>(std::floor(lower.x())), 0, static_cast<int32_t>(extent.width));
+        int32_t y0 = std::clamp(static_cast<int32_t>(std::floor(lower.y())), 0, static_cast<int32_t>(extent.height));
+        int32_t x1 = std::clamp(static_cast<int32_t>(std::ceil(upper.x())), 0, static_cast<int32_t>(extent.width));
+        int32_t y1 = std::clamp(static_cast<int32_t>(std::ceil(upper.y())), 0, static_cast<int32_t>(extent.height));
+
+        std::vector<Eigen::Vector2f> lasso;
+        lasso.reserve(request.lasso.size());
+        for (const auto &uv : request.lasso)
+        {
+            lasso.push_back(to_pixel(uv).cast<float>());
+        }
+
+        /* 対象毎のビット範囲 (32bit境界に揃えて語を共有しない) */
+        current.targets.clear();
+        uint32_t bit_count = 0u;
+        for (auto [entity, render, id] : registry.view<const RenderComponent, const PickIdComponent>().each())
+        {
+            auto &display_object = render.object;
+            if (!display_object->is_enable())
+                continue;
+
+            uint32_t count = std::max(display_object->get_primitive_count(), 1u);
+            current.targets.push_back({id.type, id.instance, bit_count, count});
+            bit_count += (count + 31u) & ~31u;
+        }
+        std::sort(current.targets.begin(), current.targets.end(), [](const Target &a, const Target &b)
+                  { return a.type < b.type || (a.type == b.type && a.instance < b.instance); });
+
+        current.pending = true;
+        current.callback = std::move(request.callback);
+        current.word_count = bit_count / 32u;
+        if (x1 <= x0 || y1 <= y0 || current.word_count == 0u)
+        {
+            /* 空の結果もresolveで返す */
+            current.word_count = 0u;
+            return;
+        }
+
+        reserve_(current, slot, current.targets.size(), lasso.size(), current.word_count);
+
+        auto &mm = core.mm;
+        auto targets_name = fmt::format("SelectionTargets{}", slot);
+        auto lasso_name = fmt::format("SelectionLasso{}", slot);
+        auto bits_name = fmt::format("SelectionBits{}", slot);
+        auto readback_name = fmt::format("SelectionReadback{}", slot);
+        mm.write_memory(targets_name, current.targets.data(), sizeof(Target) * current.targets.size());
+        if (!lasso.empty())
+        {
+            mm.write_memory(lasso_name, lasso.data(), sizeof(Eigen::Vector2f) * lasso.size());
+        }
+        auto bits_buffer = mm.get_memory(bits_name).buffer;
+        auto readback_buffer = mm.get_memory(readback_name).buffer;
+        vk::DeviceSize bits_size = sizeof(uint32_t) * current.word_count;
+
+        /* ピック画像は解像度変更で作り直されるため毎回フレーム用のセットに書く */
+        auto descriptor_set = core.gpu.descriptors.allocate_transient(descriptor_set_layout_);
+        {
+            vk::DescriptorImageInfo image_info;
+            image_info.setImageView(*core.off_screen.frame.pick_buffer_view).setImageLayout(vk::ImageLayout::eGeneral);
+
+            std::array<vk::DescriptorBufferInfo, 3> buffer_infos;
+            buffer_infos[0].setBuffer(mm.get_memory(targets_name).buffer).setOffset(0u).setRange(vk::WholeSize);
+            buffer_infos[1].setBuffer(mm.get_memory(lasso_name).buffer).setOffset(0u).setRange(vk::WholeSize);
+            buffer_infos[2].setBuffer(bits_buffer).setOffset(0u).setRange(vk::WholeSize);
+
+            std::array<vk::WriteDescriptorSet, 4> write_descriptor_sets;
+            write_descriptor_sets[0].setDstSet(descriptor_set).setDstBinding(0).setDstArrayElement(0)
+                .setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eStorageImage)
+                .setImageInfo(image_info);
+            for (uint32_t i = 0u; i < buffer_infos.size(); i++)
+            {
+                write_descriptor_sets[i + 1u].setDstSet(descriptor_set).setDstBinding(i + 1u).setDstArrayElement(0)
+                    .setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                    .setBufferInfo(buffer_infos[i]);
+            }
+            core.gpu.device.updateDescriptorSets(write_descriptor_sets, nullptr);
+        }
+
+        /* ピック画像のレイアウト遷移と描画完了待ちはRenderGraphのPickパスが行う */
+        {
+            command_buffer.fillBuffer(bits_buffer, 0u, bits_size, 0u);
+
+            vk::BufferMemoryBarrier buffer_barrier;
+            buffer_barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(bits_buffer).setOffset(0u).setSize(bits_size);
+
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                           vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, buffer_barrier, nullptr);
+        }
+
+        {
+            PushBlock push_block{{x0, y0}, {x1 - x0, y1 - y0}, static_cast<uint32_t>(current.targets.size()), static_cast<uint32_t>(lasso.size())};
+            command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline_);
+            command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *pipeline_layout_, 0, {descriptor_set}, nullptr);
+            command_buffer.pushConstants<PushBlock>(*pipeline_layout_, vk::ShaderStageFlagBits::eCompute, 0, push_block);
+            command_buffer.dispatch((push_block.size[0] + LOCAL_SIZE - 1u) / LOCAL_SIZE, (push_block.size[1] + LOCAL_SIZE - 1u) / LOCAL_SIZE, 1u);
+        }
+
+        /* ビット集合を読み出し用バッファへ */
+        {
+            vk::BufferMemoryBarrier before;
+            before.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(bits_buffer).setOffset(0u).setSize(bits_size);
+
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer,
+                                           {}, nullptr, before, nullptr);
+
+            vk::BufferCopy region{0u, 0u, bits_size};
+            command_buffer.copyBuffer(bits_buffer, readback_buffer, region);
+
+            vk::BufferMemoryBarrier after;
+            after.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+                .setDstAccessMask(vk::AccessFlagBits::eHostRead)
+                .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+                .setBuffer(readback_buffer).setOffset(0u).setSize(bits_size);
+            command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                           {}, nullptr, after, nullptr);
+        }
+    }
+
+    void Selection::resolve(const uint32_t &slot)
+    {
+        /* スロットの提出完了待ち後に呼ぶこと */
+        if (slot >= slots_.size() || !slots_[slot].pending)
+            return;
+
+        auto &current = slots_[slot];
+        std::vector<Id> ids;
+        if (current.word_count != 0u)
+        {
+            auto &mm = Core::get_instance().mm;
+            auto readback_name = fmt::format("SelectionReadback{}", slot);
+            mm.invalidate_memory(readback_name);
+            auto words = static_cast<const uint32_t *>(mm.get_memory(readback_name).alloc_info.pMappedData);
+
+            for (const auto &target : current.targets)
+            {
+                uint32_t begin = target.offset / 32u;
+                uint32_t end = (target.offset + target.count + 31u) / 32u;
+                for (uint32_t w = begin; w < end; w++)
+                {
+                    uint32_t word = words[w];
+                    for (uint32_t bit = 0u; word != 0u; bit++, word >>= 1u)
+                    {
+                        if (word & 1u)
+                        {
+                            ids.push_back({target.type, target.instance, w * 32u + bit - target.offset});
+                        }
+                    }
+                }
+            }
+        }
+
+        auto callback = std::move(current.callback);
+        current.callback = nullptr;
+        current.pending = false;
+        spdlog::debug("Selection {} ids", ids.size());
+        if (callback)
+        {
+            callback(ids);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef _SELECTION_HPP
+#define _SELECTION_HPP
+#include <vulkan/vulkan_raii.hpp>
+#include <Eigen/Dense>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <entt/entt.hpp>
+#include "NEGUI2/ThreeD/BaseDisplayObject.hpp"
+#include "NEGUI2/ThreeD/SceneComponent.hpp"
+
+namespace NEGUI2
+{
+    /* ピック画像の範囲読み出しによる矩形/投げ縄選択 */
+    class Selection
+    {
+    public:
+        struct Id
+        {
+            int32_t type;
+            int32_t instance;
+            uint32_t primitive; // プリミティブを持たないオブジェクトは0
+        };
+        using Callback = std::function<void(const std::vector<Id> &)>;
+
+        static constexpr uint32_t LOCAL_SIZE = 16u;
+
+    private:
+        struct Target
+        {
+            int32_t type;
+            int32_t instance;
+            uint32_t offset; // ビット集合内の先頭
+            uint32_t count;
+        };
+
+        struct PushBlock
+        {
+            int32_t origin[2];
+            int32_t size[2];
+            uint32_t target_count;
+            uint32_t lasso_count;
+        };
+
+        struct Request
+        {
+            Eigen::Vector2d uv_min;
+            Eigen::Vector2d uv_max;
+            std::vector<Eigen::Vector2d> lasso;
+            Callback callback;
+        };
+
+        struct Slot
+        {
+            bool pending = false;
+            std::vector<Target> targets;
+            size_t target_capacity = 0u;
+            size_t lasso_capacity = 0u;
+            size_t word_capacity = 0u;
+            uint32_t word_count = 0u;
+            Callback callback;
+        };
+
+        vk::DescriptorSetLayout descriptor_set_layout_; // DescriptorAllocatorが所有
+        vk::raii::PipelineLayout pipeline_layout_;
+        vk::raii::Pipeline pipeline_;
+        std::deque<Request> requests_;
+        std::vector<Slot> slots_;
+
+        void reserve_(Slot &slot, const uint32_t &index, const size_t &target_count, const size_t &lasso_count, const size_t &word_count);
+
+    public:
+        Selection();
+        ~Selection();
+        void init();
+
+        /* uvは[-1, 1]. 結果はGPUの読み出し完了後に届く */
+        void select_rect(const Eigen::Vector2d &uv_min, const Eigen::Vector2d &uv_max, Callback callback);
+        void select_lasso(const std::vector<Eigen::Vector2d> &uv_polygon, Callback callback);
+        bool is_pending() const;
+
+        void record(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot, const entt::registry &registry);
+        void resolve(const uint32_t &slot);
+    };
+}
+
+#endif
\ No newline at end of file
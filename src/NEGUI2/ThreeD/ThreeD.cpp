@@ -1,15 +1,52 @@
 #include "NEGUI2/ThreeD/ThreeD.hpp"
 #include "NEGUI2/ThreeD/BasePickable.hpp"
+#include "NEGUI2/ThreeD/BaseNearestPickable.hpp"
+#include "NEGUI2/ThreeD/BaseTransform.hpp"
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <tuple>
 #include "NEGUI2/Core/Core.hpp"
 #include <spdlog/spdlog.h>
+#include <fmt/format.h>
+
+namespace
+{
+    /* スラブ法. 始点が箱の中でも交差とみなす */
+    bool intersects(const Eigen::AlignedBox3d &box, const Eigen::Vector3d &origin, const Eigen::Vector3d &direction)
+    {
+        double t_min = 0.0;
+        double t_max = std::numeric_limits<double>::max();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (direction[axis] == 0.0)
+            {
+                if (origin[axis] < box.min()[axis] || box.max()[axis] < origin[axis])
+                    return false;
+                continue;
+            }
+
+            double t0 = (box.min()[axis] - origin[axis]) / direction[axis];
+            double t1 = (box.max()[axis] - origin[axis]) / direction[axis];
+            t_min = std::max(t_min, std::min(t0, t1));
+            t_max = std::min(t_max, std::max(t0, t1));
+            if (t_max < t_min)
+                return false;
+        }
+        return true;
+    }
+}
 
 namespace NEGUI2
 {
 
     ThreeD::ThreeD()
-        : display_objects_(), camera_()
+        : display_objects_(), camera_(), pick_data_(), pick_slots_(), pick_requests_(), selection_(), nearest_query_(), nearest_uv_(), scope_names_(),
+          hierarchy_(), transform_batch_(), registry_(), entities_(), next_order_(0u), reorder_(false)
     {
+        /* 追加済みのオブジェクトが動いた時だけ再描画する */
+        hierarchy_.set_changed_callback([]()
+                                        { Core::get_instance().invalidate(); });
     }
 
     ThreeD::~ThreeD()
@@ -20,11 +57,13 @@ namespace NEGUI2
     {
         camera_.init();
         aabb_.init();
+        selection_.init();
+        nearest_query_.init();
 
         auto &core = Core::get_instance();
         auto &mm = core.mm;
         {
-            mm.add_memory("pick_data", sizeof(PickData), Memory::TYPE::SSBO);
+            mm.add_memory("pick_data", PICK_BUFFER_SIZE, Memory::TYPE::SSBO);
         }
 
         auto &gpu = core.gpu;
@@ -34,7 +73,7 @@ namespace NEGUI2
             buffer_infos[0].setBuffer(mouse_memory.buffer).setOffset(0u).setRange(vk::WholeSize);
 
             std::array<vk::WriteDescriptorSet, 1> write_descriptor_sets;
-            write_descriptor_sets[0].setDstSet(*gpu.descriptor_set).setDstBinding(2).setDstArrayElement(0)
+            write_descriptor_sets[0].setDstSet(gpu.descriptor_set).setDstBinding(2).setDstArrayElement(0)
                                     .setDescriptorCount(1).setDescriptorType(vk::DescriptorType::eStorageBuffer)
                                     .setBufferInfo(buffer_infos[0]);
 
@@ -45,60 +84,168 @@ namespace NEGUI2
 
     void ThreeD::update(vk::raii::CommandBuffer &command_buffer)
     {
-        /* Clear Memory */
+        update_render_matrices_();
+        if (reorder_)
+            sort_();
+
+        /* Render objects */
+        auto &profiler = Core::get_instance().profiler;
+        for (auto [entity, render] : registry_.view<const RenderComponent>().each())
         {
-            auto &memory_manager = Core::get_instance().mm;
-            auto pick_mem = memory_manager.get_memory("pick_data");
-            std::memset(pick_mem.alloc_info.pMappedData, 0, sizeof(PickData));
+            if (!render.object->is_enable())
+                continue;
+
+            profiler.begin_scope(command_buffer, *render.scope_name);
+            render.object->update(command_buffer);
+            profiler.end_scope(command_buffer);
         }
 
-        /* Render objects */
-        for (auto display_object : display_objects_)
+        /* AABBはオブジェクトの後にまとめて描く. 表示の切り替えは実行中に変わるので対象の分だけ読む */
+        const Eigen::Vector3d origin = camera_.origin();
+        for (auto [entity, bounds] : registry_.view<const BoundsComponent>().each())
         {
-            display_object->update(command_buffer);
+            if (bounds.world_box.isEmpty() || !registry_.get<const PickComponent>(entity).pickable->display_aabb() ||
+                !registry_.get<const RenderComponent>(entity).object->is_enable())
+                continue;
 
-            auto pickable = std::dynamic_pointer_cast<BasePickable>(display_object);
-            if (pickable && pickable->display_aabb())
-            {
-                auto base_transfrom = std::dynamic_pointer_cast<BaseTransform>(display_object);
-                auto transform = base_transfrom->get_transform();
-                aabb_.set_transform(transform);
-                aabb_.set_box(pickable->box());
-                aabb_.render(command_buffer);
-            }
+            /* ワールドAABBをカメラ原点からの相対に直して描く (精度のため倍精度で引く) */
+            aabb_.set_render_matrix(Eigen::Matrix4f::Identity());
+            aabb_.set_box(Eigen::AlignedBox3d(bounds.world_box.min() - origin, bounds.world_box.max() - origin));
+            aabb_.render(command_buffer);
+        }
+    }
+
+    void ThreeD::sort_()
+    {
+        /* ビューは格納順に回るので追加順に並べ直す (削除は末尾との入れ替えで詰まるため) */
+        registry_.sort<RenderComponent>([](const RenderComponent &a, const RenderComponent &b)
+                                        { return a.order < b.order; });
+        registry_.sort<BoundsComponent>([](const BoundsComponent &a, const BoundsComponent &b)
+                                        { return a.order < b.order; });
+        reorder_ = false;
+    }
+
+    void ThreeD::update_render_matrices_()
+    {
+        /* 変更された部分木のワールド行列を更新し, 全オブジェクト分をまとめて相対化してから各オブジェクトへ戻す */
+        hierarchy_.update();
+        transform_batch_.clear();
+        for (size_t i = 0u; i < hierarchy_.size(); i++)
+        {
+            transform_batch_.add(hierarchy_.get_world(i));
+        }
+
+        transform_batch_.compute(camera_.origin());
+        for (size_t i = 0u; i < hierarchy_.size(); i++)
+        {
+            hierarchy_.get_owner(i)->set_render_matrix(transform_batch_.get(i));
+        }
+        update_bounds_();
+    }
+
+    void ThreeD::update_bounds_()
+    {
+        /* 毎フレーム回すループが階層を引かずに済むよう, ワールドAABBをコンポーネントへ写す */
+        for (auto [entity, transform, bounds] : registry_.view<const TransformComponent, BoundsComponent>().each())
+        {
+            bounds.world_box = hierarchy_.get_world_box(transform.transform);
         }
     }
 
+    const std::string &ThreeD::scope_name_(const BaseDisplayObject &display_object)
+    {
+        /* プロファイラ用の型名はキャッシュして毎フレームの文字列生成を避ける */
+        std::type_index type(typeid(display_object));
+        auto it = scope_names_.find(type);
+        if (it == scope_names_.end())
+        {
+            it = scope_names_.emplace(type, GpuProfiler::type_name(typeid(display_object))).first;
+        }
+        return it->second;
+    }
+
     std::shared_ptr<BaseDisplayObject> ThreeD::pick(const Eigen::Vector2d &uv)
-    {    
-        update_pick_data();
-        
+    {
+        /* 直近に読み出せたピックデータを使う (GPUは待たない) */
         auto origin = camera_.uv_to_near_xyz(uv);
         auto direction = camera_.uv_to_direction(uv);
 
         double min_dist = std::numeric_limits<double>::max();
-        std::shared_ptr<BasePickable> picked;
+        entt::entity picked = entt::null;
+        hierarchy_.update();
+        update_bounds_();
 
-        for (auto &object : display_objects_)
+        for (auto [entity, pick, bounds] : registry_.view<const PickComponent, const BoundsComponent>().each())
         {
-            auto pickable = std::dynamic_pointer_cast<BasePickable>(object);
-            if (pickable)
+            /* レイが外れるワールドAABBは詳細判定を省く */
+            if (!bounds.world_box.isEmpty() && !intersects(bounds.world_box, origin, direction))
+                continue;
+            if (!registry_.get<const RenderComponent>(entity).object->is_enable())
+                continue;
+
+            auto dist = pick.pickable->pick(origin, direction);
+            if (0 < dist && dist < min_dist)
             {
-                auto dist = pickable->pick(origin, direction);
-                if (0 < dist && dist < min_dist)
-                {
-                    picked = pickable;
-                    min_dist = dist;
-                }
+                picked = entity;
+                min_dist = dist;
             }
         }
 
-        return std::dynamic_pointer_cast<BaseDisplayObject>(picked);
+        if (picked == entt::null)
+            return nullptr;
+        return registry_.get<const RenderComponent>(picked).object;
     }
 
     void ThreeD::add(std::shared_ptr<BaseDisplayObject> display_object)
     {
+        auto object = display_object.get();
+        if (object == nullptr || entities_.count(object) != 0u)
+            return;
+
+        /* 型の判定は追加時の1回だけ. 以降はコンポーネントの有無で扱う */
+        auto entity = registry_.create();
+        auto order = next_order_++;
+        registry_.emplace<RenderComponent>(entity, RenderComponent{display_object, &scope_name_(*object), order});
+        registry_.emplace<PickIdComponent>(entity, PickIdComponent{object->get_type_id(), object->get_instance_id()});
+
+        auto base_transform = dynamic_cast<BaseTransform *>(object);
+        auto pickable = dynamic_cast<BasePickable *>(object);
+        if (base_transform != nullptr)
+        {
+            hierarchy_.add(base_transform, pickable);
+            registry_.emplace<TransformComponent>(entity, TransformComponent{base_transform});
+        }
+        if (pickable != nullptr)
+        {
+            registry_.emplace<BoundsComponent>(entity, BoundsComponent{Eigen::AlignedBox3d(), order});
+            registry_.emplace<PickComponent>(entity, PickComponent{pickable});
+        }
+        auto nearest = std::dynamic_pointer_cast<BaseNearestPickable>(display_object);
+        if (nearest)
+        {
+            registry_.emplace<NearestComponent>(entity, NearestComponent{nearest, object});
+        }
+
+        entities_.emplace(object, entity);
         display_objects_.push_back(display_object);
+        reorder_ = true;
+        Core::get_instance().invalidate();
+    }
+
+    void ThreeD::destroy_entity_(const BaseDisplayObject *display_object)
+    {
+        auto it = entities_.find(display_object);
+        if (it == entities_.end())
+            return;
+
+        auto transform = registry_.try_get<TransformComponent>(it->second);
+        if (transform != nullptr)
+        {
+            hierarchy_.remove(transform->transform);
+        }
+        registry_.destroy(it->second);
+        entities_.erase(it);
+        reorder_ = true;
     }
 
     std::optional<size_t> ThreeD::peek(std::shared_ptr<BaseDisplayObject> display_object)
@@ -124,7 +271,12 @@ namespace NEGUI2
     void ThreeD::erase(const size_t &index)
     {
         assert(index < display_objects_.size());
+        auto &core = Core::get_instance();
+        /* パイプライン等は提出済みのフレームが使い終わってから破棄 */
+        destroy_entity_(display_objects_[index].get());
+        core.mm.defer_release([display_object = display_objects_[index]]() {});
         display_objects_.erase(display_objects_.begin() + index);
+        core.invalidate();
     }
 
     void ThreeD::erase(std::shared_ptr<BaseDisplayObject> display_object)
@@ -134,11 +286,51 @@ namespace NEGUI2
                             { return x == display_object; });
         if (it != display_objects_.end())
         {
-            auto r = distance(it, display_objects_.end());
+            auto &core = Core::get_instance();
+            destroy_entity_(display_object.get());
+            core.mm.defer_release([display_object]() {});
             display_objects_.erase(it, display_objects_.end());
+            core.invalidate();
         }
     }
 
+    bool ThreeD::set_parent(std::shared_ptr<BaseDisplayObject> child, std::shared_ptr<BaseDisplayObject> parent)
+    {
+        auto transform_of = [this](const std::shared_ptr<BaseDisplayObject> &display_object) -> BaseTransform *
+        {
+            auto it = entities_.find(display_object.get());
+            if (it == entities_.end())
+                return nullptr;
+            auto transform = registry_.try_get<TransformComponent>(it->second);
+            return transform == nullptr ? nullptr : transform->transform;
+        };
+
+        auto child_transform = transform_of(child);
+        if (child_transform == nullptr)
+            return false;
+
+        auto parent_transform = parent ? transform_of(parent) : nullptr;
+        if (parent && parent_transform == nullptr)
+            return false;
+
+        if (!hierarchy_.set_parent(child_transform, parent_transform))
+            return false;
+
+        Core::get_instance().invalidate();
+        return true;
+    }
+
+    bool ThreeD::needs_render() const
+    {
+        return !pick_requests_.empty() || nearest_uv_.has_value() || selection_.is_pending();
+    }
+
+    bool ThreeD::is_busy() const
+    {
+        return needs_render() || std::any_of(pick_slots_.begin(), pick_slots_.end(), [](const PickSlot &slot)
+                                             { return slot.pending; });
+    }
+
     Camera &ThreeD::camera()
     {
         return camera_;
@@ -149,13 +341,163 @@ namespace NEGUI2
         return camera_;
     }
 
-    void ThreeD::update_pick_data()
+    Selection &ThreeD::selection()
+    {
+        return selection_;
+    }
+
+    NearestQuery &ThreeD::nearest_query()
+    {
+        return nearest_query_;
+    }
+
+    TransformHierarchy &ThreeD::hierarchy()
+    {
+        return hierarchy_;
+    }
+
+    const entt::registry &ThreeD::registry() const
+    {
+        return registry_;
+    }
+
+    void ThreeD::pick_async(const Eigen::Vector2d &uv, std::function<void(std::shared_ptr<BaseDisplayObject>)> callback)
+    {
+        /* 点/線分は同じフレームでGPUの最近傍探索も行う */
+        nearest_uv_ = uv;
+        request_pick_data([this, uv, callback](const PickData &)
+                          { callback(pick(uv)); });
+    }
+
+    void ThreeD::request_pick_data(PickCallback callback)
+    {
+        pick_requests_.push_back(std::move(callback));
+    }
+
+    void ThreeD::begin_pick(vk::raii::CommandBuffer &command_buffer)
     {
-        Core::get_instance().gpu.device.waitIdle();
         auto &memory_manager = Core::get_instance().mm;
-        auto pick_mem = memory_manager.get_memory("pick_data");
-        std::memcpy(&pick_data_, pick_mem.alloc_info.pMappedData, sizeof(PickData));
-         spdlog::info("{} {} {} {}", pick_data_.instance, pick_data_.type, pick_data_.vertex, pick_data_.depth);
+        auto pick_buffer = memory_manager.get_memory("pick_data").buffer;
+
+        /* 前フレームの書き込み/コピー完了後にヘッダのみクリア (候補は件数分だけ読む) */
+        vk::BufferMemoryBarrier before;
+        before.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferRead)
+            .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+            .setBuffer(pick_buffer).setOffset(0u).setSize(vk::WholeSize);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer,
+                                       vk::PipelineStageFlagBits::eTransfer, {}, nullptr, before, nullptr);
+
+        command_buffer.fillBuffer(pick_buffer, 0u, sizeof(PickHeader), 0u);
+
+        vk::BufferMemoryBarrier after;
+        after.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite)
+            .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+            .setBuffer(pick_buffer).setOffset(0u).setSize(vk::WholeSize);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                       {}, nullptr, after, nullptr);
+    }
+
+    void ThreeD::end_pick(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot)
+    {
+        auto &memory_manager = Core::get_instance().mm;
+        auto readback_name = fmt::format("PickReadback{}", slot);
+        if (slot >= pick_slots_.size())
+        {
+            pick_slots_.resize(slot + 1u, PickSlot{false, {}});
+        }
+        memory_manager.add_memory(readback_name, PICK_BUFFER_SIZE, Memory::TYPE::READBACK, false);
+
+        auto pick_buffer = memory_manager.get_memory("pick_data").buffer;
+        auto readback_buffer = memory_manager.get_memory(readback_name).buffer;
+
+        vk::BufferMemoryBarrier before;
+        before.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+            .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+            .setBuffer(pick_buffer).setOffset(0u).setSize(vk::WholeSize);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+                                       {}, nullptr, before, nullptr);
+
+        vk::BufferCopy region{0u, 0u, PICK_BUFFER_SIZE};
+        command_buffer.copyBuffer(pick_buffer, readback_buffer, region);
+
+        vk::BufferMemoryBarrier after;
+        after.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+            .setDstAccessMask(vk::AccessFlagBits::eHostRead)
+            .setSrcQueueFamilyIndex(vk::QueueFamilyIgnored).setDstQueueFamilyIndex(vk::QueueFamilyIgnored)
+            .setBuffer(readback_buffer).setOffset(0u).setSize(vk::WholeSize);
+        command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                       {}, nullptr, after, nullptr);
+
+        /* このフレームまでに来た要求はこのスロットの結果で応答 */
+        auto &pick_slot = pick_slots_[slot];
+        pick_slot.pending = true;
+        pick_slot.callbacks.insert(pick_slot.callbacks.end(),
+                                   std::make_move_iterator(pick_requests_.begin()), std::make_move_iterator(pick_requests_.end()));
+        pick_requests_.clear();
+
+        selection_.record(command_buffer, slot, registry_);
+        if (nearest_uv_)
+        {
+            nearest_query_.record(command_buffer, slot, *nearest_uv_, registry_);
+            nearest_uv_.reset();
+        }
+    }
+
+    void ThreeD::resolve_pick(const uint32_t &slot)
+    {
+        /* スロットの提出完了待ち後に呼ぶこと */
+        selection_.resolve(slot);
+        nearest_query_.resolve(slot);
+        if (slot >= pick_slots_.size() || !pick_slots_[slot].pending)
+            return;
+
+        auto &memory_manager = Core::get_instance().mm;
+        auto readback_name = fmt::format("PickReadback{}", slot);
+        memory_manager.invalidate_memory(readback_name);
+        auto &readback = memory_manager.get_memory(readback_name);
+        auto mapped = static_cast<const uint8_t *>(readback.alloc_info.pMappedData);
+
+        PickHeader header;
+        std::memcpy(&header, mapped, sizeof(PickHeader));
+        auto candidates = reinterpret_cast<const PickCandidate *>(mapped + sizeof(PickHeader));
+        uint32_t count = std::min(header.count, PICK_CANDIDATE_MAX);
+        if (header.count > PICK_CANDIDATE_MAX)
+        {
+            spdlog::debug("Pick candidates overflow {} / {}", header.count, PICK_CANDIDATE_MAX);
+        }
+
+        /* 最前面の候補のうち(type, instance, vertex)が最小のもの. 溢れて最前面が無ければ残りから最も手前 */
+        const PickCandidate *best = nullptr;
+        for (uint32_t i = 0u; i < count; i++)
+        {
+            const auto &candidate = candidates[i];
+            if (best == nullptr || candidate.depth > best->depth ||
+                (candidate.depth == best->depth &&
+                 std::tie(candidate.type, candidate.instance, candidate.vertex) < std::tie(best->type, best->instance, best->vertex)))
+            {
+                best = &candidate;
+            }
+        }
+
+        pick_data_ = PickData{0, 0, 0, 0.f};
+        if (best != nullptr)
+        {
+            float depth;
+            std::memcpy(&depth, &best->depth, sizeof(float));
+            pick_data_ = PickData{best->type, best->instance, best->vertex, depth};
+        }
+        spdlog::debug("Pick {} {} {} {}", pick_data_.instance, pick_data_.type, pick_data_.vertex, pick_data_.depth);
+
+        auto callbacks = std::move(pick_slots_[slot].callbacks);
+        pick_slots_[slot].callbacks.clear();
+        pick_slots_[slot].pending = false;
+        for (auto &callback : callbacks)
+        {
+            callback(pick_data_);
+        }
     }
 
     ThreeD::PickData ThreeD::get_pick_data() const
@@ -7,7 +7,17 @@
 #include "NEGUI2/ThreeD/BaseDisplayObject.hpp"
 #include "NEGUI2/ThreeD/Camera.hpp"
 #include "NEGUI2/ThreeD/AABB.hpp"
+#include "NEGUI2/ThreeD/Selection.hpp"
+#include "NEGUI2/ThreeD/NearestQuery.hpp"
+#include "NEGUI2/ThreeD/TransformBatch.hpp"
+#include "NEGUI2/ThreeD/TransformHierarchy.hpp"
+#include "NEGUI2/ThreeD/SceneComponent.hpp"
+#include <entt/entt.hpp>
 #include <optional>
+#include <functional>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
 
 namespace NEGUI2
 {
@@ -23,10 +33,55 @@ namespace NEGUI2
         };
 
     private:
+        /* shader/Pick.glsl のPickDataと同じ配置 */
+        struct PickHeader
+        {
+            uint32_t depth;
+            uint32_t count;
+            uint32_t reserved[2];
+        };
+        struct PickCandidate
+        {
+            int32_t type;
+            int32_t instance;
+            int32_t vertex;
+            uint32_t depth;
+        };
+        static constexpr uint32_t PICK_CANDIDATE_MAX = 4096u;
+        static constexpr size_t PICK_BUFFER_SIZE = sizeof(PickHeader) + sizeof(PickCandidate) * PICK_CANDIDATE_MAX;
+
         std::vector<std::shared_ptr<BaseDisplayObject>> display_objects_;
         Camera camera_;
         AABB aabb_;
         PickData pick_data_;
+
+        /* フレーム毎のピック結果読み出しスロット */
+        using PickCallback = std::function<void(const PickData &)>;
+        struct PickSlot
+        {
+            bool pending;
+            std::vector<PickCallback> callbacks;
+        };
+        std::vector<PickSlot> pick_slots_;
+        std::vector<PickCallback> pick_requests_;
+        Selection selection_;
+        NearestQuery nearest_query_;
+        std::optional<Eigen::Vector2d> nearest_uv_;
+        std::unordered_map<std::type_index, std::string> scope_names_;
+        TransformHierarchy hierarchy_;
+        TransformBatch transform_batch_;
+
+        /* 表示オブジェクトの所有はdisplay_objects_, 毎フレームの走査はレジストリのビューで行う */
+        entt::registry registry_;
+        std::unordered_map<const BaseDisplayObject *, entt::entity> entities_;
+        uint64_t next_order_;
+        bool reorder_; // 追加/削除でビューの並びが追加順から崩れた
+
+        const std::string &scope_name_(const BaseDisplayObject &display_object);
+        void update_render_matrices_();
+        void update_bounds_();
+        void sort_();
+        void destroy_entity_(const BaseDisplayObject *display_object);
     public:
         ThreeD();
         ~ThreeD();
@@ -35,6 +90,14 @@ namespace NEGUI2
 
         void update(vk::raii::CommandBuffer &command_buffer);
         std::shared_ptr<BaseDisplayObject> pick(const Eigen::Vector2d &uv);
+        void pick_async(const Eigen::Vector2d &uv, std::function<void(std::shared_ptr<BaseDisplayObject>)> callback);
+        void request_pick_data(PickCallback callback);
+
+        void begin_pick(vk::raii::CommandBuffer &command_buffer);
+        void end_pick(vk::raii::CommandBuffer &command_buffer, const uint32_t &slot);
+        void resolve_pick(const uint32_t &slot);
+        bool needs_render() const; // ピック/選択の要求があり描画が必要か
+        bool is_busy() const;      // GPUの読み出し待ちを含む
 
         void add(std::shared_ptr<BaseDisplayObject> display_object);
         std::optional<size_t> peek(std::shared_ptr<BaseDisplayObject> display_object);
@@ -42,10 +105,14 @@ namespace NEGUI2
 
         void erase(const size_t &index);
         void erase(std::shared_ptr<BaseDisplayObject> display_object);
+        bool set_parent(std::shared_ptr<BaseDisplayObject> child, std::shared_ptr<BaseDisplayObject> parent); // 両方追加済みであること
 
         Camera &camera();
         const Camera &camera() const;
-        void update_pick_data();
+        Selection &selection();
+        NearestQuery &nearest_query();
+        TransformHierarchy &hierarchy();
+        const entt::registry &registry() const;
         PickData get_pick_data() const;
     };
 }
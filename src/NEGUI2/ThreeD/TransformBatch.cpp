@@ -0,0 +1,89 @@
+#include "NEGUI2/ThreeD/TransformBatch.hpp"
+
+namespace NEGUI2
+{
+    TransformBatch::TransformBatch()
+        : sources_(), results_()
+    {
+    }
+
+    TransformBatch::~TransformBatch()
+    {
+    }
+
+    void TransformBatch::clear()
+    {
+        /* 容量は残して毎フレーム詰め直す */
+        for (auto &source : sources_)
+            source.clear();
+    }
+
+    size_t TransformBatch::add(const Eigen::Affine3d &transform)
+    {
+        const auto &matrix = transform.matrix();
+        for (size_t column = 0u; column < 3u; column++)
+        {
+            for (size_t row = 0u; row < 3u; row++)
+            {
+                sources_[column * 3u + row].push_back(matrix(row, column));
+            }
+        }
+        for (size_t row = 0u; row < 3u; row++)
+        {
+            sources_[LINEAR + row].push_back(matrix(row, 3));
+        }
+        return sources_[0].size() - 1u;
+    }
+
+    void TransformBatch::compute(const Eigen::Vector3d &origin)
+    {
+        const size_t count = size();
+        for (auto &result : results_)
+            result.resize(count);
+
+        /* 回転/拡大はそのまま */
+        for (size_t component = 0u; component < LINEAR; component++)
+        {
+            const double *source = sources_[component].data();
+            float *result = results_[component].data();
+            for (size_t i = 0u; i < count; i++)
+            {
+                result[i] = static_cast<float>(source[i]);
+            }
+        }
+
+        /* 大きな座標同士の差を先に取るので, 原点付近の桁だけがfloatに残る */
+        for (size_t axis = 0u; axis < 3u; axis++)
+        {
+            const double *source = sources_[LINEAR + axis].data();
+            float *result = results_[LINEAR + axis].data();
+            const double offset = origin[axis];
+            for (size_t i = 0u; i < count; i++)
+            {
+                result[i] = static_cast<float>(source[i] - offset);
+            }
+        }
+    }
+
+    Eigen::Matrix4f TransformBatch::get(const size_t &index) const
+    {
+        Eigen::Matrix4f matrix = Eigen::Matrix4f::Identity();
+        for (size_t column = 0u; column < 3u; column++)
+        {
+            for (size_t row = 0u; row < 3u; row++)
+            {
+                matrix(row, column) = results_[column * 3u + row][index];
+            }
+        }
+        for (size_t row = 0u; row < 3u; row++)
+        {
+            matrix(row, 3) = results_[LINEAR + row][index];
+        }
+        return matrix;
+    }
+
+    size_t TransformBatch::size() const
+    {
+        return sources_[0].size();
+    }
+}
\ No newline at end of file
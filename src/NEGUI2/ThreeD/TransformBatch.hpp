@@ -0,0 +1,31 @@
+#ifndef _TRANSFORM_BATCH_HPP
+#define _TRANSFORM_BATCH_HPP
+#include <Eigen/Dense>
+#include <array>
+#include <vector>
+
+namespace NEGUI2
+{
+    /* 全オブジェクトのモデル行列をカメラ原点からの相対に直してfloatへ落とす.
+       要素毎の配列 (SoA) に並べ, 各ループが連続領域の単純な演算になるようにする */
+    class TransformBatch
+    {
+        static constexpr size_t LINEAR = 9u;       // 3x3 (列優先)
+        static constexpr size_t COMPONENTS = 12u;  // 3x3 + 平行移動
+
+        std::array<std::vector<double>, COMPONENTS> sources_;
+        std::array<std::vector<float>, COMPONENTS> results_;
+
+    public:
+        TransformBatch();
+        ~TransformBatch();
+
+        void clear();
+        size_t add(const Eigen::Affine3d &transform);
+        void compute(const Eigen::Vector3d &origin); // 平行移動の差はdoubleで取る
+        Eigen::Matrix4f get(const size_t &index) const;
+        size_t size() const;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "NEGUI2/ThreeD/TransformHierarchy.hpp"
+#include "NEGUI2/ThreeD/BaseTransform.hpp"
+#include "NEGUI2/ThreeD/BasePickable.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace NEGUI2
+{
+    TransformHierarchy::TransformHierarchy()
+        : parents_(), depths_(), locals_(), worlds_(), world_boxes_(), dirty_(), owners_(), pickables_(),
+          reorder_(false), changed_(), last_updated_(0u)
+    {
+    }
+
+    TransformHierarchy::~TransformHierarchy()
+    {
+        /* 後から破棄されるオブジェクトが参照しないよう切り離す */
+        for (auto owner : owners_)
+        {
+            owner->hierarchy_ = nullptr;
+            owner->node_ = NONE;
+        }
+    }
+
+    void TransformHierarchy::set_changed_callback(std::function<void()> callback)
+    {
+        changed_ = std::move(callback);
+    }
+
+    void TransformHierarchy::add(BaseTransform *owner, BasePickable *pickable)
+    {
+        if (owner->hierarchy_ != nullptr)
+            return;
+
+        /* 根として末尾に追加 (親が前にある条件は崩れない) */
+        owner->hierarchy_ = this;
+        owner->node_ = static_cast<Node>(owners_.size());
+        parents_.push_back(NONE);
+        depths_.push_back(0u);
+        locals_.push_back(owner->transform_);
+        worlds_.push_back(owner->transform_);
+        world_boxes_.emplace_back();
+        dirty_.push_back(1u);
+        owners_.push_back(owner);
+        pickables_.push_back(pickable);
+    }
+
+    void TransformHierarchy::remove(BaseTransform *owner)
+    {
+        if (owner->hierarchy_ != this)
+            return;
+
+        auto node = owner->node_;
+        for (Node i = 0u; i < parents_.size(); i++)
+        {
+            if (parents_[i] != node)
+                continue;
+
+            /* 子はワールド位置を保って根になる */
+            parents_[i] = NONE;
+            owners_[i]->transform_ = worlds_[i];
+            locals_[i] = worlds_[i];
+            dirty_[i] = 1u;
+            reorder_ = true;
+        }
+        erase_(node);
+        owner->hierarchy_ = nullptr;
+        owner->node_ = NONE;
+        owner->world_ = owner->transform_;
+    }
+
+    void TransformHierarchy::erase_(const Node &node)
+    {
+        parents_.erase(parents_.begin() + node);
+        depths_.erase(depths_.begin() + node);
+        locals_.erase(locals_.begin() + node);
+        worlds_.erase(worlds_.begin() + node);
+        world_boxes_.erase(world_boxes_.begin() + node);
+        dirty_.erase(dirty_.begin() + node);
+        owners_.erase(owners_.begin() + node);
+        pickables_.erase(pickables_.begin() + node);
+
+        /* 詰めた分の番号を振り直す (前後関係は変わらない) */
+        for (Node i = 0u; i < parents_.size(); i++)
+        {
+            if (parents_[i] != NONE && parents_[i] > node)
+                parents_[i]--;
+            owners_[i]->node_ = i;
+        }
+    }
+
+    bool TransformHierarchy::set_parent(BaseTransform *child, BaseTransform *parent)
+    {
+        if (child->hierarchy_ != this || (parent != nullptr && parent->hierarchy_ != this))
+            return false;
+
+        auto node = child->node_;
+        auto parent_node = parent == nullptr ? NONE : parent->node_;
+        for (auto ancestor = parent_node; ancestor != NONE; ancestor = parents_[ancestor])
+        {
+            if (ancestor == node)
+                return false;
+        }
+
+        parents_[node] = parent_node;
+        dirty_[node] = 1u;
+        reorder_ = true;
+        if (changed_)
+            changed_();
+        return true;
+    }
+
+    BaseTransform *TransformHierarchy::get_parent(const BaseTransform *child) const
+    {
+        if (child->hierarchy_ != this || parents_[child->node_] == NONE)
+            return nullptr;
+        return owners_[parents_[child->node_]];
+    }
+
+    void TransformHierarchy::set_local(const Node &node, const Eigen::Affine3d &local)
+    {
+        locals_[node] = local;
+        dirty_[node] = 1u;
+        if (changed_)
+            changed_();
+    }
+
+    void TransformHierarchy::sort_()
+    {
+        /* 深さを求めて安定ソート. 深さが小さい順なら親は必ず前に来る */
+        const size_t count = owners_.size();
+        for (size_t i = 0u; i < count; i++)
+        {
+            uint32_t depth = 0u;
+            for (auto ancestor = parents_[i]; ancestor != NONE; ancestor = parents_[ancestor])
+                depth++;
+            depths_[i] = depth;
+        }
+
+        std::vector<Node> order(count);
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [this](const Node &a, const Node &b)
+                         { return depths_[a] < depths_[b]; });
+
+        std::vector<Node> remap(count);
+        for (Node i = 0u; i < count; i++)
+            remap[order[i]] = i;
+
+        auto permute = [&order](auto &values)
+        {
+            auto sorted = values;
+            for (size_t i = 0u; i < order.size(); i++)
+                sorted[i] = values[order[i]];
+            values.swap(sorted);
+        };
+        permute(parents_);
+        permute(depths_);
+        permute(locals_);
+        permute(worlds_);
+        permute(world_boxes_);
+        permute(dirty_);
+        permute(owners_);
+        permute(pickables_);
+
+        for (Node i = 0u; i < count; i++)
+        {
+            if (parents_[i] != NONE)
+                parents_[i] = remap[parents_[i]];
+            owners_[i]->node_ = i;
+        }
+        reorder_ = false;
+    }
+
+    size_t TransformHierarchy::update()
+    {
+        if (reorder_)
+            sort_();
+
+        /* 親が計算し直されていれば子も計算し直す (親は前にあるので1回の走査で伝播する) */
+        size_t updated = 0u;
+        const size_t count = owners_.size();
+        for (size_t i = 0u; i < count; i++)
+        {
+            auto parent = parents_[i];
+            if (parent != NONE && dirty_[parent] != 0u)
+                dirty_[i] = 1u;
+
+            auto pickable = pickables_[i];
+            bool box_changed = pickable != nullptr && pickable->box_changed_;
+            if (dirty_[i] == 0u && !box_changed)
+                continue;
+
+            if (dirty_[i] != 0u)
+            {
+                worlds_[i] = parent == NONE ? locals_[i] : worlds_[parent] * locals_[i];
+                owners_[i]->world_ = worlds_[i];
+                updated++;
+            }
+
+            /* ワールド座標のAABBは8頂点を変換して取り直す */
+            if (pickable != nullptr)
+            {
+                pickable->box_changed_ = false;
+                const auto box = pickable->box();
+                auto &world_box = world_boxes_[i];
+                world_box.setEmpty();
+                if (!box.isEmpty())
+                {
+                    for (int corner = 0; corner < 8; corner++)
+                        world_box.extend(worlds_[i] * box.corner(static_cast<Eigen::AlignedBox3d::CornerType>(corner)));
+                }
+            }
+        }
+
+        std::fill(dirty_.begin(), dirty_.end(), 0u);
+        last_updated_ = updated;
+        return updated;
+    }
+
+    size_t TransformHierarchy::size() const
+    {
+        return owners_.size();
+    }
+
+    size_t TransformHierarchy::get_last_updated() const
+    {
+        return last_updated_;
+    }
+
+    const Eigen::Affine3d &TransformHierarchy::get_world(const size_t &index) const
+    {
+        return worlds_[index];
+    }
+
+    BaseTransform *TransformHierarchy::get_owner(const size_t &index) const
+    {
+        return owners_[index];
+    }
+
+    Eigen::AlignedBox3d TransformHierarchy::get_world_box(const BaseTransform *owner) const
+    {
+        if (owner->hierarchy_ != this)
+            return Eigen::AlignedBox3d();
+        return world_boxes_[owner->node_];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef _TRANSFORM_HIERARCHY_HPP
+#define _TRANSFORM_HIERARCHY_HPP
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+#include <cinttypes>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace NEGUI2
+{
+    class BaseTransform;
+    class BasePickable;
+
+    /* 親子関係を持つ変換. 親が必ず子より前に来るよう深さ順に並べ,
+       変更されたノードとその子孫だけワールド行列とAABBを計算し直す */
+    class TransformHierarchy
+    {
+    public:
+        using Node = uint32_t;
+        static constexpr Node NONE = std::numeric_limits<Node>::max();
+
+    private:
+        std::vector<Node> parents_;
+        std::vector<uint32_t> depths_;
+        std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> locals_;
+        std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d>> worlds_;
+        std::vector<Eigen::AlignedBox3d, Eigen::aligned_allocator<Eigen::AlignedBox3d>> world_boxes_;
+        std::vector<uint8_t> dirty_;
+        std::vector<BaseTransform *> owners_;
+        std::vector<BasePickable *> pickables_; // AABBを持たなければnullptr
+        bool reorder_;                          // 親子関係が変わり並べ直しが必要
+        std::function<void()> changed_;         // 変換や親子関係が変わった (再描画の要求に使う)
+        size_t last_updated_;
+
+        void sort_();
+        void erase_(const Node &node);
+
+    public:
+        TransformHierarchy();
+        ~TransformHierarchy();
+
+        void set_changed_callback(std::function<void()> callback);
+        void add(BaseTransform *owner, BasePickable *pickable = nullptr);
+        void remove(BaseTransform *owner); // 子はワールド位置を保ったまま親から外れる
+        /* 子の変換は親からの相対として扱う. parentがnullptrなら親から外す. 循環は拒否 */
+        bool set_parent(BaseTransform *child, BaseTransform *parent);
+        BaseTransform *get_parent(const BaseTransform *child) const;
+        void set_local(const Node &node, const Eigen::Affine3d &local);
+
+        size_t update(); // 計算し直したノード数を返す
+        size_t size() const;
+        size_t get_last_updated() const;
+        const Eigen::Affine3d &get_world(const size_t &index) const;
+        BaseTransform *get_owner(const size_t &index) const;
+        Eigen::AlignedBox3d get_world_box(const BaseTransform *owner) const; // AABBが無ければ空
+    };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "NEGUI2/Ui/MemoryPanel.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include <imgui.h>
+#include <cstdio>
+
+namespace
+{
+    constexpr double MIB = 1024.0 * 1024.0;
+    constexpr const char *STATISTICS_PATH = "./memory_statistics.json";
+}
+
+namespace NEGUI2
+{
+    MemoryPanel::MemoryPanel()
+        : IUserInterface::IUserInterface()
+    {
+        is_active_ = false;
+    }
+
+    MemoryPanel::~MemoryPanel()
+    {
+    }
+
+    void MemoryPanel::update()
+    {
+        if (!is_active_)
+            return;
+
+        auto &mm = Core::get_instance().mm;
+        if (!ImGui::Begin("GPU Memory", &is_active_))
+        {
+            ImGui::End();
+            return;
+        }
+
+        if (!Core::get_instance().gpu.memory_budget_supported)
+        {
+            ImGui::TextDisabled("VK_EXT_memory_budget not supported. Budgets are estimated.");
+        }
+
+        /* ヒープ毎の予算 */
+        auto budgets = mm.get_budgets();
+        for (size_t i = 0; i < budgets.size(); i++)
+        {
+            const auto &budget = budgets[i];
+            if (budget.budget == 0u)
+                continue;
+
+            float ratio = static_cast<float>(static_cast<double>(budget.usage) / static_cast<double>(budget.budget));
+            char overlay[64];
+            std::snprintf(overlay, sizeof(overlay), "%.1f / %.1f MiB", budget.usage / MIB, budget.budget / MIB);
+            ImGui::Text("Heap %zu", i);
+            ImGui::SameLine();
+            ImGui::ProgressBar(ratio, ImVec2(-1.f, 0.f), overlay);
+        }
+
+        /* 種類毎の使用量 */
+        if (ImGui::BeginTable("Categories", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Category");
+            ImGui::TableSetupColumn("Size [MiB]");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < MemoryManager::CATEGORY_COUNT; i++)
+            {
+                auto category = static_cast<MemoryManager::CATEGORY>(i);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(MemoryManager::category_name(category));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", mm.get_category_bytes(category) / MIB);
+            }
+            ImGui::EndTable();
+        }
+
+        float high = static_cast<float>(mm.high_watermark);
+        float low = static_cast<float>(mm.low_watermark);
+        if (ImGui::DragFloatRange2("Watermark", &low, &high, 0.01f, 0.1f, 1.f))
+        {
+            mm.low_watermark = low;
+            mm.high_watermark = high;
+        }
+
+        /* デフラグ */
+        ImGui::Checkbox("Auto Defragmentation", &mm.defragmentation);
+        ImGui::SameLine();
+        ImGui::BeginDisabled(mm.is_defragmenting());
+        if (ImGui::Button("Defragment Now"))
+        {
+            mm.request_defragmentation();
+        }
+        ImGui::EndDisabled();
+        const auto &stats = mm.last_defragmentation_stats;
+        ImGui::Text("Last: %u moved (%.2f MiB), %.2f MiB freed (%u blocks)",
+                    stats.allocationsMoved, stats.bytesMoved / MIB, stats.bytesFreed / MIB, stats.deviceMemoryBlocksFreed);
+
+        if (ImGui::Button("Dump JSON"))
+        {
+            mm.write_statistics(STATISTICS_PATH);
+        }
+        ImGui::SameLine();
+        ImGui::TextDisabled("%s", STATISTICS_PATH);
+
+        ImGui::End();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef _MEMORY_PANEL_HPP
+#define _MEMORY_PANEL_HPP
+#include "NEGUI2/Ui/IUserInterface.hpp"
+
+namespace NEGUI2
+{
+    class MemoryPanel : public IUserInterface
+    {
+    public:
+        MemoryPanel();
+        virtual ~MemoryPanel() override;
+        virtual void update() override;
+    };
+
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "NEGUI2/Ui/ProfilerPanel.hpp"
+#include "NEGUI2/Core/Core.hpp"
+#include <imgui.h>
+#include <implot.h>
+
+namespace NEGUI2
+{
+    ProfilerPanel::ProfilerPanel()
+        : IUserInterface::IUserInterface()
+    {
+        is_active_ = false;
+    }
+
+    ProfilerPanel::~ProfilerPanel()
+    {
+    }
+
+    void ProfilerPanel::update()
+    {
+        if (!is_active_)
+            return;
+
+        auto &profiler = Core::get_instance().profiler;
+        if (!ImGui::Begin("GPU Profiler", &is_active_))
+        {
+            ImGui::End();
+            return;
+        }
+
+        if (!profiler.is_supported())
+        {
+            ImGui::Text("Timestamp query is not supported on this device.");
+            ImGui::End();
+            return;
+        }
+
+        ImGui::Checkbox("Enable", &profiler.enable);
+        ImGui::SameLine();
+        ImGui::Checkbox("Pipeline Statistics", &profiler.enable_pipeline_statistics);
+        ImGui::Text("Dropped frames: %llu", static_cast<unsigned long long>(profiler.get_dropped_frames()));
+
+        /* スコープ毎の統計 */
+        const auto &names = profiler.get_scope_names();
+        if (ImGui::BeginTable("Scopes", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Scope");
+            ImGui::TableSetupColumn("Last [ms]");
+            ImGui::TableSetupColumn("p50 [ms]");
+            ImGui::TableSetupColumn("p95 [ms]");
+            ImGui::TableSetupColumn("p99 [ms]");
+            ImGui::TableHeadersRow();
+            for (const auto &name : names)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", profiler.get_latest(name).value_or(0.0));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", profiler.get_percentile(name, 50.0));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", profiler.get_percentile(name, 95.0));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", profiler.get_percentile(name, 99.0));
+            }
+            ImGui::EndTable();
+        }
+
+        /* 履歴 */
+        if (ImPlot::BeginPlot("##GPU Time", ImVec2(-1.f, 200.f)))
+        {
+            ImPlot::SetupAxes("Frame", "Time [ms]", ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_AutoFit);
+            ImPlot::SetupAxisLimits(ImAxis_X1, 0.0, static_cast<double>(GpuProfiler::HISTORY_SIZE), ImPlotCond_Always);
+            for (const auto &name : names)
+            {
+                auto history = profiler.get_history(name);
+                if (history == nullptr || history->count == 0u)
+                    continue;
+
+                /* リングバッファの先頭から古い順に描画 */
+                int offset = history->count < GpuProfiler::HISTORY_SIZE ? 0 : static_cast<int>(history->head);
+                ImPlot::PlotLine(name.c_str(), history->values.data(), static_cast<int>(history->count),
+                                 1.0, 0.0, 0, offset);
+            }
+            ImPlot::EndPlot();
+        }
+
+        if (profiler.enable_pipeline_statistics)
+        {
+            auto stats = profiler.get_pipeline_statistics();
+            ImGui::SeparatorText("OffScreen Pipeline Statistics");
+            ImGui::Text("Input vertices: %llu", static_cast<unsigned long long>(stats.input_vertices));
+            ImGui::Text("Input primitives: %llu", static_cast<unsigned long long>(stats.input_primitives));
+            ImGui::Text("Vertex invocations: %llu", static_cast<unsigned long long>(stats.vertex_invocations));
+            ImGui::Text("Clipping primitives: %llu", static_cast<unsigned long long>(stats.clipping_primitives));
+            ImGui::Text("Fragment invocations: %llu", static_cast<unsigned long long>(stats.fragment_invocations));
+        }
+
+        /* フレーム毎の割当の再利用状況 */
+        {
+            auto commands = Core::get_instance().gpu.commands.get_statistics();
+            ImGui::SeparatorText("Command Buffers");
+            ImGui::Text("Acquired: %llu (allocated %llu)", static_cast<unsigned long long>(commands.acquired),
+                        static_cast<unsigned long long>(commands.allocated));
+            ImGui::Text("Pools: %llu (resets %llu)", static_cast<unsigned long long>(commands.pools_created),
+                        static_cast<unsigned long long>(commands.pool_resets));
+
+            auto descriptors = Core::get_instance().gpu.descriptors.get_statistics();
+            ImGui::Text("Descriptor sets: %llu persistent, %llu per-frame", static_cast<unsigned long long>(descriptors.allocated),
+                        static_cast<unsigned long long>(descriptors.transient));
+            ImGui::Text("Descriptor pools: %llu (resets %llu), layouts %llu", static_cast<unsigned long long>(descriptors.pools_created),
+                        static_cast<unsigned long long>(descriptors.pool_resets), static_cast<unsigned long long>(descriptors.layouts));
+
+            auto frame_data = Core::get_instance().frame_allocator.get_statistics();
+            ImGui::Text("Frame data: %.1f KiB (peak %.1f KiB, %llu chunks)", frame_data.used / 1024.0, frame_data.peak / 1024.0,
+                        static_cast<unsigned long long>(frame_data.chunks_created));
+        }
+
+        ImGui::End();
+    }
+}
\ No newline at end of file
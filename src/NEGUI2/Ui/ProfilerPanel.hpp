@@ -0,0 +1,16 @@
+#ifndef _PROFILER_PANEL_HPP
+#define _PROFILER_PANEL_HPP
+#include "NEGUI2/Ui/IUserInterface.hpp"
+
+namespace NEGUI2
+{
+    class ProfilerPanel : public IUserInterface
+    {
+    public:
+        ProfilerPanel();
+        virtual ~ProfilerPanel() override;
+        virtual void update() override;
+    };
+
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include "NEGUI2/Core/RenderGraph.hpp"
+
+using AliasRequest = NEGUI2::RenderGraph::AliasRequest;
+
+TEST(RenderGraph, AliasesDisjointLifetimes)
+{
+    /* [0,0] の後に [1,2] と [3,3] が続けて使える. [2,3] は [1,2] と重なる */
+    std::vector<AliasRequest> requests{{0u, 0u, 0x3u}, {1u, 2u, 0x3u}, {2u, 3u, 0x3u}, {3u, 3u, 0x3u}};
+    auto aliases = NEGUI2::RenderGraph::plan_aliases(requests);
+    std::vector<size_t> expected{0u, 0u, 1u, 0u};
+    EXPECT_EQ(aliases, expected);
+}
+
+TEST(RenderGraph, KeepsOverlappingLifetimesApart)
+{
+    std::vector<AliasRequest> requests{{0u, 2u, 0x1u}, {1u, 2u, 0x1u}, {2u, 2u, 0x1u}};
+    auto aliases = NEGUI2::RenderGraph::plan_aliases(requests);
+    std::vector<size_t> expected{0u, 1u, 2u};
+    EXPECT_EQ(aliases, expected);
+}
+
+TEST(RenderGraph, RequiresCommonMemoryType)
+{
+    /* 型が合わなければ寿命が離れていても共有しない. 合う型は絞り込まれる */
+    std::vector<AliasRequest> requests{{0u, 0u, 0x1u}, {1u, 1u, 0x2u}, {2u, 2u, 0x3u}, {3u, 3u, 0x2u}};
+    auto aliases = NEGUI2::RenderGraph::plan_aliases(requests);
+    std::vector<size_t> expected{0u, 1u, 0u, 1u};
+    EXPECT_EQ(aliases, expected);
+}
+
+TEST(RenderGraph, EmptyRequests)
+{
+    EXPECT_TRUE(NEGUI2::RenderGraph::plan_aliases({}).empty());
+}
\ No newline at end of file
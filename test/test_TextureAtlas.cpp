@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "NEGUI2/Core/TextureAtlas.hpp"
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using NEGUI2::AtlasRegion;
+    using NEGUI2::TextureAtlas;
+
+    /* 縁を含めた配置先の左上 (UVから逆算) */
+    std::pair<uint32_t, uint32_t> position(const AtlasRegion &region)
+    {
+        return {static_cast<uint32_t>(std::lround(region.u0 * TextureAtlas::PAGE_SIZE)) - TextureAtlas::PADDING,
+                static_cast<uint32_t>(std::lround(region.v0 * TextureAtlas::PAGE_SIZE)) - TextureAtlas::PADDING};
+    }
+
+    /* 縁込みで width x height を占める画像を追加 */
+    std::optional<AtlasRegion> add(TextureAtlas &atlas, const std::string &key, const uint32_t &width, const uint32_t &height)
+    {
+        uint32_t image_width = width - TextureAtlas::PADDING * 2u;
+        uint32_t image_height = height - TextureAtlas::PADDING * 2u;
+        std::vector<uint8_t> pixels(static_cast<size_t>(image_width) * image_height * 4u, 255u);
+        return atlas.add(key, pixels.data(), image_width, image_height);
+    }
+
+    using Position = std::pair<uint32_t, uint32_t>;
+}
+
+TEST(TextureAtlas, PacksAlongShelf)
+{
+    TextureAtlas atlas;
+    auto a = add(atlas, "a", 100u, 32u);
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->page, 0u);
+    EXPECT_EQ(position(*a), Position(0u, 0u));
+    EXPECT_EQ(a->width, 98u);
+    EXPECT_EQ(a->height, 30u);
+
+    auto b = add(atlas, "b", 50u, 32u);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(b->page, 0u);
+    EXPECT_EQ(position(*b), Position(100u, 0u));
+}
+
+TEST(TextureAtlas, OpensShelfWhenTaller)
+{
+    TextureAtlas atlas;
+    ASSERT_TRUE(add(atlas, "a", 100u, 32u));
+    auto b = add(atlas, "b", 100u, 64u);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(position(*b), Position(0u, 32u));
+}
+
+TEST(TextureAtlas, PicksLeastWastefulShelf)
+{
+    TextureAtlas atlas;
+    atlas.max_entry_size = TextureAtlas::PAGE_SIZE;
+    ASSERT_TRUE(add(atlas, "a", 100u, 64u));
+    auto full = add(atlas, "full", TextureAtlas::PAGE_SIZE, 32u); // 幅いっぱいの低い棚を先に埋める
+    ASSERT_TRUE(full);
+    EXPECT_EQ(position(*full), Position(0u, 64u));
+
+    auto c = add(atlas, "c", 100u, 40u);
+    ASSERT_TRUE(c);
+    EXPECT_EQ(position(*c), Position(100u, 0u));
+
+    /* 低い棚は埋まっているので新しい棚は開かず高い棚へ */
+    auto d = add(atlas, "d", 100u, 24u);
+    ASSERT_TRUE(d);
+    EXPECT_EQ(position(*d), Position(200u, 0u));
+
+    /* 棚は2つのままなので次の棚はその下から */
+    auto e = add(atlas, "e", TextureAtlas::PAGE_SIZE, 32u);
+    ASSERT_TRUE(e);
+    EXPECT_EQ(position(*e), Position(0u, 96u));
+}
+
+TEST(TextureAtlas, BestFitPrefersLowerShelf)
+{
+    TextureAtlas atlas;
+    ASSERT_TRUE(add(atlas, "a", 100u, 32u));
+    ASSERT_TRUE(add(atlas, "b", 100u, 64u));
+    auto c = add(atlas, "c", 50u, 30u);
+    ASSERT_TRUE(c);
+    EXPECT_EQ(position(*c), Position(100u, 0u));
+    auto d = add(atlas, "d", 50u, 40u);
+    ASSERT_TRUE(d);
+    EXPECT_EQ(position(*d), Position(100u, 32u));
+}
+
+TEST(TextureAtlas, AddsPageWhenFull)
+{
+    TextureAtlas atlas;
+    atlas.max_entry_size = TextureAtlas::PAGE_SIZE;
+    auto a = add(atlas, "a", TextureAtlas::PAGE_SIZE, TextureAtlas::PAGE_SIZE);
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->page, 0u);
+
+    auto b = add(atlas, "b", 3u, 3u);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(b->page, 1u);
+    EXPECT_EQ(position(*b), Position(0u, 0u));
+    EXPECT_EQ(atlas.get_page_count(), 2u);
+    EXPECT_EQ(atlas.get_page_key(1u), "TextureAtlas1");
+
+    /* 縁込みでページを超えるものは入らない */
+    EXPECT_FALSE(add(atlas, "c", TextureAtlas::PAGE_SIZE + 1u, 3u));
+    EXPECT_EQ(atlas.get_page_count(), 2u);
+}
+
+TEST(TextureAtlas, RejectsLargerThanMaxEntry)
+{
+    TextureAtlas atlas;
+    atlas.max_entry_size = 16u;
+    std::vector<uint8_t> pixels(17u * 17u * 4u, 255u);
+    EXPECT_FALSE(atlas.add("large", pixels.data(), 17u, 16u));
+    EXPECT_FALSE(atlas.add("empty", pixels.data(), 0u, 16u));
+    EXPECT_TRUE(atlas.add("fits", pixels.data(), 16u, 16u));
+    EXPECT_FALSE(atlas.get("large"));
+}
+
+TEST(TextureAtlas, SameKeyReturnsExistingRegion)
+{
+    TextureAtlas atlas;
+    auto a = add(atlas, "a", 18u, 18u);
+    ASSERT_TRUE(a);
+
+    /* 同じキーは大きさが違っても書き込まず, 最初の領域を返す */
+    auto again = add(atlas, "a", 10u, 10u);
+    ASSERT_TRUE(again);
+    EXPECT_EQ(again->width, 16u);
+    EXPECT_EQ(position(*again), position(*a));
+
+    auto b = add(atlas, "b", 18u, 18u);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(position(*b), Position(18u, 0u));
+
+    auto found = atlas.get("b");
+    ASSERT_TRUE(found);
+    EXPECT_EQ(found->u0, b->u0);
+    EXPECT_EQ(found->v1, b->v1);
+    EXPECT_FALSE(atlas.get("missing"));
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "NEGUI2/ThreeD/TransformBatch.hpp"
+
+TEST(TransformBatch, SubtractsOriginInDouble)
+{
+    /* floatへ先に落とすと0.25の差は消える */
+    const Eigen::Vector3d origin(1.0e7, -2.0e7, 3.0e7);
+    Eigen::Affine3d transform(Eigen::Translation3d(origin + Eigen::Vector3d(0.25, -0.5, 0.125)));
+    ASSERT_NE(static_cast<float>(origin.x() + 0.25) - static_cast<float>(origin.x()), 0.25f);
+
+    NEGUI2::TransformBatch batch;
+    auto index = batch.add(transform);
+    batch.compute(origin);
+
+    auto matrix = batch.get(index);
+    EXPECT_EQ(matrix(0, 3), 0.25f);
+    EXPECT_EQ(matrix(1, 3), -0.5f);
+    EXPECT_EQ(matrix(2, 3), 0.125f);
+    EXPECT_EQ(matrix.row(3), Eigen::RowVector4f(0.f, 0.f, 0.f, 1.f));
+}
+
+TEST(TransformBatch, KeepsLinearPart)
+{
+    Eigen::Affine3d transform = Eigen::Translation3d(1.0, 2.0, 3.0) *
+                                Eigen::AngleAxisd(0.5, Eigen::Vector3d(1.0, 2.0, 3.0).normalized()) *
+                                Eigen::Scaling(2.0, 3.0, 4.0);
+
+    NEGUI2::TransformBatch batch;
+    batch.add(Eigen::Affine3d::Identity());
+    auto index = batch.add(transform);
+    batch.compute(Eigen::Vector3d(1.0, 1.0, 1.0));
+
+    ASSERT_EQ(batch.size(), 2u);
+    auto matrix = batch.get(index);
+    Eigen::Matrix3f linear = matrix.topLeftCorner(3, 3);
+    EXPECT_TRUE(linear.isApprox(transform.linear().cast<float>()));
+    Eigen::Vector3f translation = matrix.col(3).head(3);
+    EXPECT_TRUE(translation.isApprox(Eigen::Vector3f(0.f, 1.f, 2.f)));
+    EXPECT_TRUE(batch.get(0).isApprox(Eigen::Affine3f(Eigen::Translation3f(-1.f, -1.f, -1.f)).matrix()));
+}
+
+TEST(TransformBatch, ClearRestartsIndices)
+{
+    NEGUI2::TransformBatch batch;
+    batch.add(Eigen::Affine3d(Eigen::Translation3d(1.0, 0.0, 0.0)));
+    batch.add(Eigen::Affine3d(Eigen::Translation3d(2.0, 0.0, 0.0)));
+    batch.clear();
+    EXPECT_EQ(batch.size(), 0u);
+
+    EXPECT_EQ(batch.add(Eigen::Affine3d(Eigen::Translation3d(3.0, 0.0, 0.0))), 0u);
+    batch.compute(Eigen::Vector3d::Zero());
+    EXPECT_EQ(batch.get(0)(0, 3), 3.f);
+}
\ No newline at end of file
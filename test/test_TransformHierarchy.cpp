@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include "NEGUI2/ThreeD/TransformHierarchy.hpp"
+#include "NEGUI2/ThreeD/BaseTransform.hpp"
+
+namespace
+{
+    Eigen::Affine3d translation(const double &x, const double &y, const double &z)
+    {
+        return Eigen::Affine3d(Eigen::Translation3d(x, y, z));
+    }
+}
+
+TEST(TransformHierarchy, ParentsComeBeforeChildren)
+{
+    NEGUI2::TransformHierarchy hierarchy;
+    NEGUI2::BaseTransform child, middle, root;
+    hierarchy.add(&child);
+    hierarchy.add(&middle);
+    hierarchy.add(&root);
+
+    /* 追加順とは逆の親子関係 */
+    ASSERT_TRUE(hierarchy.set_parent(&child, &middle));
+    ASSERT_TRUE(hierarchy.set_parent(&middle, &root));
+    hierarchy.update();
+
+    ASSERT_EQ(hierarchy.size(), 3u);
+    EXPECT_EQ(hierarchy.get_owner(0), &root);
+    EXPECT_EQ(hierarchy.get_owner(1), &middle);
+    EXPECT_EQ(hierarchy.get_owner(2), &child);
+    EXPECT_EQ(hierarchy.get_parent(&child), &middle);
+    EXPECT_EQ(hierarchy.get_parent(&middle), &root);
+    EXPECT_EQ(hierarchy.get_parent(&root), nullptr);
+}
+
+TEST(TransformHierarchy, WorldIsParentTimesLocal)
+{
+    NEGUI2::TransformHierarchy hierarchy;
+    NEGUI2::BaseTransform parent, child;
+    hierarchy.add(&parent);
+    hierarchy.add(&child);
+    parent.set_transform(translation(1.0, 0.0, 0.0));
+    child.set_transform(translation(0.0, 2.0, 0.0));
+    ASSERT_TRUE(hierarchy.set_parent(&child, &parent));
+    hierarchy.update();
+
+    EXPECT_TRUE(child.get_world_transform().translation().isApprox(Eigen::Vector3d(1.0, 2.0, 0.0)));
+    EXPECT_TRUE(child.get_transform().translation().isApprox(Eigen::Vector3d(0.0, 2.0, 0.0)));
+}
+
+TEST(TransformHierarchy, RejectsCycles)
+{
+    NEGUI2::TransformHierarchy hierarchy;
+    NEGUI2::BaseTransform a, b, c;
+    hierarchy.add(&a);
+    hierarchy.add(&b);
+    hierarchy.add(&c);
+
+    ASSERT_TRUE(hierarchy.set_parent(&b, &a));
+    ASSERT_TRUE(hierarchy.set_parent(&c, &b));
+    EXPECT_FALSE(hierarchy.set_parent(&a, &a));
+    EXPECT_FALSE(hierarchy.set_parent(&a, &b));
+    EXPECT_FALSE(hierarchy.set_parent(&a, &c));
+    EXPECT_EQ(hierarchy.get_parent(&a), nullptr);
+
+    /* 別の階層のノードも拒否 */
+    NEGUI2::TransformHierarchy other;
+    NEGUI2::BaseTransform outsider;
+    other.add(&outsider);
+    EXPECT_FALSE(hierarchy.set_parent(&a, &outsider));
+}
+
+TEST(TransformHierarchy, RemoveKeepsChildWorldPosition)
+{
+    NEGUI2::TransformHierarchy hierarchy;
+    NEGUI2::BaseTransform parent, child, grandchild;
+    hierarchy.add(&parent);
+    hierarchy.add(&child);
+    hierarchy.add(&grandchild);
+    parent.set_transform(translation(1.0, 0.0, 0.0));
+    child.set_transform(translation(0.0, 2.0, 0.0));
+    grandchild.set_transform(translation(0.0, 0.0, 3.0));
+    ASSERT_TRUE(hierarchy.set_parent(&child, &parent));
+    ASSERT_TRUE(hierarchy.set_parent(&grandchild, &child));
+    hierarchy.update();
+
+    hierarchy.remove(&parent);
+    hierarchy.update();
+
+    ASSERT_EQ(hierarchy.size(), 2u);
+    EXPECT_EQ(hierarchy.get_parent(&child), nullptr);
+    EXPECT_EQ(hierarchy.get_parent(&grandchild), &child);
+    EXPECT_TRUE(child.get_transform().translation().isApprox(Eigen::Vector3d(1.0, 2.0, 0.0)));
+    EXPECT_TRUE(child.get_world_transform().translation().isApprox(Eigen::Vector3d(1.0, 2.0, 0.0)));
+    EXPECT_TRUE(grandchild.get_world_transform().translation().isApprox(Eigen::Vector3d(1.0, 2.0, 3.0)));
+
+    /* 外したノードは階層の外で動く */
+    parent.set_transform(translation(5.0, 0.0, 0.0));
+    hierarchy.update();
+    EXPECT_TRUE(parent.get_world_transform().translation().isApprox(Eigen::Vector3d(5.0, 0.0, 0.0)));
+    EXPECT_TRUE(child.get_world_transform().translation().isApprox(Eigen::Vector3d(1.0, 2.0, 0.0)));
+}
+
+TEST(TransformHierarchy, UpdatesOnlyDirtySubtrees)
+{
+    NEGUI2::TransformHierarchy hierarchy;
+    NEGUI2::BaseTransform root, child, grandchild, other;
+    hierarchy.add(&root);
+    hierarchy.add(&child);
+    hierarchy.add(&grandchild);
+    hierarchy.add(&other);
+    ASSERT_TRUE(hierarchy.set_parent(&child, &root));
+    ASSERT_TRUE(hierarchy.set_parent(&grandchild, &child));
+
+    EXPECT_EQ(hierarchy.update(), 4u);
+    EXPECT_EQ(hierarchy.update(), 0u);
+
+    root.set_position(Eigen::Vector3d(1.0, 0.0, 0.0));
+    EXPECT_EQ(hierarchy.update(), 3u);
+    EXPECT_EQ(hierarchy.get_last_updated(), 3u);
+
+    child.set_position(Eigen::Vector3d(0.0, 1.0, 0.0));
+    EXPECT_EQ(hierarchy.update(), 2u);
+
+    other.set_position(Eigen::Vector3d(0.0, 0.0, 1.0));
+    EXPECT_EQ(hierarchy.update(), 1u);
+    EXPECT_TRUE(grandchild.get_world_transform().translation().isApprox(Eigen::Vector3d(1.0, 1.0, 0.0)));
+}
+
+TEST(TransformHierarchy, NotifiesChanges)
+{
+    NEGUI2::TransformHierarchy hierarchy;
+    size_t changes = 0u;
+    hierarchy.set_changed_callback([&changes]()
+                                   { changes++; });
+
+    NEGUI2::BaseTransform parent, child, detached;
+    hierarchy.add(&parent);
+    hierarchy.add(&child);
+    child.set_position(Eigen::Vector3d(1.0, 0.0, 0.0));
+    EXPECT_EQ(changes, 1u);
+    ASSERT_TRUE(hierarchy.set_parent(&child, &parent));
+    EXPECT_EQ(changes, 2u);
+
+    /* 階層外の変換は通知しない */
+    detached.set_position(Eigen::Vector3d(1.0, 0.0, 0.0));
+    EXPECT_EQ(changes, 2u);
+    EXPECT_TRUE(detached.get_world_transform().translation().isApprox(Eigen::Vector3d(1.0, 0.0, 0.0)));
+}
\ No newline at end of file